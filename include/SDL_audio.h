@@ -103,8 +103,11 @@ typedef struct SDL_AudioSpec {
 #define AUDIO_S16LSB	0x8010	/**< Signed 16-bit samples */
 #define AUDIO_U16MSB	0x1010	/**< As above, but big-endian byte order */
 #define AUDIO_S16MSB	0x9010	/**< As above, but big-endian byte order */
+#define AUDIO_F32LSB	0x8120	/**< 32-bit float samples, -1.0 to 1.0 */
+#define AUDIO_F32MSB	0x9120	/**< As above, but big-endian byte order */
 #define AUDIO_U16	AUDIO_U16LSB
 #define AUDIO_S16	AUDIO_S16LSB
+#define AUDIO_F32	AUDIO_F32LSB
 
 /**
  *  @name Native audio byte ordering
@@ -113,9 +116,11 @@ typedef struct SDL_AudioSpec {
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 #define AUDIO_U16SYS	AUDIO_U16LSB
 #define AUDIO_S16SYS	AUDIO_S16LSB
+#define AUDIO_F32SYS	AUDIO_F32LSB
 #else
 #define AUDIO_U16SYS	AUDIO_U16MSB
 #define AUDIO_S16SYS	AUDIO_S16MSB
+#define AUDIO_F32SYS	AUDIO_F32MSB
 #endif
 /*@}*/
 
@@ -195,6 +200,14 @@ extern DECLSPEC SDL_audiostatus SDLCALL SDL_GetAudioStatus(void);
  */
 extern DECLSPEC void SDLCALL SDL_PauseAudio(int pause_on);
 
+/**
+ * Call this with a parameter of 1 if your callback always writes every
+ * byte of the stream it is passed, so SDL can skip clearing the stream to
+ * silence before each call.  The stream is still cleared while paused.
+ * This may be called at any time, and stays in effect until changed.
+ */
+extern DECLSPEC void SDLCALL SDL_SetAudioCallbackFills(int fills_on);
+
 /**
  * This function loads a WAVE from the data source, automatically freeing
  * that source if 'freesrc' is non-zero.  For example, to load a WAVE file,
@@ -246,6 +259,58 @@ extern DECLSPEC int SDLCALL SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
  */
 extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
 
+/**
+ * @name Audio Streams
+ * An audio stream converts audio incrementally: put data in the source
+ * format in arbitrary sized pieces, and get the converted data back as it
+ * becomes available.  Unlike SDL_ConvertAudio(), the stream keeps the
+ * resampler state between calls, so there are no clicks at the boundaries,
+ * and it only buffers the converted data that hasn't been read yet.
+ */
+/*@{*/
+typedef struct SDL_AudioStream SDL_AudioStream;
+
+/**
+ * Create a stream converting from the source format, channels and rate to
+ * the destination ones.  Returns NULL if the conversion isn't supported or
+ * there wasn't enough memory.
+ */
+extern DECLSPEC SDL_AudioStream * SDLCALL SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate);
+
+/**
+ * Add 'len' bytes of source audio to the stream.  'len' need not be a
+ * multiple of the frame size; a partial frame is kept for the next call.
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamPut(SDL_AudioStream *stream,
+					const void *buf, int len);
+
+/**
+ * Read up to 'len' bytes of converted audio, in whole frames.
+ * @return the number of bytes read, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamGet(SDL_AudioStream *stream,
+					void *buf, int len);
+
+/** Returns the number of converted bytes ready to be read */
+extern DECLSPEC int SDLCALL SDL_AudioStreamAvailable(SDL_AudioStream *stream);
+
+/**
+ * Tell the stream no more input is coming, so the audio still held back by
+ * the resampler is converted and made available.  The stream can be reused
+ * for new data afterwards.
+ * @return 0, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_AudioStreamFlush(SDL_AudioStream *stream);
+
+/** Drop all buffered input and output, as if the stream was just created */
+extern DECLSPEC void SDLCALL SDL_AudioStreamClear(SDL_AudioStream *stream);
+
+extern DECLSPEC void SDLCALL SDL_FreeAudioStream(SDL_AudioStream *stream);
+/*@}*/
+
 
 #define SDL_MIX_MAXVOLUME 128
 /**
@@ -257,6 +322,62 @@ extern DECLSPEC int SDLCALL SDL_ConvertAudio(SDL_AudioCVT *cvt);
  */
 extern DECLSPEC void SDLCALL SDL_MixAudio(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
 
+/**
+ * @name Voice Mixer
+ * Instead of calling SDL_MixAudio() once per sound, an application can
+ * register its sounds as voices, and mix all of them with one call to
+ * SDL_MixVoices() from the audio callback.  The voices are summed at 32-bit
+ * precision and clipped once at the end.
+ *
+ * Voice data is in the audio format the callback works in (U8, S8, S16LSB,
+ * S16MSB, F32LSB or F32MSB).  The voice functions lock the audio device while they change
+ * a voice, so they may be called at any time.
+ */
+/*@{*/
+#define SDL_VOICE_NORMALPITCH	0x10000
+
+/**
+ * Called from SDL_MixVoices() to get 'len' more bytes of a streaming voice.
+ * It runs on the audio thread, like the audio callback.
+ */
+typedef void (SDLCALL *SDL_VoiceCallback)(void *userdata, Uint8 *stream, int len);
+
+/**
+ * Create a voice playing 'len' bytes from 'buf', which must stay valid
+ * until the voice is freed.  If 'loop' is nonzero, the voice starts over
+ * when it reaches the end, otherwise it stops.  Voices are created paused.
+ * @return the voice, or -1 if there was an error.
+ */
+extern DECLSPEC int SDLCALL SDL_CreateVoice(const Uint8 *buf, Uint32 len, int loop);
+
+/** Create a voice whose data is produced by 'callback' as it plays */
+extern DECLSPEC int SDLCALL SDL_CreateStreamingVoice(SDL_VoiceCallback callback, void *userdata);
+
+/**
+ * Set the volume of a voice, from 0 to SDL_MIX_MAXVOLUME, and its position
+ * from -SDL_MIX_MAXVOLUME (left) through 0 (center) to SDL_MIX_MAXVOLUME
+ * (right).  The position only matters for stereo or wider output.
+ */
+extern DECLSPEC int SDLCALL SDL_SetVoiceVolume(int voice, int volume, int pan);
+
+/**
+ * Set the playback speed of a voice, where SDL_VOICE_NORMALPITCH plays the
+ * data at the output rate and twice that plays it an octave higher.
+ */
+extern DECLSPEC int SDLCALL SDL_SetVoicePitch(int voice, int pitch);
+
+/** Pause (1) or resume (0) a voice; resuming a finished voice restarts it */
+extern DECLSPEC int SDLCALL SDL_PauseVoice(int voice, int pause_on);
+
+/** Returns 1 if the voice is playing, 0 if it is paused or has finished */
+extern DECLSPEC int SDLCALL SDL_VoicePlaying(int voice);
+
+extern DECLSPEC void SDLCALL SDL_FreeVoice(int voice);
+
+/** Add all the playing voices to 'len' bytes of 'stream' */
+extern DECLSPEC void SDLCALL SDL_MixVoices(Uint8 *stream, int len);
+/*@}*/
+
 /**
  * @name Audio Locks
  * The lock manipulated by these functions protects the callback function.
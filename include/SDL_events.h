@@ -289,12 +289,46 @@ extern DECLSPEC int SDLCALL SDL_PollEvent(SDL_Event *event);
  */
 extern DECLSPEC int SDLCALL SDL_WaitEvent(SDL_Event *event);
 
+/** Waits until the specified timeout (in milliseconds) for the next available
+ *  event, returning 1, or 0 if the timeout elapsed or there was an error.
+ *  If 'event' is not NULL, the next event is removed from the queue and
+ *  stored in that area.
+ *
+ *  Events added by other threads and by the event thread wake the caller
+ *  immediately.  Without SDL_INIT_EVENTTHREAD, the caller still pumps the
+ *  video driver every SDL_TIMESLICE milliseconds while it waits.
+ */
+extern DECLSPEC int SDLCALL SDL_WaitEventTimeout(SDL_Event *event, int timeout);
+
 /** Add an event to the event queue.
  *  This function returns 0 on success, or -1 if the event queue was full
  *  or there was some other error.
+ *  The queue grows as needed, to hold up to 65535 events.
  */
 extern DECLSPEC int SDLCALL SDL_PushEvent(SDL_Event *event);
 
+/** Returns the number of events lost since the event loop was started,
+ *  because the event queue had grown to its limit or couldn't grow.
+ */
+extern DECLSPEC Uint32 SDLCALL SDL_GetDroppedEvents(void);
+
+/** Counts of what happened to the events of each type since the event loop
+ *  was started.
+ *
+ *  When the application falls behind, mouse motion is merged into the
+ *  motion event at the end of the queue, adding up xrel and yrel, rather
+ *  than queued separately.  The SDL_MOUSE_COALESCE environment variable
+ *  sets how many events must be waiting before that happens (64 by
+ *  default), or turns it off when set to 0.
+ */
+typedef struct SDL_EventStats {
+	Uint32 queued[SDL_NUMEVENTS];	/**< added to the queue */
+	Uint32 coalesced[SDL_NUMEVENTS];	/**< merged into a queued event */
+	Uint32 dropped[SDL_NUMEVENTS];	/**< lost because the queue was full */
+} SDL_EventStats;
+
+extern DECLSPEC void SDLCALL SDL_GetEventStats(SDL_EventStats *stats);
+
 /** @name Event Filtering */
 /*@{*/
 typedef int (SDLCALL *SDL_EventFilter)(const SDL_Event *event);
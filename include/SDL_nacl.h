@@ -7,12 +7,46 @@
 extern "C" {
 #endif
 
+#include "SDL_stdinc.h"
+
 #include <ppapi/c/ppb_instance.h>
 #include <ppapi/c/pp_input_event.h>
 
 void SDL_NACL_SetInstance(PP_Instance instance, int width, int height);
 void SDL_NACL_PushEvent(const PP_InputEvent* ppevent);
 
+/* Presentation statistics of the nacl video driver.
+   'published' counts frames handed over by SDL_UpdateRects()/SDL_Flip(),
+   'presented' counts frames that reached the screen and 'dropped' counts
+   frames that were superseded by a newer one before they could be painted.
+ */
+typedef struct SDL_NACL_FrameStats {
+  Uint32 published;
+  Uint32 presented;
+  Uint32 dropped;
+} SDL_NACL_FrameStats;
+
+/* Block until the last published frame has been presented, or until
+   'timeout' milliseconds have passed (SDL_MUTEX_MAXWAIT waits forever).
+   This is the nacl equivalent of waiting for the vertical retrace.  It
+   must not be called from the main (Pepper) thread.  Returns 0 once the
+   frame is presented, SDL_MUTEX_TIMEDOUT on timeout and -1 on error.
+ */
+int SDL_NACL_WaitFramePresented(Uint32 timeout);
+void SDL_NACL_GetFrameStats(SDL_NACL_FrameStats* stats);
+
+/* Statistics of the nacl audio driver since SDL_OpenAudio().
+   'callbacks' counts buffers requested by the browser and 'underruns'
+   counts those that had to be filled with silence because the SDL audio
+   thread had not mixed them in time.
+ */
+typedef struct SDL_NACL_AudioStats {
+  Uint32 callbacks;
+  Uint32 underruns;
+} SDL_NACL_AudioStats;
+
+void SDL_NACL_GetAudioStats(SDL_NACL_AudioStats* stats);
+
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
@@ -51,6 +51,34 @@ extern DECLSPEC Uint32 SDLCALL SDL_GetTicks(void);
 /** Wait a specified number of milliseconds before returning */
 extern DECLSPEC void SDLCALL SDL_Delay(Uint32 ms);
 
+#ifdef SDL_HAS_64BIT_TYPE
+/**
+ * Get the current value of a high resolution counter, which counts up
+ * monotonically from the SDL library initialization.  Divide differences
+ * by SDL_GetPerformanceFrequency() to get seconds.  On platforms without
+ * a finer clock this is the same as SDL_GetTicks().
+ */
+extern DECLSPEC Uint64 SDLCALL SDL_GetPerformanceCounter(void);
+
+/** Get the number of SDL_GetPerformanceCounter() counts per second */
+extern DECLSPEC Uint64 SDLCALL SDL_GetPerformanceFrequency(void);
+
+/**
+ * Wait until SDL_GetPerformanceCounter() reaches 'counter', returning
+ * immediately if it already has.  Sleeping to an absolute deadline rather
+ * than for an interval keeps a periodic loop from drifting:
+ *   @code
+ *   Uint64 next = SDL_GetPerformanceCounter();
+ *   for ( ;; ) {
+ *       next += SDL_GetPerformanceFrequency() / 1000;
+ *       SDL_DelayUntil(next);
+ *       ...
+ *   }
+ *   @endcode
+ */
+extern DECLSPEC void SDLCALL SDL_DelayUntil(Uint64 counter);
+#endif /* SDL_HAS_64BIT_TYPE */
+
 /** Function prototype for the timer callback function */
 typedef Uint32 (SDLCALL *SDL_TimerCallback)(Uint32 interval);
 
@@ -104,6 +132,9 @@ typedef Uint32 (SDLCALL *SDL_NewTimerCallback)(Uint32 interval, void *param);
 typedef struct _SDL_TimerID *SDL_TimerID;
 
 /** Add a new timer to the pool of timers already running.
+ *  Where timers run on a thread (e.g. UNIX with threads enabled), the
+ *  interval is not rounded to TIMER_RESOLUTION and timers fire with about
+ *  1 ms granularity.
  *  Returns a timer ID, or NULL when an error occurs.
  */
 extern DECLSPEC SDL_TimerID SDLCALL SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *param);
@@ -114,6 +145,27 @@ extern DECLSPEC SDL_TimerID SDLCALL SDL_AddTimer(Uint32 interval, SDL_NewTimerCa
  */
 extern DECLSPEC SDL_bool SDLCALL SDL_RemoveTimer(SDL_TimerID t);
 
+/** How late a timer's callbacks have started, in milliseconds */
+typedef struct SDL_TimerStats {
+	Uint32 calls;		/**< callbacks run so far */
+	Uint32 missed;		/**< times a whole interval was skipped */
+	Uint32 late_max;	/**< the latest a callback has started */
+	Uint32 late_total;	/**< the sum of how late each callback started */
+} SDL_TimerStats;
+
+/**
+ * Get the lateness statistics of a timer added with SDL_AddTimer().
+ *
+ * Timer callbacks normally run one after the other on a single thread, so
+ * a slow callback delays all the others.  Setting the SDL_TIMER_WORKERS
+ * environment variable to a number of threads before initializing the
+ * timer subsystem runs the callbacks on that many worker threads instead.
+ * Each timer keeps to one worker, so its own callbacks never overlap.
+ *
+ * Returns 0, or -1 if the timer ID is not valid.
+ */
+extern DECLSPEC int SDLCALL SDL_GetTimerStats(SDL_TimerID t, SDL_TimerStats *stats);
+
 /*@}*/
 
 /* Ends C function definitions when using C++ */
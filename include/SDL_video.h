@@ -737,6 +737,13 @@ extern DECLSPEC SDL_Surface * SDLCALL SDL_ConvertSurface
  * fullscreen application.  The lock will also fail until you have access
  * to the video memory again.
  *
+ * Setting the SDL_BLIT_THREADS environment variable to a number of
+ * threads before calling SDL_Init() splits large software blits, fills
+ * and filtered stretches into bands of rows, which run on that many
+ * worker threads as well as on the calling thread.  The results are
+ * exactly the same as without it.  Blits within one surface and blits
+ * to or from video memory always run on the calling thread alone.
+ *
  * You should call SDL_BlitSurface() unless you know exactly how SDL
  * blitting works internally and how to use the other blit functions.
  */
@@ -767,6 +774,38 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 extern DECLSPEC int SDLCALL SDL_FillRect
 		(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color);
 
+/**
+ * This function fills 'count' rectangles with 'color', like calling
+ * SDL_FillRect() on each of them, but locks the surface only once.
+ * Each rectangle is clipped to the destination surface clip area; the
+ * rectangles themselves are not modified.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_FillRects
+		(SDL_Surface *dst, const SDL_Rect *rects, int count, Uint32 color);
+
+/** Filters for SDL_SoftStretchFilter() */
+typedef enum {
+	SDL_STRETCH_NEAREST,	/**< Nearest pixel, no filtering */
+	SDL_STRETCH_BILINEAR,	/**< Linear between the nearest 2x2 pixels */
+	SDL_STRETCH_BOX		/**< Average of the covered area, for shrinking */
+} SDL_StretchFilter;
+
+/**
+ * This function copies 'srcrect' of 'src' scaled to fill 'dstrect' of
+ * 'dst', using the given filter and converting between the surface
+ * formats on the way, so a frame can be scaled into the display format
+ * in one pass.  Both surfaces must be at least 8 bits per pixel.  All
+ * four channels are filtered; colorkey and alpha blending are ignored.
+ * The rectangles are not clipped and must lie within the surfaces; NULL
+ * means the whole surface.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchFilter
+			(SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect,
+			 SDL_StretchFilter filter);
+
 /**
  * This function takes a surface and copies it to a new surface of the
  * pixel format and colors of the video framebuffer, suitable for fast
@@ -27,6 +27,7 @@
 #include "SDL_fatal.h"
 #if !SDL_VIDEO_DISABLED
 #include "video/SDL_leaks.h"
+#include "video/SDL_bands_c.h"
 #endif
 
 #if SDL_THREAD_PTH
@@ -163,6 +164,11 @@ int SDL_Init(Uint32 flags)
 		return(-1);
 	}
 
+#if !SDL_VIDEO_DISABLED
+	/* Start the blit workers, if SDL_BLIT_THREADS asks for them */
+	SDL_StartBandWorkers();
+#endif
+
 	/* Everything is initialized */
 	if ( !(flags & SDL_INIT_NOPARACHUTE) ) {
 		SDL_InstallParachute();
@@ -221,6 +227,10 @@ void SDL_Quit(void)
 #endif
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
 
+#if !SDL_VIDEO_DISABLED
+	SDL_StopBandWorkers();
+#endif
+
 #ifdef CHECK_LEAKS
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : CHECK_LEAKS\n"); fflush(stdout);
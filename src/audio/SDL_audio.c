@@ -120,10 +120,51 @@ static AudioBootStrap *bootstrap[] = {
 };
 SDL_AudioDevice *current_audio = NULL;
 
+/* Set if the application callback writes every byte of its stream */
+static int callback_fills = 0;
+
 /* Various local functions */
 int SDL_AudioInit(const char *driver_name);
 void SDL_AudioQuit(void);
 
+/* Fill 'stream' with exactly one driver buffer of resampled audio, running
+   the callback on the conversion buffer as many times as that takes.
+ */
+static void SDL_RunResample(SDL_AudioDevice *audio,
+			SDL_AudioStream *resample, Uint8 *stream)
+{
+	void (SDLCALL *fill)(void *userdata,Uint8 *stream, int len);
+	Uint8 *buf = audio->convert.buf;
+	int len = audio->convert.len;
+	int paused, got;
+
+	fill = audio->spec.callback;
+	while ( SDL_AudioStreamAvailable(resample) < (int)audio->spec.size ) {
+		paused = audio->paused;
+		if ( paused || !callback_fills ) {
+			SDL_memset(buf, audio->callback_spec.silence, len);
+		}
+		if ( ! paused ) {
+			SDL_mutexP(audio->mixer_lock);
+			(*fill)(audio->spec.userdata, buf, len);
+			SDL_mutexV(audio->mixer_lock);
+		}
+		if ( SDL_AudioStreamPut(resample, buf, len) < 0 ) {
+			break;
+		}
+	}
+
+	got = SDL_AudioStreamGet(resample, stream, audio->spec.size);
+	if ( got < 0 ) {
+		got = 0;
+	}
+	if ( got < (int)audio->spec.size ) {
+		/* Out of memory, play silence rather than stale data */
+		SDL_memset(stream + got, audio->spec.silence,
+					audio->spec.size - got);
+	}
+}
+
 /* The general mixing thread function */
 int SDLCALL SDL_RunAudio(void *audiop)
 {
@@ -133,6 +174,10 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	void  *udata;
 	void (SDLCALL *fill)(void *userdata,Uint8 *stream, int len);
 	int    silence;
+	int    paused;
+	int    direct;
+	Uint8 *convert_buf;
+	SDL_AudioStream *resample = NULL;
 
 	/* Perform any thread setup */
 	if ( audio->ThreadInit ) {
@@ -156,6 +201,27 @@ int SDLCALL SDL_RunAudio(void *audiop)
 		stream_len = audio->spec.size;
 	}
 
+	/* Convert in the driver's buffer when it has room for every stage of
+	   the conversion, instead of copying the converted data there.
+	 */
+	convert_buf = audio->convert.buf;
+	direct = audio->convert.needed && ((Uint32)audio->convert.len *
+			audio->convert.len_mult <= audio->spec.size);
+
+	/* When the rate changes, a buffer's worth of callback data doesn't
+	   convert to a whole driver buffer, and the filter needs the samples
+	   on either side of it.  A stream keeps the filter history between
+	   buffers and holds on to what is left over for the next one.
+	   Without it, each buffer is converted on its own.
+	 */
+	if ( audio->convert.needed && audio->convert.len > 0 &&
+	     audio->callback_spec.freq != audio->spec.freq ) {
+		resample = SDL_NewAudioStream(audio->callback_spec.format,
+			audio->callback_spec.channels, audio->callback_spec.freq,
+			audio->spec.format, audio->spec.channels,
+			audio->spec.freq);
+	}
+
 #ifdef __OS2__
         /* Increase the priority of this thread to make sure that
            the audio will be continuous all the time! */
@@ -180,10 +246,27 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	/* Loop, filling the audio buffers */
 	while ( audio->enabled ) {
 
+		/* Resampled audio comes out of the stream a buffer at a time */
+		if ( resample ) {
+			stream = audio->GetAudioBuf(audio);
+			if ( stream == NULL ) {
+				stream = audio->fake_stream;
+			}
+			SDL_RunResample(audio, resample, stream);
+			if ( stream != audio->fake_stream ) {
+				audio->PlayAudio(audio);
+				audio->WaitAudio(audio);
+			} else {
+				SDL_Delay((audio->spec.samples*1000)/
+							audio->spec.freq);
+			}
+			continue;
+		}
+
 		/* Fill the current buffer with sound */
-		if ( audio->convert.needed ) {
-			if ( audio->convert.buf ) {
-				stream = audio->convert.buf;
+		if ( audio->convert.needed && !direct ) {
+			if ( convert_buf ) {
+				stream = convert_buf;
 			} else {
 				continue;
 			}
@@ -194,16 +277,23 @@ int SDLCALL SDL_RunAudio(void *audiop)
 			}
 		}
 
-		SDL_memset(stream, silence, stream_len);
+		paused = audio->paused;
+		if ( paused || !callback_fills ) {
+			SDL_memset(stream, silence, stream_len);
+		}
 
-		if ( ! audio->paused ) {
+		if ( ! paused ) {
 			SDL_mutexP(audio->mixer_lock);
 			(*fill)(udata, stream, stream_len);
 			SDL_mutexV(audio->mixer_lock);
 		}
 
 		/* Convert the audio if necessary */
-		if ( audio->convert.needed ) {
+		if ( direct ) {
+			audio->convert.buf = stream;
+			SDL_ConvertAudio(&audio->convert);
+			audio->convert.buf = convert_buf;
+		} else if ( audio->convert.needed ) {
 			SDL_ConvertAudio(&audio->convert);
 			stream = audio->GetAudioBuf(audio);
 			if ( stream == NULL ) {
@@ -230,6 +320,9 @@ int SDLCALL SDL_RunAudio(void *audiop)
 	if ( audio->WaitDone ) {
 		audio->WaitDone(audio);
 	}
+	if ( resample ) {
+		SDL_FreeAudioStream(resample);
+	}
 
 #ifdef __OS2__
 #ifdef DEBUG_BUILD
@@ -268,6 +361,10 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		++string;
 		format |= 0x8000;
 		break;
+	    case 'F':
+		++string;
+		format |= 0x8100;
+		break;
 	    default:
 		return 0;
 	}
@@ -277,8 +374,9 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 		format |= 8;
 		break;
 	    case 16:
+	    case 32:
+		format |= SDL_atoi(string);
 		string += 2;
-		format |= 16;
 		if ( SDL_strcmp(string, "LSB") == 0
 #if SDL_BYTEORDER == SDL_LIL_ENDIAN
 		     || SDL_strcmp(string, "SYS") == 0
@@ -297,6 +395,10 @@ static Uint16 SDL_ParseAudioFormat(const char *string)
 	    default:
 		return 0;
 	}
+	/* Only the 32-bit formats are floating point */
+	if ( ((format & 0xFF) == 32) != ((format & 0x0100) != 0) ) {
+		return 0;
+	}
 	return format;
 }
 
@@ -494,6 +596,11 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 
 	/* Open the audio subsystem */
 	SDL_memcpy(&audio->spec, desired, sizeof(audio->spec));
+	/* Drivers that can't play float get 16-bit, converted below */
+	if ( (audio->spec.format & 0xFF) == 32 && !audio->plays_float ) {
+		audio->spec.format = AUDIO_S16SYS;
+		SDL_CalculateAudioSpec(&audio->spec);
+	}
 	audio->convert.needed = 0;
 	audio->enabled = 1;
 	audio->paused  = 1;
@@ -535,8 +642,12 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 			return(-1);
 		}
 		if ( audio->convert.needed ) {
+			/* Whole frames of the callback's format */
+			int frame = ((desired->format & 0xFF) / 8) *
+							desired->channels;
 			audio->convert.len = (int) ( ((double) audio->spec.size) /
                                           audio->convert.len_ratio );
+			audio->convert.len -= audio->convert.len % frame;
 			audio->convert.buf =(Uint8 *)SDL_AllocAudioMem(
 			   audio->convert.len*audio->convert.len_mult);
 			if ( audio->convert.buf == NULL ) {
@@ -547,6 +658,13 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
 		}
 	}
 
+	/* Remember the format the callback (and the voice mixer) works in */
+	if ( obtained != NULL ) {
+		SDL_memcpy(&audio->callback_spec, &audio->spec, sizeof(audio->spec));
+	} else {
+		SDL_memcpy(&audio->callback_spec, desired, sizeof(audio->spec));
+	}
+
 	/* Start the audio thread if necessary */
 	switch (audio->opened) {
 		case  1:
@@ -597,6 +715,11 @@ void SDL_PauseAudio (int pause_on)
 	}
 }
 
+void SDL_SetAudioCallbackFills (int fills_on)
+{
+	callback_fills = fills_on;
+}
+
 void SDL_LockAudio (void)
 {
 	SDL_AudioDevice *audio = current_audio;
@@ -649,18 +772,21 @@ void SDL_AudioQuit(void)
 		audio->free(audio);
 		current_audio = NULL;
 	}
+	SDL_QuitVoices();
 }
 
-#define NUM_FORMATS	6
+#define NUM_FORMATS	8
 static int format_idx;
 static int format_idx_sub;
 static Uint16 format_list[NUM_FORMATS][NUM_FORMATS] = {
- { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB },
- { AUDIO_S8, AUDIO_U8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB },
- { AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U8, AUDIO_S8 },
- { AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S8, AUDIO_U8, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_F32LSB, AUDIO_F32MSB },
+ { AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_F32LSB, AUDIO_F32MSB, AUDIO_S16LSB, AUDIO_S16MSB, AUDIO_U16LSB, AUDIO_U16MSB, AUDIO_U8, AUDIO_S8 },
+ { AUDIO_F32MSB, AUDIO_F32LSB, AUDIO_S16MSB, AUDIO_S16LSB, AUDIO_U16MSB, AUDIO_U16LSB, AUDIO_U8, AUDIO_S8 },
 };
 
 Uint16 SDL_FirstAudioFormat(Uint16 format)
@@ -30,5 +30,8 @@ extern Uint16 SDL_NextAudioFormat(void);
 /* Function to calculate the size and silence for a SDL_AudioSpec */
 extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 
+/* Release the voices of the voice mixer */
+extern void SDL_QuitVoices(void);
+
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
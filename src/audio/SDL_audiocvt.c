@@ -24,6 +24,17 @@
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
 #include "SDL_audio.h"
+#include "SDL_endian.h"
+#include "SDL_resample_c.h"
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_FLOAT	1
+#include <emmintrin.h>
+#elif SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && \
+      (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define NEON_FLOAT	1
+#include <arm_neon.h>
+#endif
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -372,7 +383,18 @@ void SDLCALL SDL_ConvertStereo(SDL_AudioCVT *cvt, Uint16 format)
 #ifdef DEBUG_CONVERT
 	fprintf(stderr, "Converting to stereo\n");
 #endif
-	if ( (format & 0xFF) == 16 ) {
+	if ( (format & 0xFF) == 32 ) {
+		Uint32 *src, *dst;
+
+		src = (Uint32 *)(cvt->buf+cvt->len_cvt);
+		dst = (Uint32 *)(cvt->buf+cvt->len_cvt*2);
+		for ( i=cvt->len_cvt/4; i; --i ) {
+			dst -= 2;
+			src -= 1;
+			dst[0] = src[0];
+			dst[1] = src[0];
+		}
+	} else if ( (format & 0xFF) == 16 ) {
 		Uint16 *src, *dst;
 
 		src = (Uint16 *)(cvt->buf+cvt->len_cvt);
@@ -417,7 +439,7 @@ void SDLCALL SDL_ConvertSurround(SDL_AudioCVT *cvt, Uint16 format)
 
 			src = (Uint8 *)(cvt->buf+cvt->len_cvt);
 			dst = (Uint8 *)(cvt->buf+cvt->len_cvt*3);
-			for ( i=cvt->len_cvt; i; --i ) {
+			for ( i=cvt->len_cvt/2; i; --i ) {
 				dst -= 6;
 				src -= 2;
 				lf = src[0];
@@ -438,7 +460,7 @@ void SDLCALL SDL_ConvertSurround(SDL_AudioCVT *cvt, Uint16 format)
 
 			src = (Sint8 *)cvt->buf+cvt->len_cvt;
 			dst = (Sint8 *)cvt->buf+cvt->len_cvt*3;
-			for ( i=cvt->len_cvt; i; --i ) {
+			for ( i=cvt->len_cvt/2; i; --i ) {
 				dst -= 6;
 				src -= 2;
 				lf = src[0];
@@ -594,7 +616,7 @@ void SDLCALL SDL_ConvertSurround_4(SDL_AudioCVT *cvt, Uint16 format)
 
 			src = (Uint8 *)(cvt->buf+cvt->len_cvt);
 			dst = (Uint8 *)(cvt->buf+cvt->len_cvt*2);
-			for ( i=cvt->len_cvt; i; --i ) {
+			for ( i=cvt->len_cvt/2; i; --i ) {
 				dst -= 4;
 				src -= 2;
 				lf = src[0];
@@ -613,7 +635,7 @@ void SDLCALL SDL_ConvertSurround_4(SDL_AudioCVT *cvt, Uint16 format)
 
 			src = (Sint8 *)cvt->buf+cvt->len_cvt;
 			dst = (Sint8 *)cvt->buf+cvt->len_cvt*2;
-			for ( i=cvt->len_cvt; i; --i ) {
+			for ( i=cvt->len_cvt/2; i; --i ) {
 				dst -= 4;
 				src -= 2;
 				lf = src[0];
@@ -732,6 +754,135 @@ void SDLCALL SDL_ConvertSurround_4(SDL_AudioCVT *cvt, Uint16 format)
 }
 
 
+/* The channel stages for native float, which SDL_BuildAudioCVT() uses when
+   float audio changes channels, so it isn't squeezed through 16 bits.
+   They mix the same way as the 16-bit stages, without the truncation.
+ */
+static void SDLCALL SDL_ConvertMonoF32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	float *src, *dst;
+	int i;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float to mono\n");
+#endif
+	src = (float *)cvt->buf;
+	dst = (float *)cvt->buf;
+	for ( i=cvt->len_cvt/8; i; --i ) {
+		*dst = (src[0] + src[1]) * 0.5f;
+		src += 2;
+		dst += 1;
+	}
+	cvt->len_cvt /= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Keep the first two of six channels */
+static void SDLCALL SDL_ConvertStripF32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	float *src, *dst;
+	int i;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float down to stereo\n");
+#endif
+	src = (float *)cvt->buf;
+	dst = (float *)cvt->buf;
+	for ( i=cvt->len_cvt/24; i; --i ) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		src += 6;
+		dst += 2;
+	}
+	cvt->len_cvt /= 3;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Keep the first two of four channels */
+static void SDLCALL SDL_ConvertStrip_2F32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	float *src, *dst;
+	int i;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float down to quad\n");
+#endif
+	src = (float *)cvt->buf;
+	dst = (float *)cvt->buf;
+	for ( i=cvt->len_cvt/16; i; --i ) {
+		dst[0] = src[0];
+		dst[1] = src[1];
+		src += 4;
+		dst += 2;
+	}
+	cvt->len_cvt /= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Stereo to pseudo-5.1, laid out like SDL_ConvertSurround() does 16-bit */
+static void SDLCALL SDL_ConvertSurroundF32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	float *src, *dst, lf, rf, ce;
+	int i;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float stereo to surround\n");
+#endif
+	src = (float *)(cvt->buf+cvt->len_cvt);
+	dst = (float *)(cvt->buf+cvt->len_cvt*3);
+	for ( i=cvt->len_cvt/8; i; --i ) {
+		dst -= 6;
+		src -= 2;
+		lf = src[0];
+		rf = src[1];
+		ce = (lf * 0.5f) + (rf * 0.5f);
+		dst[0] = lf;
+		dst[1] = rf;
+		dst[2] = rf - ce;
+		dst[3] = lf - ce;
+		dst[4] = ce;
+		dst[5] = ce;
+	}
+	cvt->len_cvt *= 3;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Stereo to pseudo-4.0, laid out like SDL_ConvertSurround_4() does 16-bit */
+static void SDLCALL SDL_ConvertSurround_4F32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	float *src, *dst, lf, rf, ce;
+	int i;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float stereo to quad\n");
+#endif
+	src = (float *)(cvt->buf+cvt->len_cvt);
+	dst = (float *)(cvt->buf+cvt->len_cvt*2);
+	for ( i=cvt->len_cvt/8; i; --i ) {
+		dst -= 4;
+		src -= 2;
+		lf = src[0];
+		rf = src[1];
+		ce = (lf * 0.5f) + (rf * 0.5f);
+		dst[0] = lf;
+		dst[1] = rf;
+		dst[2] = rf - ce;
+		dst[3] = lf - ce;
+	}
+	cvt->len_cvt *= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
 /* Convert 8-bit to 16-bit - LSB */
 void SDLCALL SDL_Convert16LSB(SDL_AudioCVT *cvt, Uint16 format)
 {
@@ -798,7 +949,7 @@ void SDLCALL SDL_Convert8(SDL_AudioCVT *cvt, Uint16 format)
 		src += 2;
 		dst += 1;
 	}
-	format = ((format & ~0x9010) | AUDIO_U8);
+	format = ((format & ~0x1010) | AUDIO_U8);
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
 		cvt->filters[cvt->filter_index](cvt, format);
@@ -856,6 +1007,179 @@ void SDLCALL SDL_ConvertEndian(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* Toggle endianness of 32-bit samples */
+void SDLCALL SDL_ConvertEndian32(SDL_AudioCVT *cvt, Uint16 format)
+{
+	int i;
+	Uint32 *data;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting 32-bit audio endianness\n");
+#endif
+	data = (Uint32 *)cvt->buf;
+	for ( i=cvt->len_cvt/4; i; --i ) {
+		*data = SDL_Swap32(*data);
+		++data;
+	}
+	format = (format ^ 0x1000);
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Float samples are clamped to -1.0..1.0 and scaled by 32767, truncating,
+   on the way to 16-bit, and scaled by 1/32768 on the way back.  The vector
+   versions give exactly the same results.
+ */
+typedef union {
+	Uint32 u;
+	float f;
+} FloatBits;
+
+static __inline__ Sint16 FloatToS16(float f)
+{
+	if ( !(f <= 1.0f) ) {
+		f = 1.0f;
+	} else if ( f < -1.0f ) {
+		f = -1.0f;
+	}
+	return((Sint16)(f * 32767.0f));
+}
+
+/* Convert 32-bit float in 'format' byte order to native signed 16-bit */
+void SDLCALL SDL_ConvertFromFloat(SDL_AudioCVT *cvt, Uint16 format)
+{
+	const Uint32 *src;
+	Sint16 *dst;
+	int i, samples;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting float audio to 16-bit\n");
+#endif
+	src = (const Uint32 *)cvt->buf;
+	dst = (Sint16 *)cvt->buf;
+	samples = cvt->len_cvt / 4;
+	i = 0;
+	if ( format == AUDIO_F32SYS ) {
+#if SSE2_FLOAT
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minus_one = _mm_set1_ps(-1.0f);
+		const __m128 scale = _mm_set1_ps(32767.0f);
+
+		/* Each store only covers samples that were already loaded */
+		for ( ; i+8 <= samples; i += 8 ) {
+			__m128 a = _mm_loadu_ps((const float *)(src+i));
+			__m128 b = _mm_loadu_ps((const float *)(src+i+4));
+			a = _mm_max_ps(_mm_min_ps(a, one), minus_one);
+			b = _mm_max_ps(_mm_min_ps(b, one), minus_one);
+			_mm_storeu_si128((__m128i *)(dst+i), _mm_packs_epi32(
+				_mm_cvttps_epi32(_mm_mul_ps(a, scale)),
+				_mm_cvttps_epi32(_mm_mul_ps(b, scale))));
+		}
+#elif NEON_FLOAT
+		const float32x4_t one = vdupq_n_f32(1.0f);
+		const float32x4_t minus_one = vdupq_n_f32(-1.0f);
+
+		for ( ; i+8 <= samples; i += 8 ) {
+			float32x4_t a = vld1q_f32((const float *)(src+i));
+			float32x4_t b = vld1q_f32((const float *)(src+i+4));
+			a = vmaxq_f32(vminq_f32(a, one), minus_one);
+			b = vmaxq_f32(vminq_f32(b, one), minus_one);
+			vst1q_s16(dst+i, vcombine_s16(
+				vmovn_s32(vcvtq_s32_f32(vmulq_n_f32(a, 32767.0f))),
+				vmovn_s32(vcvtq_s32_f32(vmulq_n_f32(b, 32767.0f)))));
+		}
+#endif
+		for ( ; i<samples; ++i ) {
+			FloatBits sample;
+			sample.u = src[i];
+			dst[i] = FloatToS16(sample.f);
+		}
+	} else {
+		for ( ; i<samples; ++i ) {
+			FloatBits sample;
+			sample.u = SDL_Swap32(src[i]);
+			dst[i] = FloatToS16(sample.f);
+		}
+	}
+	cvt->len_cvt /= 2;
+	format = AUDIO_S16SYS;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
+/* Convert native signed 16-bit to 32-bit float in the target byte order */
+void SDLCALL SDL_ConvertToFloat(SDL_AudioCVT *cvt, Uint16 format)
+{
+	const Sint16 *src;
+	Uint32 *dst;
+	const float scale = 1.0f / 32768.0f;
+	int i, samples;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting 16-bit audio to float\n");
+#endif
+	src = (const Sint16 *)cvt->buf;
+	dst = (Uint32 *)cvt->buf;
+	samples = cvt->len_cvt / 2;
+	/* Float channel and rate stages after this one work in native order */
+	if ( cvt->filters[cvt->filter_index+1] ) {
+		format = AUDIO_F32SYS;
+	} else {
+		format = cvt->dst_format;
+	}
+
+	/* Work backwards, the output is twice the size of the input */
+	if ( format == AUDIO_F32SYS ) {
+		i = samples;
+#if SSE2_FLOAT || NEON_FLOAT
+		for ( ; i > (samples & ~7); --i ) {
+			FloatBits sample;
+			sample.f = (float)src[i-1] * scale;
+			dst[i-1] = sample.u;
+		}
+#endif
+#if SSE2_FLOAT
+		{
+			const __m128 vscale = _mm_set1_ps(scale);
+			for ( ; i > 0; i -= 8 ) {
+				__m128i x = _mm_loadu_si128((const __m128i *)(src+i-8));
+				__m128 lo = _mm_cvtepi32_ps(
+					_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+				__m128 hi = _mm_cvtepi32_ps(
+					_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+				_mm_storeu_ps((float *)(dst+i-8), _mm_mul_ps(lo, vscale));
+				_mm_storeu_ps((float *)(dst+i-4), _mm_mul_ps(hi, vscale));
+			}
+		}
+#elif NEON_FLOAT
+		for ( ; i > 0; i -= 8 ) {
+			int16x8_t x = vld1q_s16(src+i-8);
+			float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+			float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+			vst1q_f32((float *)(dst+i-8), vmulq_n_f32(lo, scale));
+			vst1q_f32((float *)(dst+i-4), vmulq_n_f32(hi, scale));
+		}
+#endif
+		for ( ; i > 0; --i ) {
+			FloatBits sample;
+			sample.f = (float)src[i-1] * scale;
+			dst[i-1] = sample.u;
+		}
+	} else {
+		for ( i=samples; i > 0; --i ) {
+			FloatBits sample;
+			sample.f = (float)src[i-1] * scale;
+			dst[i-1] = SDL_Swap32(sample.u);
+		}
+	}
+	cvt->len_cvt *= 2;
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, format);
+	}
+}
+
 /* Convert rate up by multiple of 2 */
 void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
 {
@@ -886,6 +1210,18 @@ void SDLCALL SDL_RateMUL2(SDL_AudioCVT *cvt, Uint16 format)
 				dst[3] = src[1];
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/4; i; --i ) {
+				src32 -= 1;
+				dst32 -= 2;
+				dst32[0] = src32[0];
+				dst32[1] = src32[0];
+			}
+		}
+		break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -930,6 +1266,20 @@ void SDLCALL SDL_RateMUL2_c2(SDL_AudioCVT *cvt, Uint16 format)
 				dst[7] = src[3];
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				src32 -= 2;
+				dst32 -= 4;
+				dst32[0] = src32[0];
+				dst32[1] = src32[1];
+				dst32[2] = src32[0];
+				dst32[3] = src32[1];
+			}
+		}
+		break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -985,6 +1335,24 @@ void SDLCALL SDL_RateMUL2_c4(SDL_AudioCVT *cvt, Uint16 format)
 				dst[15] = src[7];
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/16; i; --i ) {
+				src32 -= 4;
+				dst32 -= 8;
+				dst32[0] = src32[0];
+				dst32[1] = src32[1];
+				dst32[2] = src32[2];
+				dst32[3] = src32[3];
+				dst32[4] = src32[0];
+				dst32[5] = src32[1];
+				dst32[6] = src32[2];
+				dst32[7] = src32[3];
+			}
+		}
+		break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1053,6 +1421,28 @@ void SDLCALL SDL_RateMUL2_c6(SDL_AudioCVT *cvt, Uint16 format)
 				dst[23] = src[11];
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/24; i; --i ) {
+				src32 -= 6;
+				dst32 -= 12;
+				dst32[0] = src32[0];
+				dst32[1] = src32[1];
+				dst32[2] = src32[2];
+				dst32[3] = src32[3];
+				dst32[4] = src32[4];
+				dst32[5] = src32[5];
+				dst32[6] = src32[0];
+				dst32[7] = src32[1];
+				dst32[8] = src32[2];
+				dst32[9] = src32[3];
+				dst32[10] = src32[4];
+				dst32[11] = src32[5];
+			}
+		}
+		break;
 	}
 	cvt->len_cvt *= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1087,6 +1477,17 @@ void SDLCALL SDL_RateDIV2(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 2;
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/8; i; --i ) {
+				dst32[0] = src32[0];
+				src32 += 2;
+				dst32 += 1;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1125,6 +1526,18 @@ void SDLCALL SDL_RateDIV2_c2(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 4;
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/16; i; --i ) {
+				dst32[0] = src32[0];
+				dst32[1] = src32[1];
+				src32 += 4;
+				dst32 += 2;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1169,6 +1582,20 @@ void SDLCALL SDL_RateDIV2_c4(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 8;
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/32; i; --i ) {
+				dst32[0] = src32[0];
+				dst32[1] = src32[1];
+				dst32[2] = src32[2];
+				dst32[3] = src32[3];
+				src32 += 8;
+				dst32 += 4;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1218,6 +1645,22 @@ void SDLCALL SDL_RateDIV2_c6(SDL_AudioCVT *cvt, Uint16 format)
 				dst += 12;
 			}
 			break;
+		case 32: {
+			Uint32 *src32 = (Uint32 *)src;
+			Uint32 *dst32 = (Uint32 *)dst;
+
+			for ( i=cvt->len_cvt/48; i; --i ) {
+				dst32[0] = src32[0];
+				dst32[1] = src32[1];
+				dst32[2] = src32[2];
+				dst32[3] = src32[3];
+				dst32[4] = src32[4];
+				dst32[5] = src32[5];
+				src32 += 12;
+				dst32 += 6;
+			}
+		}
+		break;
 	}
 	cvt->len_cvt /= 2;
 	if ( cvt->filters[++cvt->filter_index] ) {
@@ -1300,6 +1743,400 @@ void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* Read one sample of the given format as signed 16-bit */
+static Sint16 DecodeSample(const Uint8 *src, Uint16 format)
+{
+	Uint16 sample;
+
+	if ( (format & 0xFF) == 8 ) {
+		sample = (Uint16)src[0] << 8;
+	} else if ( format & 0x1000 ) {
+		sample = ((Uint16)src[0] << 8) | src[1];
+	} else {
+		sample = ((Uint16)src[1] << 8) | src[0];
+	}
+	if ( !(format & 0x8000) ) {
+		sample ^= 0x8000;
+	}
+	return((Sint16)sample);
+}
+
+static void EncodeSample(Uint8 *dst, Sint16 value, Uint16 format)
+{
+	Uint16 sample = (Uint16)value;
+
+	if ( !(format & 0x8000) ) {
+		sample ^= 0x8000;
+	}
+	if ( (format & 0xFF) == 8 ) {
+		dst[0] = (Uint8)(sample >> 8);
+	} else if ( format & 0x1000 ) {
+		dst[0] = (Uint8)(sample >> 8);
+		dst[1] = (Uint8)sample;
+	} else {
+		dst[0] = (Uint8)sample;
+		dst[1] = (Uint8)(sample >> 8);
+	}
+}
+
+/* Run the filter on 16-bit or float rows */
+static void RunSINC(const SDL_ResampleFilter *filter, int is_float,
+			const Uint8 *in, int in_pitch, int channels,
+			int position, Uint8 *out, int out_frames)
+{
+	if ( is_float ) {
+		SDL_RunResampleFilterFloat(filter, (const float *)in, in_pitch,
+				channels, position, (float *)out, out_frames);
+	} else {
+		SDL_RunResampleFilter(filter, (const Sint16 *)in, in_pitch,
+				channels, position, (Sint16 *)out, out_frames);
+	}
+}
+
+/* Windowed-sinc rate conversion by any ratio, using the precomputed filter
+   of the given quality matching cvt->rate_incr.  The buffer is converted as
+   a whole, with the samples past either end taken to repeat the edge
+   samples.  The working copies of the input and output go at the end of
+   the buffer, which SDL_BuildAudioCVT() made room for in len_mult; they are
+   16-bit for integer formats and float for native float.
+ */
+static void RateSINC(SDL_AudioCVT *cvt, Uint16 format, int channels,
+							int quality)
+{
+	const SDL_ResampleFilter *filter;
+	const int is_float = ((format & 0xFF) == 32);
+	const int work = is_float ? sizeof(float) : sizeof(Sint16);
+	int size, sample, frames, clen, taps, lead, c, i, j, n;
+	int index, position, u;
+	Uint8 *planes, *out;
+	union {
+		Sint16 s16[SDL_RESAMPLE_MAX_TAPS * 6];
+		float f32[SDL_RESAMPLE_MAX_TAPS * 6];
+	} window;
+
+	filter = SDL_FindResampleFilter(cvt->rate_incr, quality);
+	sample = (format & 0xFF) / 8;
+	size = sample * channels;
+	frames = cvt->len_cvt / size;
+	if ( frames == 0 ) {
+		return;
+	}
+	clen = (int)((double)frames * filter->step_den / filter->step_num);
+	taps = filter->taps;
+	lead = taps/2 - 1;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting audio rate * %4.4f (%d taps)\n",
+		1.0/cvt->rate_incr, taps);
+#endif
+	/* One row per channel, followed by the interleaved output */
+	out = cvt->buf + cvt->len * cvt->len_mult - clen * channels * work;
+	planes = out - frames * channels * work;
+
+	for ( c=0; c<channels; ++c ) {
+		const Uint8 *src = cvt->buf + c * sample;
+		if ( is_float ) {
+			float *row = (float *)planes + c * frames;
+			for ( i=0; i<frames; ++i ) {
+				row[i] = *(const float *)src;
+				src += size;
+			}
+		} else {
+			Sint16 *row = (Sint16 *)planes + c * frames;
+			for ( i=0; i<frames; ++i ) {
+				row[i] = DecodeSample(src, format);
+				src += size;
+			}
+		}
+	}
+
+	/* Output frame j is filtered from the 'taps' frames starting at
+	   'index - lead', which runs past the ends of the rows for the first
+	   and last few frames.  Those are filtered one at a time from a copy
+	   of the window with the edge frames repeated.
+	 */
+	index = 0;
+	position = 0;
+	for ( j=0; j<clen; j+=n ) {
+		u = index - lead;
+		n = 0;
+		if ( u >= 0 ) {
+			/* Count the frames whose windows fit in the rows */
+			int next = index, pos = position;
+			while ( j+n < clen && next - lead + taps <= frames ) {
+				++n;
+				pos += filter->step_num;
+				next += pos / filter->step_den;
+				pos %= filter->step_den;
+			}
+			if ( n > 0 ) {
+				RunSINC(filter, is_float, planes + u * work,
+					frames, channels, position,
+					out + j * channels * work, n);
+				index = next;
+				position = pos;
+				continue;
+			}
+		}
+		for ( c=0; c<channels; ++c ) {
+			for ( i=0; i<taps; ++i ) {
+				int k = u + i;
+				if ( k < 0 ) {
+					k = 0;
+				} else if ( k >= frames ) {
+					k = frames - 1;
+				}
+				if ( is_float ) {
+					window.f32[c * taps + i] =
+					    ((float *)planes)[c * frames + k];
+				} else {
+					window.s16[c * taps + i] =
+					    ((Sint16 *)planes)[c * frames + k];
+				}
+			}
+		}
+		RunSINC(filter, is_float, (const Uint8 *)&window, taps,
+			channels, position, out + j * channels * work, 1);
+		n = 1;
+		position += filter->step_num;
+		index += position / filter->step_den;
+		position %= filter->step_den;
+	}
+
+	if ( is_float ) {
+		SDL_memmove(cvt->buf, out, clen * size);
+	} else {
+		for ( i=0; i<clen*channels; ++i ) {
+			EncodeSample(cvt->buf + i * sample,
+					((Sint16 *)out)[i], format);
+		}
+	}
+	cvt->len_cvt = clen * size;
+}
+
+#define RATE_SINC(name, channels, quality) \
+void SDLCALL name(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	RateSINC(cvt, format, channels, quality); \
+	if ( cvt->filters[++cvt->filter_index] ) { \
+		cvt->filters[cvt->filter_index](cvt, format); \
+	} \
+}
+
+RATE_SINC(SDL_RateSINC, 1, SDL_RESAMPLE_MEDIUM)
+RATE_SINC(SDL_RateSINC_c2, 2, SDL_RESAMPLE_MEDIUM)
+RATE_SINC(SDL_RateSINC_c4, 4, SDL_RESAMPLE_MEDIUM)
+RATE_SINC(SDL_RateSINC_c6, 6, SDL_RESAMPLE_MEDIUM)
+RATE_SINC(SDL_RateSINCBest, 1, SDL_RESAMPLE_BEST)
+RATE_SINC(SDL_RateSINCBest_c2, 2, SDL_RESAMPLE_BEST)
+RATE_SINC(SDL_RateSINCBest_c4, 4, SDL_RESAMPLE_BEST)
+RATE_SINC(SDL_RateSINCBest_c6, 6, SDL_RESAMPLE_BEST)
+
+#undef RATE_SINC
+
+/* Fused conversion: sign, endian, 8 <-> 16 bit, mono <-> stereo and power
+   of two rate conversion in a single pass over the buffer.  The kernels are
+   specialized for each combination of sample layout and channel count, and
+   give exactly the same output as running the separate filters in turn.
+ */
+#define FUSED_8		0
+#define FUSED_16LSB	1
+#define FUSED_16MSB	2
+
+static __inline__ Uint16 FusedLoad(const Uint8 *src, int kind)
+{
+	switch (kind) {
+	    case FUSED_8:
+		return((Uint16)src[0] << 8);
+	    case FUSED_16LSB:
+		return(((Uint16)src[1] << 8) | src[0]);
+	    default:
+		return(((Uint16)src[0] << 8) | src[1]);
+	}
+}
+
+static __inline__ void FusedStore(Uint8 *dst, Uint16 sample, int kind)
+{
+	switch (kind) {
+	    case FUSED_8:
+		dst[0] = (Uint8)(sample >> 8);
+		break;
+	    case FUSED_16LSB:
+		dst[0] = (Uint8)sample;
+		dst[1] = (Uint8)(sample >> 8);
+		break;
+	    default:
+		dst[0] = (Uint8)(sample >> 8);
+		dst[1] = (Uint8)sample;
+		break;
+	}
+}
+
+/* Average two channels the way SDL_ConvertMono does for the format */
+static __inline__ Uint16 FusedMix(Uint16 a, Uint16 b, int kind, int is_signed)
+{
+	if ( kind == FUSED_8 ) {
+		Uint8 a8 = (Uint8)(a >> 8);
+		Uint8 b8 = (Uint8)(b >> 8);
+		if ( is_signed ) {
+			return((Uint16)((Uint8)(((Sint8)a8 + (Sint8)b8) / 2) << 8));
+		}
+		return((Uint16)(((a8 + b8) / 2) << 8));
+	}
+	if ( is_signed ) {
+		return((Uint16)(((Sint16)a + (Sint16)b) / 2));
+	}
+	return((Uint16)((a + b) / 2));
+}
+
+/* Whether the filter after the current one is a windowed-sinc stage */
+static int SINCFollows(SDL_AudioCVT *cvt)
+{
+	void (SDLCALL *next)(SDL_AudioCVT *cvt, Uint16 format) =
+				cvt->filters[cvt->filter_index+1];
+
+	return(next == SDL_RateSINC || next == SDL_RateSINC_c2 ||
+	       next == SDL_RateSINC_c4 || next == SDL_RateSINC_c6 ||
+	       next == SDL_RateSINCBest || next == SDL_RateSINCBest_c2 ||
+	       next == SDL_RateSINCBest_c4 || next == SDL_RateSINCBest_c6);
+}
+
+static __inline__ void FusedConvert(SDL_AudioCVT *cvt,
+		int src_kind, int dst_kind, int src_channels, int dst_channels)
+{
+	const int src_size = (src_kind == FUSED_8 ? 1 : 2) * src_channels;
+	const int dst_size = (dst_kind == FUSED_8 ? 1 : 2) * dst_channels;
+	const int dst_sample = (dst_kind == FUSED_8 ? 1 : 2);
+	const Uint16 flip = (cvt->src_format ^ cvt->dst_format) & 0x8000;
+	const int is_signed = (cvt->dst_format & 0x8000) != 0;
+	int up = 1, down = 1;
+	int frames, clen, i, j;
+	const Uint8 *src;
+	Uint8 *dst;
+	Uint16 out[2];
+
+	/* The rate is only ours when no resampling stage follows */
+	if ( !SINCFollows(cvt) && cvt->rate_incr ) {
+		if ( cvt->rate_incr < 1.0 ) {
+			up = (int)(1.0 / cvt->rate_incr + 0.5);
+		} else {
+			down = (int)(cvt->rate_incr + 0.5);
+		}
+	}
+	frames = cvt->len_cvt / src_size;
+	clen = (frames / down) * up;
+
+#define FUSED_FRAME(in)	\
+	{ \
+		Uint16 s0 = FusedLoad(in, src_kind) ^ flip; \
+		if ( src_channels == 1 ) { \
+			out[0] = out[1] = s0; \
+		} else { \
+			Uint16 s1 = FusedLoad(in + src_size/2, src_kind) ^ flip; \
+			if ( dst_channels == 1 ) { \
+				out[0] = FusedMix(s0, s1, dst_kind, is_signed); \
+			} else { \
+				out[0] = s0; \
+				out[1] = s1; \
+			} \
+		} \
+	}
+
+	/* Work backwards when the output grows, so nothing is overwritten
+	   before it has been read
+	 */
+	if ( dst_size * up > src_size * down ) {
+		src = cvt->buf + (clen / up) * down * src_size;
+		dst = cvt->buf + clen * dst_size;
+		for ( i=clen/up; i; --i ) {
+			src -= down * src_size;
+			FUSED_FRAME(src);
+			for ( j=up; j; --j ) {
+				dst -= dst_size;
+				FusedStore(dst, out[0], dst_kind);
+				if ( dst_channels == 2 ) {
+					FusedStore(dst+dst_sample, out[1], dst_kind);
+				}
+			}
+		}
+	} else {
+		src = cvt->buf;
+		dst = cvt->buf;
+		for ( i=clen/up; i; --i ) {
+			FUSED_FRAME(src);
+			src += down * src_size;
+			for ( j=up; j; --j ) {
+				FusedStore(dst, out[0], dst_kind);
+				if ( dst_channels == 2 ) {
+					FusedStore(dst+dst_sample, out[1], dst_kind);
+				}
+				dst += dst_size;
+			}
+		}
+	}
+#undef FUSED_FRAME
+
+	cvt->len_cvt = clen * dst_size;
+}
+
+#define FUSED_KERNEL(name, src_kind, dst_kind, src_channels, dst_channels) \
+static void SDLCALL name(SDL_AudioCVT *cvt, Uint16 format) \
+{ \
+	FusedConvert(cvt, src_kind, dst_kind, src_channels, dst_channels); \
+	format = cvt->dst_format; \
+	if ( (format & 0xFF) == 32 ) { /* float comes after us */ \
+		format = AUDIO_S16SYS; \
+	} \
+	if ( cvt->filters[++cvt->filter_index] ) { \
+		cvt->filters[cvt->filter_index](cvt, format); \
+	} \
+}
+#define FUSED_KERNELS(name, src_kind, dst_kind) \
+	FUSED_KERNEL(name##_11, src_kind, dst_kind, 1, 1) \
+	FUSED_KERNEL(name##_12, src_kind, dst_kind, 1, 2) \
+	FUSED_KERNEL(name##_21, src_kind, dst_kind, 2, 1) \
+	FUSED_KERNEL(name##_22, src_kind, dst_kind, 2, 2)
+
+FUSED_KERNELS(SDL_Fused8to8, FUSED_8, FUSED_8)
+FUSED_KERNELS(SDL_Fused8to16LSB, FUSED_8, FUSED_16LSB)
+FUSED_KERNELS(SDL_Fused8to16MSB, FUSED_8, FUSED_16MSB)
+FUSED_KERNELS(SDL_Fused16LSBto8, FUSED_16LSB, FUSED_8)
+FUSED_KERNELS(SDL_Fused16LSBto16LSB, FUSED_16LSB, FUSED_16LSB)
+FUSED_KERNELS(SDL_Fused16LSBto16MSB, FUSED_16LSB, FUSED_16MSB)
+FUSED_KERNELS(SDL_Fused16MSBto8, FUSED_16MSB, FUSED_8)
+FUSED_KERNELS(SDL_Fused16MSBto16LSB, FUSED_16MSB, FUSED_16LSB)
+FUSED_KERNELS(SDL_Fused16MSBto16MSB, FUSED_16MSB, FUSED_16MSB)
+
+#define FUSED_ENTRY(name) { { name##_11, name##_12 }, { name##_21, name##_22 } }
+
+/* Indexed by source layout, target layout, and channel counts minus one */
+static void (SDLCALL * const fused_kernels[3][3][2][2])(SDL_AudioCVT *cvt,
+							Uint16 format) = {
+	{
+		FUSED_ENTRY(SDL_Fused8to8),
+		FUSED_ENTRY(SDL_Fused8to16LSB),
+		FUSED_ENTRY(SDL_Fused8to16MSB)
+	},
+	{
+		FUSED_ENTRY(SDL_Fused16LSBto8),
+		FUSED_ENTRY(SDL_Fused16LSBto16LSB),
+		FUSED_ENTRY(SDL_Fused16LSBto16MSB)
+	},
+	{
+		FUSED_ENTRY(SDL_Fused16MSBto8),
+		FUSED_ENTRY(SDL_Fused16MSBto16LSB),
+		FUSED_ENTRY(SDL_Fused16MSBto16MSB)
+	}
+};
+
+static int FusedKind(Uint16 format)
+{
+	if ( (format & 0xFF) == 8 ) {
+		return(FUSED_8);
+	}
+	return((format & 0x1000) ? FUSED_16MSB : FUSED_16LSB);
+}
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1319,24 +2156,12 @@ int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 	return(0);
 }
 
-/* Creates a set of audio filters to convert from one format to another. 
-   Returns -1 if the format conversion is not supported, or 1 if the
-   audio filter is set up.
-*/
-  
-int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
-	Uint16 src_format, Uint8 src_channels, int src_rate,
-	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+/* Add the endian, sign and 8 <-> 16 bit filters between two integer
+   formats, in that order
+ */
+static void BuildFormatFilters(SDL_AudioCVT *cvt,
+			Uint16 src_format, Uint16 dst_format)
 {
-/*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
-		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
-	/* Start off with no conversion necessary */
-	cvt->needed = 0;
-	cvt->filter_index = 0;
-	cvt->filters[0] = NULL;
-	cvt->len_mult = 1;
-	cvt->len_ratio = 1.0;
-
 	/* First filter:  Endian conversion from src to dst */
 	if ( (src_format & 0x1000) != (dst_format & 0x1000)
 	     && ((src_format & 0xff) == 16) && ((dst_format & 0xff) == 16)) {
@@ -1370,6 +2195,76 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 				break;
 		}
 	}
+}
+
+/* Creates a set of audio filters to convert from one format to another. 
+   Returns -1 if the format conversion is not supported, or 1 if the
+   audio filter is set up.
+*/
+  
+int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	Uint8 in_channels = src_channels;
+	Uint16 in_format = src_format;
+	Uint16 out_format = dst_format;
+	Uint16 format;
+	int first, float_mix;
+	double fast_incr = 1.0;
+
+/*printf("Build format %04x->%04x, channels %u->%u, rate %d->%d\n",
+		src_format, dst_format, src_channels, dst_channels, src_rate, dst_rate);*/
+	/* Start off with no conversion necessary */
+	cvt->needed = 0;
+	cvt->filter_index = 0;
+	cvt->filters[0] = NULL;
+	cvt->len_mult = 1;
+	cvt->len_ratio = 1.0;
+	cvt->rate_incr = 0.0;
+
+	/* Float data only changing byte order is swapped as it is */
+	if ( (src_format & 0xFF) == 32 && (dst_format & 0xFF) == 32 &&
+	     src_channels == dst_channels &&
+	     (src_rate/100) == (dst_rate/100) ) {
+		if ( (src_format & 0x1000) != (dst_format & 0x1000) ) {
+			cvt->filters[cvt->filter_index++] = SDL_ConvertEndian32;
+		}
+		goto setup;
+	}
+
+	/* With float on either end, the channel and rate stages work on
+	   native float, so neither the float side nor the mixing loses
+	   anything to 16 bits.  Otherwise float is converted to 16-bit first
+	   and back to float at the end, with the integer stages in between.
+	 */
+	float_mix = ((src_format & 0xFF) == 32 || (dst_format & 0xFF) == 32) &&
+		    (src_channels != dst_channels ||
+		     (src_rate/100) != (dst_rate/100));
+	if ( float_mix ) {
+		if ( (src_format & 0xFF) != 32 ) {
+			BuildFormatFilters(cvt, src_format, AUDIO_S16SYS);
+			cvt->filters[cvt->filter_index++] = SDL_ConvertToFloat;
+			cvt->len_mult *= 2;
+			cvt->len_ratio *= 2;
+		} else if ( src_format != AUDIO_F32SYS ) {
+			cvt->filters[cvt->filter_index++] = SDL_ConvertEndian32;
+		}
+		format = AUDIO_F32SYS;
+		first = cvt->filter_index;
+	} else {
+		if ( (src_format & 0xFF) == 32 ) {
+			cvt->filters[cvt->filter_index++] = SDL_ConvertFromFloat;
+			cvt->len_ratio /= 2;
+			src_format = AUDIO_S16SYS;
+		}
+		if ( (dst_format & 0xFF) == 32 ) {
+			dst_format = AUDIO_S16SYS;
+		}
+		first = cvt->filter_index;
+		BuildFormatFilters(cvt, src_format, dst_format);
+		format = dst_format;
+	}
 
 	/* Last filter:  Mono/Stereo conversion */
 	if ( src_channels != dst_channels ) {
@@ -1383,6 +2278,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		if ( (src_channels == 2) &&
 				(dst_channels == 6) ) {
 			cvt->filters[cvt->filter_index++] =
+						 float_mix ? SDL_ConvertSurroundF32 :
 						 SDL_ConvertSurround;
 			src_channels = 6;
 			cvt->len_mult *= 3;
@@ -1391,6 +2287,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		if ( (src_channels == 2) &&
 				(dst_channels == 4) ) {
 			cvt->filters[cvt->filter_index++] =
+						 float_mix ? SDL_ConvertSurround_4F32 :
 						 SDL_ConvertSurround_4;
 			src_channels = 4;
 			cvt->len_mult *= 2;
@@ -1406,6 +2303,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		if ( (src_channels == 6) &&
 				(dst_channels <= 2) ) {
 			cvt->filters[cvt->filter_index++] =
+						 float_mix ? SDL_ConvertStripF32 :
 						 SDL_ConvertStrip;
 			src_channels = 2;
 			cvt->len_ratio /= 3;
@@ -1413,6 +2311,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		if ( (src_channels == 6) &&
 				(dst_channels == 4) ) {
 			cvt->filters[cvt->filter_index++] =
+						 float_mix ? SDL_ConvertStrip_2F32 :
 						 SDL_ConvertStrip_2;
 			src_channels = 4;
 			cvt->len_ratio /= 2;
@@ -1424,6 +2323,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 		while ( ((src_channels%2) == 0) &&
 				((src_channels/2) >= dst_channels) ) {
 			cvt->filters[cvt->filter_index++] =
+						 float_mix ? SDL_ConvertMonoF32 :
 						 SDL_ConvertMono;
 			src_channels /= 2;
 			cvt->len_ratio /= 2;
@@ -1434,74 +2334,159 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	}
 
 	/* Do rate conversion */
-	cvt->rate_incr = 0.0;
 	if ( (src_rate/100) != (dst_rate/100) ) {
 		Uint32 hi_rate, lo_rate;
-		int len_mult;
+		int len_mult, quality;
 		double len_ratio;
 		void (SDLCALL *rate_cvt)(SDL_AudioCVT *cvt, Uint16 format);
 
-		if ( src_rate > dst_rate ) {
-			hi_rate = src_rate;
-			lo_rate = dst_rate;
-			switch (src_channels) {
-				case 1: rate_cvt = SDL_RateDIV2; break;
-				case 2: rate_cvt = SDL_RateDIV2_c2; break;
-				case 4: rate_cvt = SDL_RateDIV2_c4; break;
-				case 6: rate_cvt = SDL_RateDIV2_c6; break;
-				default: return -1;
-			}
-			len_mult = 1;
-			len_ratio = 0.5;
-		} else {
-			hi_rate = dst_rate;
-			lo_rate = src_rate;
-			switch (src_channels) {
-				case 1: rate_cvt = SDL_RateMUL2; break;
-				case 2: rate_cvt = SDL_RateMUL2_c2; break;
-				case 4: rate_cvt = SDL_RateMUL2_c4; break;
-				case 6: rate_cvt = SDL_RateMUL2_c6; break;
-				default: return -1;
-			}
-			len_mult = 2;
-			len_ratio = 2.0;
-		}
-		/* If hi_rate = lo_rate*2^x then conversion is easy */
-		while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
+		/* Power of two ratios use the fast doubling and halving
+		   stages unless a resampler quality was asked for, other
+		   ratios go through the windowed-sinc stage.
+		 */
+		quality = SDL_GetResampleQuality(-1);
+		if ( quality != SDL_RESAMPLE_FAST ) {
+			hi_rate = SDL_max(src_rate, dst_rate);
+			lo_rate = SDL_min(src_rate, dst_rate);
+			while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
+				lo_rate *= 2;
+			}
+			if ( quality < 0 && (lo_rate/100) == (hi_rate/100) ) {
+				quality = SDL_RESAMPLE_FAST;
+			}
+		}
+		if ( quality != SDL_RESAMPLE_FAST ) {
+			if ( quality < 0 ) {
+				quality = SDL_RESAMPLE_MEDIUM;
+			}
+			if ( quality == SDL_RESAMPLE_MEDIUM ) {
+				switch (src_channels) {
+				    case 1: rate_cvt = SDL_RateSINC; break;
+				    case 2: rate_cvt = SDL_RateSINC_c2; break;
+				    case 4: rate_cvt = SDL_RateSINC_c4; break;
+				    case 6: rate_cvt = SDL_RateSINC_c6; break;
+				    default: return -1;
+				}
+			} else {
+				quality = SDL_RESAMPLE_BEST;
+				switch (src_channels) {
+				    case 1: rate_cvt = SDL_RateSINCBest; break;
+				    case 2: rate_cvt = SDL_RateSINCBest_c2; break;
+				    case 4: rate_cvt = SDL_RateSINCBest_c4; break;
+				    case 6: rate_cvt = SDL_RateSINCBest_c6; break;
+				    default: return -1;
+				}
+			}
+			/* The stage finds this filter again when it runs,
+			   and cached filters are never removed.
+			 */
+			if ( SDL_GetResampleFilter(src_rate, dst_rate,
+							quality) == NULL ) {
+				return -1;
+			}
+		}
+		if ( quality != SDL_RESAMPLE_FAST ) {
+			double in_len = cvt->len_ratio;
+			double out_len = in_len * dst_rate / src_rate;
+			int sample = (format & 0xFF) / 8;
+			int work = float_mix ? sizeof(float) : sizeof(Sint16);
+			int scratch_mult;
+
 			cvt->filters[cvt->filter_index++] = rate_cvt;
-			cvt->len_mult *= len_mult;
-			lo_rate *= 2;
-			cvt->len_ratio *= len_ratio;
-		}
-		/* We may need a slow conversion here to finish up */
-		if ( (lo_rate/100) != (hi_rate/100) ) {
-#if 1
-			/* The problem with this is that if the input buffer is
-			   say 1K, and the conversion rate is say 1.1, then the
-			   output buffer is 1.1K, which may not be an acceptable
-			   buffer size for the audio driver (not a power of 2)
-			*/
-			/* For now, punt and hope the rate distortion isn't great.
-			*/
-#else
-			if ( src_rate < dst_rate ) {
-				cvt->rate_incr = (double)lo_rate/hi_rate;
-				cvt->len_mult *= 2;
-				cvt->len_ratio /= cvt->rate_incr;
+			cvt->rate_incr = (double)src_rate / dst_rate;
+			cvt->len_mult *= (dst_rate + src_rate - 1) / src_rate;
+			cvt->len_ratio *= (double)dst_rate / src_rate;
+
+			/* Room for the working copies of the stage's input and
+			   output after the data, so it doesn't allocate.
+			 */
+			scratch_mult = (int)(SDL_max(in_len, out_len) +
+					(in_len + out_len) * work / sample) + 1;
+			if ( cvt->len_mult < scratch_mult ) {
+				cvt->len_mult = scratch_mult;
+			}
+		} else {
+			if ( src_rate > dst_rate ) {
+				hi_rate = src_rate;
+				lo_rate = dst_rate;
+				switch (src_channels) {
+					case 1: rate_cvt = SDL_RateDIV2; break;
+					case 2: rate_cvt = SDL_RateDIV2_c2; break;
+					case 4: rate_cvt = SDL_RateDIV2_c4; break;
+					case 6: rate_cvt = SDL_RateDIV2_c6; break;
+					default: return -1;
+				}
+				len_mult = 1;
+				len_ratio = 0.5;
 			} else {
-				cvt->rate_incr = (double)hi_rate/lo_rate;
-				cvt->len_ratio *= cvt->rate_incr;
+				hi_rate = dst_rate;
+				lo_rate = src_rate;
+				switch (src_channels) {
+					case 1: rate_cvt = SDL_RateMUL2; break;
+					case 2: rate_cvt = SDL_RateMUL2_c2; break;
+					case 4: rate_cvt = SDL_RateMUL2_c4; break;
+					case 6: rate_cvt = SDL_RateMUL2_c6; break;
+					default: return -1;
+				}
+				len_mult = 2;
+				len_ratio = 2.0;
 			}
-			cvt->filters[cvt->filter_index++] = SDL_RateSLOW;
-#endif
+			/* If hi_rate = lo_rate*2^x then conversion is easy */
+			while ( ((lo_rate*2)/100) <= (hi_rate/100) ) {
+				cvt->filters[cvt->filter_index++] = rate_cvt;
+				cvt->len_mult *= len_mult;
+				lo_rate *= 2;
+				cvt->len_ratio *= len_ratio;
+				fast_incr /= len_ratio;
+			}
+			/* Any remaining ratio is left unconverted here; the
+			   windowed-sinc stage handles it unless "fast" was
+			   explicitly requested.
+			 */
 		}
 	}
 
+	if ( float_mix ) {
+		if ( (out_format & 0xFF) != 32 ) {
+			cvt->filters[cvt->filter_index++] = SDL_ConvertFromFloat;
+			cvt->len_ratio /= 2;
+			BuildFormatFilters(cvt, AUDIO_S16SYS, out_format);
+		} else if ( out_format != AUDIO_F32SYS ) {
+			cvt->filters[cvt->filter_index++] = SDL_ConvertEndian32;
+		}
+		goto setup;
+	}
+
+	/* Mono and stereo conversions with more than one stage (not counting
+	   the windowed-sinc stage) are done in a single fused pass instead.
+	 */
+	if ( (in_channels == 1 || in_channels == 2) &&
+	     (dst_channels == 1 || dst_channels == 2) &&
+	     (cvt->filter_index - first - (cvt->rate_incr != 0.0)) > 1 ) {
+		int index = first;
+		if ( cvt->rate_incr != 0.0 ) {
+			cvt->filters[first+1] = cvt->filters[cvt->filter_index-1];
+			index = first+1;
+		} else {
+			cvt->rate_incr = fast_incr;
+		}
+		cvt->filters[first] = fused_kernels[FusedKind(src_format)]
+			[FusedKind(dst_format)][in_channels-1][dst_channels-1];
+		cvt->filter_index = index + 1;
+	}
+
+	if ( (out_format & 0xFF) == 32 ) {
+		cvt->filters[cvt->filter_index++] = SDL_ConvertToFloat;
+		cvt->len_mult *= 2;
+		cvt->len_ratio *= 2;
+	}
+
 	/* Set up the filter information */
+setup:
 	if ( cvt->filter_index != 0 ) {
 		cvt->needed = 1;
-		cvt->src_format = src_format;
-		cvt->dst_format = dst_format;
+		cvt->src_format = in_format;
+		cvt->dst_format = out_format;
 		cvt->len = 0;
 		cvt->buf = NULL;
 		cvt->filters[cvt->filter_index] = NULL;
@@ -0,0 +1,315 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Incremental audio conversion, built from SDL_AudioCVT filter chains for
+   the format and channel conversion and a stateful resampler in between.
+ */
+
+#include "SDL_audio.h"
+#include "SDL_resample_c.h"
+
+/* Input is converted in pieces of at most this many frames, which bounds
+   the size of the work buffers no matter how much is put at once.
+ */
+#define STREAM_CHUNK_FRAMES	1024
+
+struct SDL_AudioStream {
+	int src_frame;		/* bytes per source frame */
+	int dst_frame;		/* bytes per destination frame */
+	int mid_frame;		/* bytes per frame going through the resampler */
+
+	/* Source to destination, or to the resampler's format at the source
+	   rate when resampling, followed by that format at the destination
+	   rate to the destination format.  The resampler works on float if
+	   either end is float, and on 16-bit otherwise.
+	 */
+	SDL_AudioCVT cvt_in;
+	SDL_AudioCVT cvt_out;
+	int resample;
+	SDL_Resampler resampler;
+	Uint32 frames_in;	/* source frames resampled since the last flush */
+	Uint32 frames_out;	/* frames the resampler produced for those */
+
+	/* A source frame split across two SDL_AudioStreamPut() calls */
+	Uint8 partial[32];
+	int partial_len;
+
+	Uint8 *work;		/* one chunk of input, cvt_in works in here */
+	Uint8 *resampled;	/* resampler output, cvt_out works in here */
+
+	/* Converted data waiting to be read */
+	Uint8 *queue;
+	int queue_head;
+	int queue_len;
+	int queue_max;
+};
+
+SDL_AudioStream *SDL_NewAudioStream(
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	SDL_AudioStream *stream;
+	int work_len;
+
+	if ( src_channels == 0 || src_channels > 6 ||
+	     dst_channels == 0 || dst_channels > 6 ||
+	     src_rate <= 0 || dst_rate <= 0 ) {
+		SDL_SetError("Invalid audio stream parameters");
+		return(NULL);
+	}
+	stream = (SDL_AudioStream *)SDL_malloc(sizeof(*stream));
+	if ( stream == NULL ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	SDL_memset(stream, 0, sizeof(*stream));
+	stream->src_frame = ((src_format & 0xFF) / 8) * src_channels;
+	stream->dst_frame = ((dst_format & 0xFF) / 8) * dst_channels;
+	stream->resample = (src_rate != dst_rate);
+
+	if ( stream->resample ) {
+		/* Resample with as few channels as possible */
+		Uint8 mid_channels = SDL_min(src_channels, dst_channels);
+		Uint16 mid_format = AUDIO_S16SYS;
+		int max_output;
+
+		if ( (src_format & 0xFF) == 32 || (dst_format & 0xFF) == 32 ) {
+			mid_format = AUDIO_F32SYS;
+		}
+		stream->mid_frame = ((mid_format & 0xFF) / 8) * mid_channels;
+		if ( SDL_BuildAudioCVT(&stream->cvt_in,
+				src_format, src_channels, src_rate,
+				mid_format, mid_channels, src_rate) < 0 ||
+		     SDL_BuildAudioCVT(&stream->cvt_out,
+				mid_format, mid_channels, dst_rate,
+				dst_format, dst_channels, dst_rate) < 0 ) {
+			SDL_FreeAudioStream(stream);
+			return(NULL);
+		}
+		if ( SDL_InitResampler(&stream->resampler, mid_format,
+				mid_channels, src_rate, dst_rate,
+				SDL_GetResampleQuality(SDL_RESAMPLE_MEDIUM)) < 0 ) {
+			SDL_FreeAudioStream(stream);
+			return(NULL);
+		}
+		max_output = (int)((double)STREAM_CHUNK_FRAMES *
+				dst_rate / src_rate) + 2;
+		stream->resampled = (Uint8 *)SDL_malloc(max_output *
+			stream->mid_frame * stream->cvt_out.len_mult);
+		if ( stream->resampled == NULL ) {
+			SDL_FreeAudioStream(stream);
+			SDL_OutOfMemory();
+			return(NULL);
+		}
+	} else {
+		if ( SDL_BuildAudioCVT(&stream->cvt_in,
+				src_format, src_channels, src_rate,
+				dst_format, dst_channels, src_rate) < 0 ) {
+			SDL_FreeAudioStream(stream);
+			return(NULL);
+		}
+	}
+
+	work_len = STREAM_CHUNK_FRAMES * stream->src_frame *
+			stream->cvt_in.len_mult;
+	if ( stream->resample ) {
+		/* Flushing feeds silence in the resampler's format */
+		work_len = SDL_max(work_len,
+			STREAM_CHUNK_FRAMES * stream->mid_frame);
+	}
+	stream->work = (Uint8 *)SDL_malloc(work_len);
+	if ( stream->work == NULL ) {
+		SDL_FreeAudioStream(stream);
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	return(stream);
+}
+
+/* Append converted data to the output queue */
+static int Enqueue(SDL_AudioStream *stream, const Uint8 *data, int len)
+{
+	if ( stream->queue_head + stream->queue_len + len > stream->queue_max ) {
+		if ( stream->queue_head > 0 ) {
+			SDL_memmove(stream->queue,
+				stream->queue + stream->queue_head,
+				stream->queue_len);
+			stream->queue_head = 0;
+		}
+		if ( stream->queue_len + len > stream->queue_max ) {
+			int max = SDL_max(stream->queue_len + len,
+						stream->queue_max * 2);
+			Uint8 *queue = (Uint8 *)SDL_realloc(stream->queue, max);
+			if ( queue == NULL ) {
+				SDL_OutOfMemory();
+				return(-1);
+			}
+			stream->queue = queue;
+			stream->queue_max = max;
+		}
+	}
+	SDL_memcpy(stream->queue + stream->queue_head + stream->queue_len,
+			data, len);
+	stream->queue_len += len;
+	return(0);
+}
+
+/* Resample 'frames' frames in the work buffer and queue the result */
+static int ResampleChunk(SDL_AudioStream *stream, int frames)
+{
+	int written;
+
+	written = SDL_Resample(&stream->resampler, stream->work,
+				frames, stream->resampled);
+	if ( written < 0 ) {
+		return(-1);
+	}
+	stream->frames_out += written;
+
+	stream->cvt_out.buf = stream->resampled;
+	stream->cvt_out.len = written * stream->mid_frame;
+	SDL_ConvertAudio(&stream->cvt_out);
+	return(Enqueue(stream, stream->cvt_out.buf, stream->cvt_out.len_cvt));
+}
+
+/* Convert 'len' bytes of whole source frames in the work buffer */
+static int ConvertChunk(SDL_AudioStream *stream, int len)
+{
+	stream->cvt_in.buf = stream->work;
+	stream->cvt_in.len = len;
+	SDL_ConvertAudio(&stream->cvt_in);
+	if ( !stream->resample ) {
+		return(Enqueue(stream, stream->work, stream->cvt_in.len_cvt));
+	}
+	stream->frames_in += len / stream->src_frame;
+	return(ResampleChunk(stream,
+			stream->cvt_in.len_cvt / stream->mid_frame));
+}
+
+int SDL_AudioStreamPut(SDL_AudioStream *stream, const void *buf, int len)
+{
+	const Uint8 *src = (const Uint8 *)buf;
+	const int chunk = STREAM_CHUNK_FRAMES * stream->src_frame;
+
+	while ( len > 0 ) {
+		int total, whole, n;
+
+		/* Start the chunk with what's left of the last call */
+		n = SDL_min(len, chunk - stream->partial_len);
+		SDL_memcpy(stream->work, stream->partial, stream->partial_len);
+		SDL_memcpy(stream->work + stream->partial_len, src, n);
+		src += n;
+		len -= n;
+
+		total = stream->partial_len + n;
+		whole = total - (total % stream->src_frame);
+		stream->partial_len = total - whole;
+		SDL_memcpy(stream->partial, stream->work + whole,
+						stream->partial_len);
+
+		if ( whole > 0 && ConvertChunk(stream, whole) < 0 ) {
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+int SDL_AudioStreamGet(SDL_AudioStream *stream, void *buf, int len)
+{
+	len = SDL_min(len, stream->queue_len);
+	len -= (len % stream->dst_frame);
+	SDL_memcpy(buf, stream->queue + stream->queue_head, len);
+	stream->queue_head += len;
+	stream->queue_len -= len;
+	if ( stream->queue_len == 0 ) {
+		stream->queue_head = 0;
+	}
+	return(len);
+}
+
+int SDL_AudioStreamAvailable(SDL_AudioStream *stream)
+{
+	return(stream->queue_len);
+}
+
+int SDL_AudioStreamFlush(SDL_AudioStream *stream)
+{
+	if ( stream->resample ) {
+		const SDL_Resampler *resampler = &stream->resampler;
+		Uint32 expected, extra;
+
+		/* One output frame for every output position before the end
+		   of the input
+		 */
+		expected = (Uint32)((stream->frames_in * (double)
+			resampler->step_den + resampler->step_num - 1) /
+			resampler->step_num);
+
+		/* Push silence through until the filter has passed the end */
+		SDL_memset(stream->work, 0, resampler->taps * stream->mid_frame);
+		while ( stream->frames_out < expected ) {
+			if ( ResampleChunk(stream, resampler->taps) < 0 ) {
+				return(-1);
+			}
+		}
+		extra = (stream->frames_out - expected) * stream->dst_frame;
+		stream->queue_len -= SDL_min((int)extra, stream->queue_len);
+
+		SDL_ResetResampler(&stream->resampler);
+		stream->frames_in = 0;
+		stream->frames_out = 0;
+	}
+	stream->partial_len = 0;
+	return(0);
+}
+
+void SDL_AudioStreamClear(SDL_AudioStream *stream)
+{
+	if ( stream->resample ) {
+		SDL_ResetResampler(&stream->resampler);
+	}
+	stream->frames_in = 0;
+	stream->frames_out = 0;
+	stream->partial_len = 0;
+	stream->queue_head = 0;
+	stream->queue_len = 0;
+}
+
+void SDL_FreeAudioStream(SDL_AudioStream *stream)
+{
+	if ( stream ) {
+		if ( stream->resample ) {
+			SDL_FreeResampler(&stream->resampler);
+		}
+		if ( stream->work ) {
+			SDL_free(stream->work);
+		}
+		if ( stream->resampled ) {
+			SDL_free(stream->resampled);
+		}
+		if ( stream->queue ) {
+			SDL_free(stream->queue);
+		}
+		SDL_free(stream);
+	}
+}
@@ -30,6 +30,7 @@
 #include "SDL_mixer_MMX.h"
 #include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
+#include "SDL_mixer_SIMD.h"
 
 /* This table is used to add two sound values together and pin
  * the value to avoid overflow.  (used with permission from ARDI)
@@ -90,6 +91,57 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
+/* Vector versions of the loops below, picked the first time we mix.
+   They stop at the last whole vector and leave the rest to the C loop.
+ */
+typedef Uint32 (*SDL_MixFunc)(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+static int mixers_chosen = 0;
+static SDL_MixFunc mix_U8 = NULL;
+static SDL_MixFunc mix_S8 = NULL;
+static SDL_MixFunc mix_S16LSB = NULL;
+static SDL_MixFunc mix_S16MSB = NULL;
+static SDL_MixFunc mix_F32LSB = NULL;
+static SDL_MixFunc mix_F32MSB = NULL;
+
+static void SDL_ChooseMixers(void)
+{
+#if SDL_SSE2_MIXERS
+	if ( SDL_HasSSE2() ) {
+		mix_U8 = SDL_MixAudio_SSE2_U8;
+		mix_S8 = SDL_MixAudio_SSE2_S8;
+		mix_S16LSB = SDL_MixAudio_SSE2_S16LSB;
+		mix_S16MSB = SDL_MixAudio_SSE2_S16MSB;
+		mix_F32LSB = SDL_MixAudio_SSE2_F32LSB;
+		mix_F32MSB = SDL_MixAudio_SSE2_F32MSB;
+	}
+#if SDL_AVX2_MIXERS
+	if ( SDL_HasAVX2() ) {
+		mix_S16LSB = SDL_MixAudio_AVX2_S16LSB;
+		mix_S16MSB = SDL_MixAudio_AVX2_S16MSB;
+		mix_F32LSB = SDL_MixAudio_AVX2_F32LSB;
+		mix_F32MSB = SDL_MixAudio_AVX2_F32MSB;
+	}
+#endif
+#endif
+#if SDL_NEON_MIXERS
+	mix_U8 = SDL_MixAudio_NEON_U8;
+	mix_S8 = SDL_MixAudio_NEON_S8;
+	mix_S16LSB = SDL_MixAudio_NEON_S16LSB;
+	mix_S16MSB = SDL_MixAudio_NEON_S16MSB;
+	mix_F32LSB = SDL_MixAudio_NEON_F32LSB;
+	mix_F32MSB = SDL_MixAudio_NEON_F32MSB;
+#endif
+	mixers_chosen = 1;
+}
+
+#define MIX_VECTORS(mix) \
+	if ( mix && volume > 0 && volume <= SDL_MIX_MAXVOLUME ) { \
+		Uint32 done = mix(dst, src, len, volume); \
+		dst += done; \
+		src += done; \
+		len -= done; \
+	}
+
 void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
 	Uint16 format;
@@ -108,6 +160,9 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
   		/* HACK HACK HACK */
 		format = AUDIO_S16;
 	}
+	if ( !mixers_chosen ) {
+		SDL_ChooseMixers();
+	}
 	switch (format) {
 
 		case AUDIO_U8: {
@@ -116,6 +171,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 #else
 			Uint8 src_sample;
 
+			MIX_VECTORS(mix_U8);
 			while ( len-- ) {
 				src_sample = *src;
 				ADJUST_VOLUME_U8(src_sample, volume);
@@ -154,6 +210,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(8-1))-1);
 			const int min_audioval = -(1<<(8-1));
 
+			MIX_VECTORS(mix_S8);
 			src8 = (Sint8 *)src;
 			dst8 = (Sint8 *)dst;
 			while ( len-- ) {
@@ -202,6 +259,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
+			MIX_VECTORS(mix_S16LSB);
 			len /= 2;
 			while ( len-- ) {
 				src1 = ((src[1])<<8|src[0]);
@@ -234,6 +292,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
+			MIX_VECTORS(mix_S16MSB);
 			len /= 2;
 			while ( len-- ) {
 				src1 = ((src[0])<<8|src[1]);
@@ -256,6 +315,56 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 		}
 		break;
 
+		case AUDIO_F32LSB:
+		case AUDIO_F32MSB: {
+			const float fvolume = (float)volume / SDL_MIX_MAXVOLUME;
+			const int msb = (format == AUDIO_F32MSB);
+			union { Uint32 u; float f; } src1, src2;
+			float dst_sample;
+
+			if ( msb ) {
+				MIX_VECTORS(mix_F32MSB);
+			} else {
+				MIX_VECTORS(mix_F32LSB);
+			}
+			len /= 4;
+			while ( len-- ) {
+				if ( msb ) {
+					src1.u = ((Uint32)src[0]<<24)|(src[1]<<16)|
+					         (src[2]<<8)|src[3];
+					src2.u = ((Uint32)dst[0]<<24)|(dst[1]<<16)|
+					         (dst[2]<<8)|dst[3];
+				} else {
+					src1.u = ((Uint32)src[3]<<24)|(src[2]<<16)|
+					         (src[1]<<8)|src[0];
+					src2.u = ((Uint32)dst[3]<<24)|(dst[2]<<16)|
+					         (dst[1]<<8)|dst[0];
+				}
+				src += 4;
+				dst_sample = src1.f * fvolume + src2.f;
+				if ( dst_sample > 1.0f ) {
+					dst_sample = 1.0f;
+				} else
+				if ( dst_sample < -1.0f ) {
+					dst_sample = -1.0f;
+				}
+				src2.f = dst_sample;
+				if ( msb ) {
+					dst[0] = (Uint8)(src2.u >> 24);
+					dst[1] = (Uint8)(src2.u >> 16);
+					dst[2] = (Uint8)(src2.u >> 8);
+					dst[3] = (Uint8)src2.u;
+				} else {
+					dst[3] = (Uint8)(src2.u >> 24);
+					dst[2] = (Uint8)(src2.u >> 16);
+					dst[1] = (Uint8)(src2.u >> 8);
+					dst[0] = (Uint8)src2.u;
+				}
+				dst += 4;
+			}
+		}
+		break;
+
 		default: /* If this happens... FIXME! */
 			SDL_SetError("SDL_MixAudio(): unknown audio format");
 			return;
@@ -0,0 +1,493 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* SSE2, AVX2 and NEON versions of SDL_MixAudio
+
+   The volume scaling divides by SDL_MIX_MAXVOLUME rounding towards zero,
+   like the C version does, by biasing negative products before the shift.
+ */
+
+#include "SDL_audio.h"
+#include "SDL_mixer_SIMD.h"
+
+#if SDL_SSE2_MIXERS
+#include <emmintrin.h>
+
+/* (x * volume) / SDL_MIX_MAXVOLUME for four 32-bit products */
+static __inline__ __m128i ScaleProducts32(__m128i p)
+{
+	__m128i bias = _mm_srli_epi32(_mm_srai_epi32(p, 31), 25);
+	return _mm_srai_epi32(_mm_add_epi32(p, bias), 7);
+}
+
+/* (x * volume) / SDL_MIX_MAXVOLUME for eight 16-bit samples in -128..127 */
+static __inline__ __m128i ScaleSamples8(__m128i x, __m128i vol)
+{
+	__m128i p = _mm_mullo_epi16(x, vol);
+	__m128i bias = _mm_srli_epi16(_mm_srai_epi16(p, 15), 9);
+	return _mm_srai_epi16(_mm_add_epi16(p, bias), 7);
+}
+
+/* (x * volume) / SDL_MIX_MAXVOLUME for eight 16-bit samples */
+static __inline__ __m128i ScaleSamples16(__m128i x, __m128i vol)
+{
+	__m128i lo = _mm_mullo_epi16(x, vol);
+	__m128i hi = _mm_mulhi_epi16(x, vol);
+	return _mm_packs_epi32(ScaleProducts32(_mm_unpacklo_epi16(lo, hi)),
+	                       ScaleProducts32(_mm_unpackhi_epi16(lo, hi)));
+}
+
+static __inline__ __m128i Swap16(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+Uint32 SDL_MixAudio_SSE2_U8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i top = _mm_set1_epi16(0xFE);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i lo, hi;
+
+		/* mix8[d + s'] is d + s' - 128 clamped to 0..0xFE, and s' - 128
+		   is just the scaled signed sample
+		 */
+		lo = ScaleSamples8(_mm_sub_epi16(_mm_unpacklo_epi8(s, zero), bias), vol);
+		hi = ScaleSamples8(_mm_sub_epi16(_mm_unpackhi_epi8(s, zero), bias), vol);
+		lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(d, zero));
+		hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(d, zero));
+		lo = _mm_min_epi16(_mm_max_epi16(lo, zero), top);
+		hi = _mm_min_epi16(_mm_max_epi16(hi, zero), top);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_SSE2_S8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+		__m128i lo, hi;
+
+		/* Sign extend by shifting down from the high byte */
+		lo = ScaleSamples8(_mm_srai_epi16(_mm_unpacklo_epi8(s, s), 8), vol);
+		hi = ScaleSamples8(_mm_srai_epi16(_mm_unpackhi_epi8(s, s), 8), vol);
+		s = _mm_packs_epi16(lo, hi);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi8(s, d));
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_SSE2_S16LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+
+		s = ScaleSamples16(s, vol);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epi16(s, d));
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_SSE2_S16MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		__m128i s = Swap16(_mm_loadu_si128((const __m128i *)(src + i)));
+		__m128i d = Swap16(_mm_loadu_si128((const __m128i *)(dst + i)));
+
+		s = ScaleSamples16(s, vol);
+		_mm_storeu_si128((__m128i *)(dst + i), Swap16(_mm_adds_epi16(s, d)));
+	}
+	return i;
+}
+
+static __inline__ __m128i Swap32(__m128i x)
+{
+	x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+	return Swap16(x);
+}
+
+/* dst + src * volume / SDL_MIX_MAXVOLUME, clamped to -1.0..1.0 */
+static __inline__ __m128 MixFloats(__m128 d, __m128 s, __m128 vol)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minus_one = _mm_set1_ps(-1.0f);
+
+	d = _mm_add_ps(_mm_mul_ps(s, vol), d);
+	return _mm_min_ps(_mm_max_ps(d, minus_one), one);
+}
+
+Uint32 SDL_MixAudio_SSE2_F32LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m128 vol = _mm_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		__m128 s = _mm_loadu_ps((const float *)(src + i));
+		__m128 d = _mm_loadu_ps((const float *)(dst + i));
+
+		_mm_storeu_ps((float *)(dst + i), MixFloats(d, s, vol));
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_SSE2_F32MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m128 vol = _mm_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		__m128i s = Swap32(_mm_loadu_si128((const __m128i *)(src + i)));
+		__m128i d = Swap32(_mm_loadu_si128((const __m128i *)(dst + i)));
+		__m128 mixed;
+
+		mixed = MixFloats(_mm_castsi128_ps(d), _mm_castsi128_ps(s), vol);
+		_mm_storeu_si128((__m128i *)(dst + i),
+				Swap32(_mm_castps_si128(mixed)));
+	}
+	return i;
+}
+
+Uint32 SDL_MixVoice_SSE2_S16(Sint32 *mix, const Sint16 *src, Uint32 samples, int gain0, int gain1)
+{
+	const __m128i gain = _mm_set_epi16((short)gain1, (short)gain0,
+					(short)gain1, (short)gain0,
+					(short)gain1, (short)gain0,
+					(short)gain1, (short)gain0);
+	Uint32 i;
+
+	for ( i=0; i+8 <= samples; i += 8 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+		__m128i lo = _mm_mullo_epi16(s, gain);
+		__m128i hi = _mm_mulhi_epi16(s, gain);
+		__m128i m0 = _mm_loadu_si128((const __m128i *)(mix + i));
+		__m128i m1 = _mm_loadu_si128((const __m128i *)(mix + i + 4));
+
+		m0 = _mm_add_epi32(m0, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 7));
+		m1 = _mm_add_epi32(m1, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 7));
+		_mm_storeu_si128((__m128i *)(mix + i), m0);
+		_mm_storeu_si128((__m128i *)(mix + i + 4), m1);
+	}
+	return i;
+}
+
+#if SDL_AVX2_MIXERS
+/* The 16-bit and float mixers sixteen and eight samples at a time.  The
+   unpack and pack instructions work within each 128-bit half, so the
+   samples come back out in the order they went in. */
+#include <immintrin.h>
+
+#define AVX2_TARGET	__attribute__((target("avx2")))
+
+static __inline__ AVX2_TARGET __m256i ScaleProducts32AVX2(__m256i p)
+{
+	__m256i bias = _mm256_srli_epi32(_mm256_srai_epi32(p, 31), 25);
+	return _mm256_srai_epi32(_mm256_add_epi32(p, bias), 7);
+}
+
+static __inline__ AVX2_TARGET __m256i ScaleSamples16AVX2(__m256i x, __m256i vol)
+{
+	__m256i lo = _mm256_mullo_epi16(x, vol);
+	__m256i hi = _mm256_mulhi_epi16(x, vol);
+	return _mm256_packs_epi32(
+		ScaleProducts32AVX2(_mm256_unpacklo_epi16(lo, hi)),
+		ScaleProducts32AVX2(_mm256_unpackhi_epi16(lo, hi)));
+}
+
+static __inline__ AVX2_TARGET __m256i Swap16AVX2(__m256i x)
+{
+	return _mm256_or_si256(_mm256_slli_epi16(x, 8), _mm256_srli_epi16(x, 8));
+}
+
+static __inline__ AVX2_TARGET __m256i Swap32AVX2(__m256i x)
+{
+	const __m256i order = _mm256_set_epi8(
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+		12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+	return _mm256_shuffle_epi8(x, order);
+}
+
+/* See MixFloats(), there's no FMA here so the rounding is the same */
+static __inline__ AVX2_TARGET __m256 MixFloatsAVX2(__m256 d, __m256 s, __m256 vol)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 minus_one = _mm256_set1_ps(-1.0f);
+
+	d = _mm256_add_ps(_mm256_mul_ps(s, vol), d);
+	return _mm256_min_ps(_mm256_max_ps(d, minus_one), one);
+}
+
+AVX2_TARGET
+Uint32 SDL_MixAudio_AVX2_S16LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m256i vol = _mm256_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i=0; i+32 <= len; i += 32 ) {
+		__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+
+		s = ScaleSamples16AVX2(s, vol);
+		_mm256_storeu_si256((__m256i *)(dst + i), _mm256_adds_epi16(s, d));
+	}
+	return i;
+}
+
+AVX2_TARGET
+Uint32 SDL_MixAudio_AVX2_S16MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m256i vol = _mm256_set1_epi16((short)volume);
+	Uint32 i;
+
+	for ( i=0; i+32 <= len; i += 32 ) {
+		__m256i s = Swap16AVX2(_mm256_loadu_si256((const __m256i *)(src + i)));
+		__m256i d = Swap16AVX2(_mm256_loadu_si256((const __m256i *)(dst + i)));
+
+		s = ScaleSamples16AVX2(s, vol);
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				Swap16AVX2(_mm256_adds_epi16(s, d)));
+	}
+	return i;
+}
+
+AVX2_TARGET
+Uint32 SDL_MixAudio_AVX2_F32LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m256 vol = _mm256_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	Uint32 i;
+
+	for ( i=0; i+32 <= len; i += 32 ) {
+		__m256 s = _mm256_loadu_ps((const float *)(src + i));
+		__m256 d = _mm256_loadu_ps((const float *)(dst + i));
+
+		_mm256_storeu_ps((float *)(dst + i), MixFloatsAVX2(d, s, vol));
+	}
+	return i;
+}
+
+AVX2_TARGET
+Uint32 SDL_MixAudio_AVX2_F32MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const __m256 vol = _mm256_set1_ps((float)volume / SDL_MIX_MAXVOLUME);
+	Uint32 i;
+
+	for ( i=0; i+32 <= len; i += 32 ) {
+		__m256i s = Swap32AVX2(_mm256_loadu_si256((const __m256i *)(src + i)));
+		__m256i d = Swap32AVX2(_mm256_loadu_si256((const __m256i *)(dst + i)));
+		__m256 mixed;
+
+		mixed = MixFloatsAVX2(_mm256_castsi256_ps(d), _mm256_castsi256_ps(s), vol);
+		_mm256_storeu_si256((__m256i *)(dst + i),
+				Swap32AVX2(_mm256_castps_si256(mixed)));
+	}
+	return i;
+}
+#endif /* SDL_AVX2_MIXERS */
+#endif /* SDL_SSE2_MIXERS */
+
+#if SDL_NEON_MIXERS
+#include <arm_neon.h>
+
+static __inline__ int32x4_t ScaleProducts32_NEON(int32x4_t p)
+{
+	uint32x4_t bias = vshrq_n_u32(vreinterpretq_u32_s32(vshrq_n_s32(p, 31)), 25);
+	return vshrq_n_s32(vaddq_s32(p, vreinterpretq_s32_u32(bias)), 7);
+}
+
+static __inline__ int16x8_t ScaleSamples8_NEON(int16x8_t x, int16_t volume)
+{
+	int16x8_t p = vmulq_n_s16(x, volume);
+	uint16x8_t bias = vshrq_n_u16(vreinterpretq_u16_s16(vshrq_n_s16(p, 15)), 9);
+	return vshrq_n_s16(vaddq_s16(p, vreinterpretq_s16_u16(bias)), 7);
+}
+
+static __inline__ int16x8_t ScaleSamples16_NEON(int16x8_t x, int16_t volume)
+{
+	int32x4_t lo = ScaleProducts32_NEON(vmull_n_s16(vget_low_s16(x), volume));
+	int32x4_t hi = ScaleProducts32_NEON(vmull_n_s16(vget_high_s16(x), volume));
+	return vcombine_s16(vmovn_s32(lo), vmovn_s32(hi));
+}
+
+Uint32 SDL_MixAudio_NEON_U8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const int16x8_t zero = vdupq_n_s16(0);
+	const int16x8_t top = vdupq_n_s16(0xFE);
+	const int16x8_t bias = vdupq_n_s16(128);
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t d = vld1q_u8(dst + i);
+		int16x8_t lo, hi;
+
+		lo = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(s))), bias);
+		hi = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(s))), bias);
+		lo = vaddq_s16(ScaleSamples8_NEON(lo, (int16_t)volume),
+			vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(d))));
+		hi = vaddq_s16(ScaleSamples8_NEON(hi, (int16_t)volume),
+			vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(d))));
+		lo = vminq_s16(vmaxq_s16(lo, zero), top);
+		hi = vminq_s16(vmaxq_s16(hi, zero), top);
+		vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_NEON_S8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		int8x16_t s = vreinterpretq_s8_u8(vld1q_u8(src + i));
+		int8x16_t d = vreinterpretq_s8_u8(vld1q_u8(dst + i));
+		int16x8_t lo, hi;
+
+		lo = ScaleSamples8_NEON(vmovl_s8(vget_low_s8(s)), (int16_t)volume);
+		hi = ScaleSamples8_NEON(vmovl_s8(vget_high_s8(s)), (int16_t)volume);
+		s = vcombine_s8(vmovn_s16(lo), vmovn_s16(hi));
+		vst1q_u8(dst + i, vreinterpretq_u8_s8(vqaddq_s8(s, d)));
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_NEON_S16LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t d = vld1q_u8(dst + i);
+		int16x8_t mixed;
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		s = vrev16q_u8(s);
+		d = vrev16q_u8(d);
+#endif
+		mixed = vqaddq_s16(ScaleSamples16_NEON(vreinterpretq_s16_u8(s),
+				(int16_t)volume), vreinterpretq_s16_u8(d));
+		d = vreinterpretq_u8_s16(mixed);
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		d = vrev16q_u8(d);
+#endif
+		vst1q_u8(dst + i, d);
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_NEON_S16MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t d = vld1q_u8(dst + i);
+		int16x8_t mixed;
+
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		s = vrev16q_u8(s);
+		d = vrev16q_u8(d);
+#endif
+		mixed = vqaddq_s16(ScaleSamples16_NEON(vreinterpretq_s16_u8(s),
+				(int16_t)volume), vreinterpretq_s16_u8(d));
+		d = vreinterpretq_u8_s16(mixed);
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		d = vrev16q_u8(d);
+#endif
+		vst1q_u8(dst + i, d);
+	}
+	return i;
+}
+
+static __inline__ float32x4_t MixFloats_NEON(float32x4_t d, float32x4_t s, float volume)
+{
+	d = vaddq_f32(vmulq_n_f32(s, volume), d);
+	return vminq_f32(vmaxq_f32(d, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+}
+
+Uint32 SDL_MixAudio_NEON_F32LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const float vol = (float)volume / SDL_MIX_MAXVOLUME;
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t d = vld1q_u8(dst + i);
+		float32x4_t mixed;
+
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		s = vrev32q_u8(s);
+		d = vrev32q_u8(d);
+#endif
+		mixed = MixFloats_NEON(vreinterpretq_f32_u8(d),
+					vreinterpretq_f32_u8(s), vol);
+		d = vreinterpretq_u8_f32(mixed);
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		d = vrev32q_u8(d);
+#endif
+		vst1q_u8(dst + i, d);
+	}
+	return i;
+}
+
+Uint32 SDL_MixAudio_NEON_F32MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const float vol = (float)volume / SDL_MIX_MAXVOLUME;
+	Uint32 i;
+
+	for ( i=0; i+16 <= len; i += 16 ) {
+		uint8x16_t s = vld1q_u8(src + i);
+		uint8x16_t d = vld1q_u8(dst + i);
+		float32x4_t mixed;
+
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		s = vrev32q_u8(s);
+		d = vrev32q_u8(d);
+#endif
+		mixed = MixFloats_NEON(vreinterpretq_f32_u8(d),
+					vreinterpretq_f32_u8(s), vol);
+		d = vreinterpretq_u8_f32(mixed);
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		d = vrev32q_u8(d);
+#endif
+		vst1q_u8(dst + i, d);
+	}
+	return i;
+}
+#endif /* SDL_NEON_MIXERS */
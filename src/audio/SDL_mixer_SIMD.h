@@ -0,0 +1,69 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#include "SDL_stdinc.h"
+
+/* SSE2, AVX2 and NEON versions of SDL_MixAudio
+
+   Each function mixes as many whole vectors as fit in 'len' bytes and
+   returns the number of bytes it mixed, leaving the rest for the C loop.
+   The results are identical to the C version; the volume must be between
+   0 and SDL_MIX_MAXVOLUME.
+ */
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SDL_SSE2_MIXERS	1
+Uint32 SDL_MixAudio_SSE2_U8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_SSE2_S8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_SSE2_S16LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_SSE2_S16MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_SSE2_F32LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_SSE2_F32MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+
+/* Add (src[i] * gain[i & 1]) >> 7 to the 32-bit voice mixing buffer,
+   returning the number of samples done.
+ */
+Uint32 SDL_MixVoice_SSE2_S16(Sint32 *mix, const Sint16 *src, Uint32 samples, int gain0, int gain1);
+
+/* AVX2 versions of the 16-bit and float mixers, built whatever the
+   compiler flags and only to be called when SDL_HasAVX2() is true.
+ */
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define SDL_AVX2_MIXERS	1
+Uint32 SDL_MixAudio_AVX2_S16LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_AVX2_S16MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_AVX2_F32LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_AVX2_F32MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+#endif
+#endif
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && \
+    (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define SDL_NEON_MIXERS	1
+Uint32 SDL_MixAudio_NEON_U8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_NEON_S8(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_NEON_S16LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_NEON_S16MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_NEON_F32LSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+Uint32 SDL_MixAudio_NEON_F32MSB(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+#endif
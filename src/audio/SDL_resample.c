@@ -0,0 +1,642 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Polyphase windowed-sinc sample rate conversion */
+
+#include "SDL_audio.h"
+#include "SDL_mutex.h"
+#include "SDL_resample_c.h"
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_RESAMPLE	1
+#include <emmintrin.h>
+#endif
+
+#define PI		3.14159265358979323846
+
+/* Upper limit keeping the filter table below 128 KB */
+#define MAX_PHASES	256
+#define MAX_TAPS	SDL_RESAMPLE_MAX_TAPS
+
+/* Coefficients are stored as Q14 fixed point */
+#define FILTER_BITS	14
+
+/* Filters designed so far, shared by every converter using them.
+   SDL_AudioCVT has nowhere to hold a reference to its filter, so entries
+   are kept until the program exits; there are at most MAX_CACHED_FILTERS
+   of them, each below 128 KB.  New entries are added with the lock held
+   and only counted once they are complete, so the audio thread can look
+   them up without it.
+ */
+#define MAX_CACHED_FILTERS	16
+static SDL_ResampleFilter filter_cache[MAX_CACHED_FILTERS];
+static volatile int num_cached_filters = 0;
+static SDL_mutex * volatile filter_cache_lock = NULL;
+
+#if defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define MemoryBarrier()	__sync_synchronize()
+#else
+#define MemoryBarrier()
+#endif
+
+
+/* A small sine so the filter design doesn't need libm */
+static double Sine(double x)
+{
+	double term, sum, x2;
+	int i;
+
+	/* Reduce to [-PI/2, PI/2] */
+	x -= (2*PI) * (int)(x / (2*PI));
+	if ( x > PI ) {
+		x -= 2*PI;
+	} else if ( x < -PI ) {
+		x += 2*PI;
+	}
+	if ( x > PI/2 ) {
+		x = PI - x;
+	} else if ( x < -PI/2 ) {
+		x = -PI - x;
+	}
+
+	/* Taylor series, accurate to ~1e-12 on the reduced range */
+	x2 = x * x;
+	term = x;
+	sum = x;
+	for ( i=1; i<9; ++i ) {
+		term = -term * x2 / ((2*i) * (2*i+1));
+		sum += term;
+	}
+	return(sum);
+}
+
+static double Cosine(double x)
+{
+	return(Sine(x + PI/2));
+}
+
+static int GreatestCommonDivisor(int a, int b)
+{
+	while ( b ) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return(a);
+}
+
+/* Ideal low-pass impulse response at 'x' input samples from the center,
+   with the band edge at 'cutoff' times the input Nyquist frequency,
+   shaped by a Blackman window spanning 'half' samples on either side.
+ */
+static double WindowedSinc(double x, double cutoff, double half)
+{
+	double sinc, window;
+
+	if ( x <= -half || x >= half ) {
+		return(0.0);
+	}
+	if ( x == 0.0 ) {
+		sinc = cutoff;
+	} else {
+		sinc = Sine(PI * cutoff * x) / (PI * x);
+	}
+	window = 0.42 + 0.5 * Cosine(PI * x / half) +
+	         0.08 * Cosine(2 * PI * x / half);
+	return(sinc * window);
+}
+
+static int DesignFilter(SDL_ResampleFilter *filter,
+			int in_rate, int out_rate, int quality)
+{
+	double cutoff;
+	int gcd, taps, phase, i;
+
+	gcd = GreatestCommonDivisor(in_rate, out_rate);
+	filter->step_num = in_rate / gcd;
+	filter->step_den = out_rate / gcd;
+	filter->phases = SDL_min(filter->step_den, MAX_PHASES);
+
+	/* When downsampling, the band edge moves down to the output Nyquist
+	   frequency and the filter gets longer to keep the same steepness.
+	 */
+	cutoff = 1.0;
+	if ( out_rate < in_rate ) {
+		cutoff = (double)out_rate / in_rate;
+	}
+	switch (quality) {
+	    case SDL_RESAMPLE_FAST:
+		taps = 2;
+		break;
+	    case SDL_RESAMPLE_MEDIUM:
+		taps = (int)(16 / cutoff);
+		cutoff *= 0.90;
+		break;
+	    default:
+		quality = SDL_RESAMPLE_BEST;
+		taps = (int)(64 / cutoff);
+		cutoff *= 0.95;
+		break;
+	}
+	taps = SDL_min((taps + 1) & ~1, MAX_TAPS);
+	filter->quality = quality;
+	filter->taps = taps;
+
+	filter->coefs = (Sint16 *)SDL_malloc(
+			filter->phases * taps * sizeof(Sint16));
+	if ( filter->coefs == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+
+	for ( phase=0; phase<filter->phases; ++phase ) {
+		Sint16 *coef = &filter->coefs[phase * taps];
+		double frac = (double)phase / filter->phases;
+		double h[MAX_TAPS];
+		double sum = 0.0;
+		int total = 0;
+
+		for ( i=0; i<taps; ++i ) {
+			/* Distance from the output point, which lies 'frac'
+			   past the tap (taps/2 - 1)
+			 */
+			double x = (double)(i - (taps/2 - 1)) - frac;
+			if ( quality == SDL_RESAMPLE_FAST ) {
+				h[i] = (x < 0.0) ? 1.0 + x : 1.0 - x;
+			} else {
+				h[i] = WindowedSinc(x, cutoff, taps / 2);
+			}
+			sum += h[i];
+		}
+
+		/* Normalize each phase to unity gain, so DC passes exactly */
+		for ( i=0; i<taps; ++i ) {
+			double value = h[i] * (1 << FILTER_BITS) / sum;
+			coef[i] = (Sint16)(value < 0.0 ? value - 0.5 : value + 0.5);
+			total += coef[i];
+		}
+		coef[taps/2 - 1] += (1 << FILTER_BITS) - total;
+	}
+	return(0);
+}
+
+/* Inner product of one channel's window with one filter phase */
+static Sint32 DotProduct(const Sint16 *samples, const Sint16 *coefs, int taps)
+{
+	Sint32 sum = 0;
+	int i = 0;
+
+#if SSE2_RESAMPLE
+	if ( taps >= 8 ) {
+		__m128i acc = _mm_setzero_si128();
+		for ( ; i+8 <= taps; i += 8 ) {
+			__m128i s = _mm_loadu_si128((const __m128i *)&samples[i]);
+			__m128i c = _mm_loadu_si128((const __m128i *)&coefs[i]);
+			acc = _mm_add_epi32(acc, _mm_madd_epi16(s, c));
+		}
+		acc = _mm_add_epi32(acc,
+			_mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+		acc = _mm_add_epi32(acc,
+			_mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+		sum = _mm_cvtsi128_si32(acc);
+	}
+#endif
+	for ( ; i<taps; ++i ) {
+		sum += samples[i] * coefs[i];
+	}
+	return(sum);
+}
+
+/* The same for float samples, with the coefficients scaled back to 1.0 */
+static float DotProductFloat(const float *samples, const Sint16 *coefs,
+								int taps)
+{
+	float sum = 0.0f;
+	int i = 0;
+
+#if SSE2_RESAMPLE
+	if ( taps >= 8 ) {
+		__m128 acc = _mm_setzero_ps();
+		for ( ; i+8 <= taps; i += 8 ) {
+			__m128i c = _mm_loadu_si128((const __m128i *)&coefs[i]);
+			__m128 lo = _mm_cvtepi32_ps(
+				_mm_srai_epi32(_mm_unpacklo_epi16(c, c), 16));
+			__m128 hi = _mm_cvtepi32_ps(
+				_mm_srai_epi32(_mm_unpackhi_epi16(c, c), 16));
+			acc = _mm_add_ps(acc,
+				_mm_mul_ps(_mm_loadu_ps(&samples[i]), lo));
+			acc = _mm_add_ps(acc,
+				_mm_mul_ps(_mm_loadu_ps(&samples[i+4]), hi));
+		}
+		acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+		acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+		sum = _mm_cvtss_f32(acc);
+	}
+#endif
+	for ( ; i<taps; ++i ) {
+		sum += samples[i] * coefs[i];
+	}
+	return(sum * (1.0f / (1 << FILTER_BITS)));
+}
+
+/* The cache lock is created by whichever thread needs it first */
+static SDL_mutex *GetFilterCacheLock(void)
+{
+	if ( filter_cache_lock == NULL ) {
+		SDL_mutex *lock = SDL_CreateMutex();
+		if ( lock == NULL ) {
+			return(NULL);
+		}
+#if defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+		if ( !__sync_bool_compare_and_swap(&filter_cache_lock,
+							NULL, lock) ) {
+			SDL_DestroyMutex(lock);
+		}
+#else
+		filter_cache_lock = lock;
+#endif
+	}
+	return(filter_cache_lock);
+}
+
+static const SDL_ResampleFilter *LookupFilter(int step_num, int step_den,
+							int quality)
+{
+	int i, count;
+
+	count = num_cached_filters;
+	MemoryBarrier();	/* read the entries after the count */
+	for ( i=0; i<count; ++i ) {
+		const SDL_ResampleFilter *filter = &filter_cache[i];
+		if ( filter->step_num == step_num &&
+		     filter->step_den == step_den &&
+		     filter->quality == quality ) {
+			return(filter);
+		}
+	}
+	return(NULL);
+}
+
+const SDL_ResampleFilter *SDL_GetResampleFilter(int in_rate, int out_rate,
+							int quality)
+{
+	const SDL_ResampleFilter *filter;
+	SDL_mutex *lock;
+	int gcd;
+
+	if ( in_rate <= 0 || out_rate <= 0 ) {
+		SDL_SetError("Invalid resampler parameters");
+		return(NULL);
+	}
+	if ( quality != SDL_RESAMPLE_FAST && quality != SDL_RESAMPLE_MEDIUM ) {
+		quality = SDL_RESAMPLE_BEST;
+	}
+
+	gcd = GreatestCommonDivisor(in_rate, out_rate);
+	filter = LookupFilter(in_rate / gcd, out_rate / gcd, quality);
+	if ( filter ) {
+		return(filter);
+	}
+
+	lock = GetFilterCacheLock();
+	if ( lock == NULL ) {
+		return(NULL);
+	}
+	SDL_mutexP(lock);
+	/* Another thread may have designed it while we waited */
+	filter = LookupFilter(in_rate / gcd, out_rate / gcd, quality);
+	if ( filter == NULL ) {
+		if ( num_cached_filters == MAX_CACHED_FILTERS ) {
+			SDL_SetError("Too many resampling filters");
+		} else if ( DesignFilter(&filter_cache[num_cached_filters],
+					in_rate, out_rate, quality) == 0 ) {
+			filter = &filter_cache[num_cached_filters];
+			MemoryBarrier();	/* publish the entry first */
+			++num_cached_filters;
+		}
+	}
+	SDL_mutexV(lock);
+	return(filter);
+}
+
+const SDL_ResampleFilter *SDL_FindResampleFilter(double ratio, int quality)
+{
+	int i, count;
+
+	count = num_cached_filters;
+	MemoryBarrier();	/* read the entries after the count */
+	for ( i=0; i<count; ++i ) {
+		const SDL_ResampleFilter *filter = &filter_cache[i];
+		if ( filter->quality == quality &&
+		     (double)filter->step_num / filter->step_den == ratio ) {
+			return(filter);
+		}
+	}
+	return(NULL);
+}
+
+void SDL_RunResampleFilter(const SDL_ResampleFilter *filter,
+			const Sint16 *in, int in_pitch, int channels,
+			int position, Sint16 *out, int out_frames)
+{
+	const int taps = filter->taps;
+	const int step_num = filter->step_num;
+	const int step_den = filter->step_den;
+	const int phases = filter->phases;
+	int index = 0;
+	int c;
+
+	while ( out_frames-- ) {
+		const Sint16 *coef = filter->coefs +
+				(position * phases / step_den) * taps;
+
+		for ( c=0; c<channels; ++c ) {
+			Sint32 sum = DotProduct(in + c * in_pitch + index,
+							coef, taps);
+			sum = (sum + (1 << (FILTER_BITS-1))) >> FILTER_BITS;
+			if ( sum > 32767 ) {
+				sum = 32767;
+			} else if ( sum < -32768 ) {
+				sum = -32768;
+			}
+			*out++ = (Sint16)sum;
+		}
+
+		position += step_num;
+		index += position / step_den;
+		position %= step_den;
+	}
+}
+
+void SDL_RunResampleFilterFloat(const SDL_ResampleFilter *filter,
+			const float *in, int in_pitch, int channels,
+			int position, float *out, int out_frames)
+{
+	const int taps = filter->taps;
+	const int step_num = filter->step_num;
+	const int step_den = filter->step_den;
+	const int phases = filter->phases;
+	int index = 0;
+	int c;
+
+	while ( out_frames-- ) {
+		const Sint16 *coef = filter->coefs +
+				(position * phases / step_den) * taps;
+
+		for ( c=0; c<channels; ++c ) {
+			*out++ = DotProductFloat(in + c * in_pitch + index,
+							coef, taps);
+		}
+
+		position += step_num;
+		index += position / step_den;
+		position %= step_den;
+	}
+}
+
+int SDL_GetResampleQuality(int def)
+{
+	const char *env = SDL_getenv("SDL_AUDIO_RESAMPLER");
+
+	if ( env ) {
+		if ( SDL_strcasecmp(env, "fast") == 0 || *env == '0' ) {
+			return(SDL_RESAMPLE_FAST);
+		}
+		if ( SDL_strcasecmp(env, "medium") == 0 || *env == '1' ) {
+			return(SDL_RESAMPLE_MEDIUM);
+		}
+		if ( SDL_strcasecmp(env, "best") == 0 || *env == '2' ) {
+			return(SDL_RESAMPLE_BEST);
+		}
+	}
+	return(def);
+}
+
+int SDL_InitResampler(SDL_Resampler *resampler, Uint16 format,
+			int channels, int in_rate, int out_rate, int quality)
+{
+	const SDL_ResampleFilter *filter;
+
+	SDL_memset(resampler, 0, sizeof(*resampler));
+	if ( (format != AUDIO_S16SYS && format != AUDIO_F32SYS) ||
+	     channels <= 0 || in_rate <= 0 || out_rate <= 0 ) {
+		SDL_SetError("Invalid resampler parameters");
+		return(-1);
+	}
+
+	filter = SDL_GetResampleFilter(in_rate, out_rate, quality);
+	if ( filter == NULL ) {
+		/* The cache is full, design one just for this stream */
+		resampler->private_filter = (SDL_ResampleFilter *)
+			SDL_malloc(sizeof(*resampler->private_filter));
+		if ( resampler->private_filter == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		if ( DesignFilter(resampler->private_filter,
+					in_rate, out_rate, quality) < 0 ) {
+			SDL_free(resampler->private_filter);
+			resampler->private_filter = NULL;
+			return(-1);
+		}
+		filter = resampler->private_filter;
+	}
+
+	resampler->format = format;
+	resampler->sample_size = (format & 0xFF) / 8;
+	resampler->channels = channels;
+	resampler->in_rate = in_rate;
+	resampler->out_rate = out_rate;
+	resampler->step_num = filter->step_num;
+	resampler->step_den = filter->step_den;
+	resampler->taps = filter->taps;
+	resampler->phases = filter->phases;
+	resampler->filter = filter;
+
+	SDL_ResetResampler(resampler);
+	return(0);
+}
+
+void SDL_FreeResampler(SDL_Resampler *resampler)
+{
+	if ( resampler->private_filter ) {
+		SDL_free(resampler->private_filter->coefs);
+		SDL_free(resampler->private_filter);
+		resampler->private_filter = NULL;
+	}
+	resampler->filter = NULL;
+	if ( resampler->history ) {
+		SDL_free(resampler->history);
+		resampler->history = NULL;
+	}
+	resampler->history_frames = 0;
+	resampler->history_max = 0;
+}
+
+/* Make room for 'frames' frames of history, keeping the valid ones */
+static int GrowHistory(SDL_Resampler *resampler, int frames)
+{
+	const int size = resampler->sample_size;
+	Uint8 *history;
+	int c;
+
+	if ( frames <= resampler->history_max ) {
+		return(0);
+	}
+	history = (Uint8 *)SDL_malloc(frames * resampler->channels * size);
+	if ( history == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	if ( resampler->history ) {
+		for ( c=0; c<resampler->channels; ++c ) {
+			SDL_memcpy(history + c * frames * size,
+			       (Uint8 *)resampler->history +
+					c * resampler->history_max * size,
+			       resampler->history_frames * size);
+		}
+		SDL_free(resampler->history);
+	}
+	resampler->history = history;
+	resampler->history_max = frames;
+	return(0);
+}
+
+void SDL_ResetResampler(SDL_Resampler *resampler)
+{
+	/* Start with the first output point on the first input frame */
+	resampler->history_frames = 0;
+	resampler->position = 0;
+	resampler->skip = 0;
+	if ( resampler->taps > 2 ) {
+		int zeros = resampler->taps/2 - 1;
+		int c;
+
+		if ( GrowHistory(resampler, zeros) < 0 ) {
+			return;
+		}
+		/* All bits zero is 0.0f as well */
+		for ( c=0; c<resampler->channels; ++c ) {
+			SDL_memset((Uint8 *)resampler->history +
+				c * resampler->history_max *
+					resampler->sample_size,
+				0, zeros * resampler->sample_size);
+		}
+		resampler->history_frames = zeros;
+	}
+}
+
+int SDL_ResampleMaxOutput(SDL_Resampler *resampler, int in_frames)
+{
+	double span;
+	int frames;
+
+	frames = resampler->history_frames + in_frames - resampler->skip;
+	if ( frames < resampler->taps ) {
+		return(0);
+	}
+	span = (double)(frames - resampler->taps) * resampler->step_den -
+	       resampler->position;
+	return((int)(span / resampler->step_num) + 2);
+}
+
+int SDL_Resample(SDL_Resampler *resampler,
+			const void *in, int in_frames, void *out)
+{
+	const int channels = resampler->channels;
+	const int size = resampler->sample_size;
+	const int taps = resampler->taps;
+	const int step_num = resampler->step_num;
+	const int step_den = resampler->step_den;
+	int position = resampler->position;
+	int index, frames, written, pitch, c, i;
+	Uint8 *history;
+
+	/* Drop input that a large downsampling step already jumped over */
+	if ( resampler->skip ) {
+		int skip = SDL_min(resampler->skip, in_frames);
+		in = (const Uint8 *)in + skip * channels * size;
+		in_frames -= skip;
+		resampler->skip -= skip;
+	}
+
+	/* Append the new input to the history, one row per channel */
+	frames = resampler->history_frames + in_frames;
+	if ( GrowHistory(resampler, frames) < 0 ) {
+		return(-1);
+	}
+	history = (Uint8 *)resampler->history;
+	pitch = resampler->history_max;
+	for ( c=0; c<channels; ++c ) {
+		Uint8 *row = history +
+			(c * pitch + resampler->history_frames) * size;
+		if ( resampler->format == AUDIO_F32SYS ) {
+			const float *src = (const float *)in + c;
+			for ( i=0; i<in_frames; ++i ) {
+				((float *)row)[i] = src[i * channels];
+			}
+		} else {
+			const Sint16 *src = (const Sint16 *)in + c;
+			for ( i=0; i<in_frames; ++i ) {
+				((Sint16 *)row)[i] = src[i * channels];
+			}
+		}
+	}
+
+	/* Count the output frames that have all of their input */
+	index = 0;
+	written = 0;
+	while ( index + taps <= frames ) {
+		++written;
+		position += step_num;
+		index += position / step_den;
+		position %= step_den;
+	}
+	if ( resampler->format == AUDIO_F32SYS ) {
+		SDL_RunResampleFilterFloat(resampler->filter,
+				(const float *)history, pitch, channels,
+				resampler->position, (float *)out, written);
+	} else {
+		SDL_RunResampleFilter(resampler->filter,
+				(const Sint16 *)history, pitch, channels,
+				resampler->position, (Sint16 *)out, written);
+	}
+	resampler->position = position;
+
+	/* Keep the frames the filter still needs */
+	if ( index > frames ) {
+		resampler->skip = index - frames;
+		index = frames;
+	}
+	resampler->history_frames = frames - index;
+	if ( index > 0 && resampler->history_frames > 0 ) {
+		for ( c=0; c<channels; ++c ) {
+			SDL_memmove(history + c * pitch * size,
+				history + (c * pitch + index) * size,
+				resampler->history_frames * size);
+		}
+	}
+	return(written);
+}
@@ -0,0 +1,140 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+#ifndef _SDL_resample_c_h
+#define _SDL_resample_c_h
+
+/* Polyphase windowed-sinc sample rate converter for signed 16-bit or
+   float interleaved audio in native byte order.  The resampler keeps the
+   filter history between calls, so a stream can be converted in chunks of
+   any size without clicks at the chunk boundaries.
+ */
+
+#include "SDL_audio.h"
+
+/* Quality tiers, trading CPU for stopband attenuation */
+#define SDL_RESAMPLE_FAST	0	/* linear interpolation, 2 taps */
+#define SDL_RESAMPLE_MEDIUM	1	/* windowed sinc, 16 taps */
+#define SDL_RESAMPLE_BEST	2	/* windowed sinc, 64 taps */
+
+/* Downsampling lengthens the filters, up to this many taps */
+#define SDL_RESAMPLE_MAX_TAPS	256
+
+/* A designed filter: 'phases' rows of 'taps' Q14 coefficients, where the
+   output advances by 'step_num / step_den' input frames.  Filters are
+   cached and shared between all converters using the same ratio and
+   quality.
+ */
+typedef struct SDL_ResampleFilter {
+	int step_num;
+	int step_den;
+	int quality;
+	int taps;
+	int phases;
+	Sint16 *coefs;
+} SDL_ResampleFilter;
+
+typedef struct SDL_Resampler {
+	Uint16 format;		/* AUDIO_S16SYS or AUDIO_F32SYS */
+	int sample_size;
+	int channels;
+	int in_rate;
+	int out_rate;
+
+	/* The output advances by 'step_num / step_den' input frames */
+	int step_num;
+	int step_den;
+
+	/* Filter table, owned by the resampler if it didn't fit the cache */
+	int taps;
+	int phases;
+	const SDL_ResampleFilter *filter;
+	SDL_ResampleFilter *private_filter;
+
+	/* Input frames not yet fully consumed by the filter, one row of
+	   'history_max' samples per channel
+	 */
+	void *history;
+	int history_frames;	/* valid frames in 'history' */
+	int history_max;	/* allocated frames in 'history' */
+	int position;		/* fractional input position, 0..step_den-1 */
+	int skip;		/* input frames to drop before buffering */
+} SDL_Resampler;
+
+/* Returns the quality tier requested by the SDL_AUDIO_RESAMPLER
+   environment variable ("fast", "medium" or "best"), or 'def' if unset.
+ */
+extern int SDL_GetResampleQuality(int def);
+
+/* Returns the cached filter converting 'in_rate' to 'out_rate' at the
+   given quality, designing it if needed, or NULL if the cache is full.
+ */
+extern const SDL_ResampleFilter *SDL_GetResampleFilter(int in_rate,
+					int out_rate, int quality);
+
+/* Returns the cached filter of the given quality whose step matches
+   'ratio' (input frames per output frame), as used by the SDL_AudioCVT
+   rate stages, or NULL if SDL_GetResampleFilter() never designed it.
+   Cached filters are never removed, so this is safe on any thread.
+ */
+extern const SDL_ResampleFilter *SDL_FindResampleFilter(double ratio,
+							int quality);
+
+/* Filter 'out_frames' frames of planar 'in' into interleaved 'out'.
+   'in' holds 'channels' rows of 'in_pitch' samples, and must have
+   'filter->taps' valid samples starting at the window of each output frame.
+   The first output frame is centered 'position / step_den' frames past
+   sample 'taps/2 - 1'.
+ */
+extern void SDL_RunResampleFilter(const SDL_ResampleFilter *filter,
+			const Sint16 *in, int in_pitch, int channels,
+			int position, Sint16 *out, int out_frames);
+
+/* The same for float samples, which aren't clamped */
+extern void SDL_RunResampleFilterFloat(const SDL_ResampleFilter *filter,
+			const float *in, int in_pitch, int channels,
+			int position, float *out, int out_frames);
+
+/* Set up a resampler for AUDIO_S16SYS or AUDIO_F32SYS samples, returning 0,
+   or -1 if there was an error
+ */
+extern int SDL_InitResampler(SDL_Resampler *resampler, Uint16 format,
+			int channels, int in_rate, int out_rate, int quality);
+extern void SDL_FreeResampler(SDL_Resampler *resampler);
+
+/* Forget the carried-over history, as if the stream had just started */
+extern void SDL_ResetResampler(SDL_Resampler *resampler);
+
+/* Maximum number of output frames SDL_Resample() can produce from
+   'in_frames' input frames in the resampler's current state.
+ */
+extern int SDL_ResampleMaxOutput(SDL_Resampler *resampler, int in_frames);
+
+/* Consume 'in_frames' frames from 'in' and write the converted frames to
+   'out', which must hold SDL_ResampleMaxOutput() frames.  Returns the number
+   of frames written, or -1 if out of memory.
+ */
+extern int SDL_Resample(SDL_Resampler *resampler,
+			const void *in, int in_frames, void *out);
+
+#endif /* _SDL_resample_c_h */
@@ -59,6 +59,11 @@ struct SDL_AudioDevice {
 	void (*LockAudio)(_THIS);
 	void (*UnlockAudio)(_THIS);
 
+	/* * * */
+	/* Set by drivers that can be opened with AUDIO_F32 samples, the
+	   others are opened with AUDIO_S16SYS and the samples converted */
+	int plays_float;
+
 	/* * * */
 	/* Data common to all devices */
 
@@ -68,6 +73,9 @@ struct SDL_AudioDevice {
 	/* An audio conversion block for audio format emulation */
 	SDL_AudioCVT convert;
 
+	/* The format the application callback produces */
+	SDL_AudioSpec callback_spec;
+
 	/* Current state flags */
 	int enabled;
 	int paused;
@@ -0,0 +1,627 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* A voice mixer on top of the audio device: every playing voice is added
+   into one 32-bit buffer, which is clipped back to the output format once.
+   The buffer holds integers at 16-bit scale for the integer formats, and
+   floats for the float ones.
+ */
+
+#include "SDL_audio.h"
+#include "SDL_audio_c.h"
+#include "SDL_sysaudio.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_mixer_SIMD.h"
+
+/* The mixing loops are instantiated once per sample format */
+#if defined(__GNUC__)
+#define MIX_INLINE	__inline__ __attribute__((always_inline))
+#else
+#define MIX_INLINE	__inline__
+#endif
+
+typedef struct SDL_Voice {
+	int used;
+	int paused;
+	int finished;		/* a non-looping buffer voice reached its end */
+
+	/* Buffer voices */
+	const Uint8 *buf;
+	Uint32 frames;
+	int loop;
+
+	/* Streaming voices, which keep what they fetched but haven't played */
+	SDL_VoiceCallback callback;
+	void *userdata;
+	Uint8 *fetched;
+	Uint32 fetched_frames;
+	Uint32 fetched_max;
+
+	int volume;
+	int pan;
+	Uint32 step;		/* 16.16 input frames per output frame */
+	Uint32 position;	/* current input frame */
+	Uint32 fraction;	/* 16-bit fraction of a frame past 'position' */
+} SDL_Voice;
+
+typedef union {
+	Sint32 i;
+	float f;
+} MixSample;
+
+static SDL_Voice *voices = NULL;
+static int num_voices = 0;
+
+/* The intermediate sum */
+static MixSample *mix_buffer = NULL;
+static int mix_buffer_max = 0;
+
+#if SDL_SSE2_MIXERS
+static int use_sse2 = -1;
+#endif
+
+static SDL_Voice *GetVoice(int voice)
+{
+	if ( voice < 0 || voice >= num_voices || !voices[voice].used ) {
+		SDL_SetError("Invalid voice");
+		return(NULL);
+	}
+	return(&voices[voice]);
+}
+
+static int AllocVoice(void)
+{
+	SDL_Voice *voice;
+	int i;
+
+	for ( i=0; i<num_voices; ++i ) {
+		if ( !voices[i].used ) {
+			break;
+		}
+	}
+	if ( i == num_voices ) {
+		int max = num_voices ? num_voices * 2 : 16;
+		SDL_Voice *more = (SDL_Voice *)SDL_realloc(voices,
+						max * sizeof(*voices));
+		if ( more == NULL ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		SDL_memset(more + num_voices, 0,
+			(max - num_voices) * sizeof(*voices));
+		voices = more;
+		num_voices = max;
+	}
+
+	voice = &voices[i];
+	SDL_memset(voice, 0, sizeof(*voice));
+	voice->used = 1;
+	voice->paused = 1;
+	voice->volume = SDL_MIX_MAXVOLUME;
+	voice->step = SDL_VOICE_NORMALPITCH;
+	return(i);
+}
+
+static int FrameSize(void)
+{
+	if ( current_audio == NULL ) {
+		return(0);
+	}
+	return(((current_audio->callback_spec.format & 0xFF) / 8) *
+		current_audio->callback_spec.channels);
+}
+
+int SDL_CreateVoice(const Uint8 *buf, Uint32 len, int loop)
+{
+	int frame_size, voice;
+
+	SDL_LockAudio();
+	frame_size = FrameSize();
+	if ( frame_size == 0 ) {
+		SDL_UnlockAudio();
+		SDL_SetError("Audio device hasn't been opened");
+		return(-1);
+	}
+	voice = AllocVoice();
+	if ( voice >= 0 ) {
+		voices[voice].buf = buf;
+		voices[voice].frames = len / frame_size;
+		voices[voice].loop = loop;
+	}
+	SDL_UnlockAudio();
+	return(voice);
+}
+
+int SDL_CreateStreamingVoice(SDL_VoiceCallback callback, void *userdata)
+{
+	int voice;
+
+	SDL_LockAudio();
+	voice = AllocVoice();
+	if ( voice >= 0 ) {
+		voices[voice].callback = callback;
+		voices[voice].userdata = userdata;
+	}
+	SDL_UnlockAudio();
+	return(voice);
+}
+
+int SDL_SetVoiceVolume(int voice, int volume, int pan)
+{
+	SDL_Voice *v;
+
+	SDL_LockAudio();
+	v = GetVoice(voice);
+	if ( v ) {
+		v->volume = SDL_max(0, SDL_min(volume, SDL_MIX_MAXVOLUME));
+		v->pan = SDL_max(-SDL_MIX_MAXVOLUME,
+				SDL_min(pan, SDL_MIX_MAXVOLUME));
+	}
+	SDL_UnlockAudio();
+	return(v ? 0 : -1);
+}
+
+int SDL_SetVoicePitch(int voice, int pitch)
+{
+	SDL_Voice *v;
+
+	if ( pitch <= 0 ) {
+		SDL_SetError("Invalid voice pitch");
+		return(-1);
+	}
+	SDL_LockAudio();
+	v = GetVoice(voice);
+	if ( v ) {
+		v->step = (Uint32)pitch;
+	}
+	SDL_UnlockAudio();
+	return(v ? 0 : -1);
+}
+
+int SDL_PauseVoice(int voice, int pause_on)
+{
+	SDL_Voice *v;
+
+	SDL_LockAudio();
+	v = GetVoice(voice);
+	if ( v ) {
+		if ( !pause_on && v->finished ) {
+			v->finished = 0;
+			v->position = 0;
+			v->fraction = 0;
+		}
+		v->paused = pause_on;
+	}
+	SDL_UnlockAudio();
+	return(v ? 0 : -1);
+}
+
+int SDL_VoicePlaying(int voice)
+{
+	SDL_Voice *v;
+	int playing = 0;
+
+	SDL_LockAudio();
+	v = GetVoice(voice);
+	if ( v ) {
+		playing = (!v->paused && !v->finished);
+	}
+	SDL_UnlockAudio();
+	return(playing);
+}
+
+void SDL_FreeVoice(int voice)
+{
+	SDL_Voice *v;
+
+	SDL_LockAudio();
+	v = GetVoice(voice);
+	if ( v ) {
+		if ( v->fetched ) {
+			SDL_free(v->fetched);
+		}
+		SDL_memset(v, 0, sizeof(*v));
+	}
+	SDL_UnlockAudio();
+}
+
+void SDL_QuitVoices(void)
+{
+	int i;
+
+	for ( i=0; i<num_voices; ++i ) {
+		if ( voices[i].fetched ) {
+			SDL_free(voices[i].fetched);
+		}
+	}
+	if ( voices ) {
+		SDL_free(voices);
+		voices = NULL;
+	}
+	num_voices = 0;
+	if ( mix_buffer ) {
+		SDL_free(mix_buffer);
+		mix_buffer = NULL;
+	}
+	mix_buffer_max = 0;
+}
+
+static MIX_INLINE Sint32 ReadSample(const Uint8 *src, Uint16 format)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		return(((Sint32)src[0] - 128) << 8);
+	    case AUDIO_S8:
+		return((Sint32)(Sint8)src[0] << 8);
+	    case AUDIO_S16LSB:
+		return((Sint16)((src[1] << 8) | src[0]));
+	    default:
+		return((Sint16)((src[0] << 8) | src[1]));
+	}
+}
+
+static MIX_INLINE float ReadFloat(const Uint8 *src, Uint16 format)
+{
+	union {
+		Uint32 u;
+		float f;
+	} sample;
+
+	if ( format == AUDIO_F32LSB ) {
+		sample.u = ((Uint32)src[3] << 24) | ((Uint32)src[2] << 16) |
+			   ((Uint32)src[1] << 8) | src[0];
+	} else {
+		sample.u = ((Uint32)src[0] << 24) | ((Uint32)src[1] << 16) |
+			   ((Uint32)src[2] << 8) | src[3];
+	}
+	return(sample.f);
+}
+
+/* Add a sample scaled by 'gain' / SDL_MIX_MAXVOLUME to the mix */
+static MIX_INLINE void AddSample(MixSample *mix, const Uint8 *src,
+						Sint32 gain, Uint16 format)
+{
+	if ( (format & 0xFF) == 32 ) {
+		mix->f += ReadFloat(src, format) *
+				((float)gain / SDL_MIX_MAXVOLUME);
+	} else {
+		mix->i += (ReadSample(src, format) * gain) >> 7;
+	}
+}
+
+/* The same for the point 'fraction' / 65536 of the way from 'a' to 'b' */
+static MIX_INLINE void AddBetween(MixSample *mix, const Uint8 *a,
+		const Uint8 *b, Uint32 fraction, Sint32 gain, Uint16 format)
+{
+	if ( (format & 0xFF) == 32 ) {
+		float fa = ReadFloat(a, format);
+		float fb = ReadFloat(b, format);
+		float s = fa + (fb - fa) * ((float)fraction / 65536.0f);
+		mix->f += s * ((float)gain / SDL_MIX_MAXVOLUME);
+	} else {
+		Sint32 sa = ReadSample(a, format);
+		Sint32 sb = ReadSample(b, format);
+		Sint32 s = sa + (((sb - sa) * (Sint32)(fraction >> 1)) >> 15);
+		mix->i += (s * gain) >> 7;
+	}
+}
+
+/* Add 'frames' frames of a voice to the mix, reading from 'data', which
+   holds 'total' frames.  Returns 0 if the voice ran out of data.
+ */
+static MIX_INLINE int MixVoice(SDL_Voice *v, const Uint8 *data, Uint32 total,
+		int loop, MixSample *mix, int frames, int channels, Uint16 format)
+{
+	const int sample_size = (format & 0xFF) / 8;
+	const int frame_size = sample_size * channels;
+	const Uint32 step = v->step;
+	Uint32 position = v->position;
+	Uint32 fraction = v->fraction;
+	Sint32 gain[2];
+	int i, c;
+
+	/* Linear panning on each left/right pair */
+	gain[0] = gain[1] = v->volume;
+	if ( channels > 1 ) {
+		gain[0] = v->volume * (SDL_MIX_MAXVOLUME - SDL_max(v->pan, 0)) /
+				SDL_MIX_MAXVOLUME;
+		gain[1] = v->volume * (SDL_MIX_MAXVOLUME + SDL_min(v->pan, 0)) /
+				SDL_MIX_MAXVOLUME;
+	}
+
+	i = 0;
+	while ( i < frames ) {
+		const Uint8 *frame;
+
+		if ( position >= total ) {
+			if ( !loop || total == 0 ) {
+				break;
+			}
+			position %= total;
+		}
+		frame = data + position * frame_size;
+
+		if ( step == SDL_VOICE_NORMALPITCH && fraction == 0 ) {
+			/* Straight copy up to the end of the data.  Wider
+			   layouts alternate left and right, so sample 'n'
+			   always takes gain[n & 1].
+			 */
+			int run = SDL_min((Uint32)(frames - i), total - position);
+			int samples = run * channels;
+			int n = 0;
+
+#if SDL_SSE2_MIXERS
+			if ( format == AUDIO_S16SYS && use_sse2 ) {
+				n = SDL_MixVoice_SSE2_S16((Sint32 *)mix,
+					(const Sint16 *)frame, samples,
+					gain[0], gain[1]);
+				frame += n * sample_size;
+			}
+#endif
+			for ( ; n<samples; ++n ) {
+				AddSample(&mix[n], frame, gain[n & 1], format);
+				frame += sample_size;
+			}
+			mix += samples;
+			i += run;
+			position += run;
+			continue;
+		}
+
+		if ( position + 1 < total ) {
+			/* Interpolate every frame whose next frame is in the
+			   data, without checking for the end each time
+			 */
+			double span = (double)(total - 1 - position) * 65536.0 - fraction;
+			int run = (int)SDL_min((double)(frames - i), (span - 1) / step + 1);
+			int n;
+
+			for ( n=0; n<run; ++n ) {
+				const Uint8 *next;
+
+				frame = data + position * frame_size;
+				next = frame + frame_size;
+				for ( c=0; c<channels; ++c ) {
+					AddBetween(mix++, frame + c*sample_size,
+						next + c*sample_size, fraction,
+						gain[c & 1], format);
+				}
+				fraction += step;
+				position += fraction >> 16;
+				fraction &= 0xFFFF;
+			}
+			i += run;
+			continue;
+		}
+
+		/* The last frame, interpolating towards the start if looping */
+		if ( fraction == 0 ) {
+			for ( c=0; c<channels; ++c ) {
+				AddSample(mix++, frame + c*sample_size,
+						gain[c & 1], format);
+			}
+		} else {
+			/* Interpolate towards the next frame */
+			const Uint8 *next = frame + frame_size;
+			if ( position + 1 >= total ) {
+				next = loop ? data : frame;
+			}
+			for ( c=0; c<channels; ++c ) {
+				AddBetween(mix++, frame + c*sample_size,
+					next + c*sample_size, fraction,
+					gain[c & 1], format);
+			}
+		}
+
+		fraction += step;
+		position += fraction >> 16;
+		fraction &= 0xFFFF;
+		++i;
+	}
+	v->position = position;
+	v->fraction = fraction;
+	return(i == frames);
+}
+
+/* Make sure a streaming voice has fetched the input for 'frames' frames */
+static int FetchVoice(SDL_Voice *v, int frames, int frame_size)
+{
+	Uint32 needed, kept;
+
+	/* Keep the frames from the current position on */
+	kept = 0;
+	if ( v->position < v->fetched_frames ) {
+		kept = v->fetched_frames - v->position;
+		SDL_memmove(v->fetched, v->fetched + v->position * frame_size,
+						kept * frame_size);
+	}
+	v->position = 0;
+	v->fetched_frames = kept;
+
+	/* One extra frame to interpolate towards */
+	needed = ((v->fraction + (Uint32)(frames - 1) * v->step) >> 16) + 2;
+	if ( needed > v->fetched_max ) {
+		Uint8 *fetched = (Uint8 *)SDL_realloc(v->fetched,
+						needed * frame_size);
+		if ( fetched == NULL ) {
+			return(-1);
+		}
+		v->fetched = fetched;
+		v->fetched_max = needed;
+	}
+	if ( needed > kept ) {
+		v->callback(v->userdata, v->fetched + kept * frame_size,
+						(needed - kept) * frame_size);
+		v->fetched_frames = needed;
+	}
+	return(0);
+}
+
+static MIX_INLINE void MixVoices(MixSample *mix, int frames, int channels,
+							Uint16 format)
+{
+	const int frame_size = ((format & 0xFF) / 8) * channels;
+	int i;
+
+	for ( i=0; i<num_voices; ++i ) {
+		SDL_Voice *v = &voices[i];
+
+		if ( !v->used || v->paused || v->finished ) {
+			continue;
+		}
+		if ( v->callback ) {
+			if ( FetchVoice(v, frames, frame_size) == 0 ) {
+				MixVoice(v, v->fetched, v->fetched_frames, 0,
+					mix, frames, channels, format);
+			}
+		} else {
+			if ( !MixVoice(v, v->buf, v->frames, v->loop,
+					mix, frames, channels, format) ) {
+				v->finished = 1;
+			}
+		}
+	}
+}
+
+void SDL_MixVoices(Uint8 *stream, int len)
+{
+	Uint16 format;
+	int channels, sample_size, samples, i;
+	MixSample *mix;
+
+	if ( current_audio == NULL ) {
+		return;
+	}
+#if SDL_SSE2_MIXERS
+	if ( use_sse2 < 0 ) {
+		use_sse2 = SDL_HasSSE2();
+	}
+#endif
+	format = current_audio->callback_spec.format;
+	channels = current_audio->callback_spec.channels;
+	sample_size = (format & 0xFF) / 8;
+	if ( format != AUDIO_U8 && format != AUDIO_S8 &&
+	     format != AUDIO_S16LSB && format != AUDIO_S16MSB &&
+	     format != AUDIO_F32LSB && format != AUDIO_F32MSB ) {
+		SDL_SetError("SDL_MixVoices(): unknown audio format");
+		return;
+	}
+	samples = len / (sample_size * channels) * channels;
+
+	if ( samples > mix_buffer_max ) {
+		mix = (MixSample *)SDL_realloc(mix_buffer,
+					samples * sizeof(MixSample));
+		if ( mix == NULL ) {
+			SDL_OutOfMemory();
+			return;
+		}
+		mix_buffer = mix;
+		mix_buffer_max = samples;
+	}
+	mix = mix_buffer;
+
+	/* Start from what's already in the stream */
+	for ( i=0; i<samples; ++i ) {
+		if ( sample_size == 4 ) {
+			mix[i].f = ReadFloat(stream + i * sample_size, format);
+		} else {
+			mix[i].i = ReadSample(stream + i * sample_size, format);
+		}
+	}
+
+	/* Specialize the inner loops for each format */
+	switch (format) {
+	    case AUDIO_U8:
+		MixVoices(mix, samples / channels, channels, AUDIO_U8);
+		break;
+	    case AUDIO_S8:
+		MixVoices(mix, samples / channels, channels, AUDIO_S8);
+		break;
+	    case AUDIO_S16LSB:
+		MixVoices(mix, samples / channels, channels, AUDIO_S16LSB);
+		break;
+	    case AUDIO_S16MSB:
+		MixVoices(mix, samples / channels, channels, AUDIO_S16MSB);
+		break;
+	    case AUDIO_F32LSB:
+		MixVoices(mix, samples / channels, channels, AUDIO_F32LSB);
+		break;
+	    case AUDIO_F32MSB:
+		MixVoices(mix, samples / channels, channels, AUDIO_F32MSB);
+		break;
+	}
+
+	/* Clip once and write back, float to -1.0..1.0 like SDL_MixAudio() */
+	if ( sample_size == 4 ) {
+		for ( i=0; i<samples; ++i ) {
+			union {
+				Uint32 u;
+				float f;
+			} sample;
+			Uint8 *dst = stream + 4*i;
+
+			sample.f = mix[i].f;
+			if ( sample.f > 1.0f ) {
+				sample.f = 1.0f;
+			} else if ( sample.f < -1.0f ) {
+				sample.f = -1.0f;
+			}
+			if ( format == AUDIO_F32LSB ) {
+				dst[0] = (Uint8)sample.u;
+				dst[1] = (Uint8)(sample.u >> 8);
+				dst[2] = (Uint8)(sample.u >> 16);
+				dst[3] = (Uint8)(sample.u >> 24);
+			} else {
+				dst[0] = (Uint8)(sample.u >> 24);
+				dst[1] = (Uint8)(sample.u >> 16);
+				dst[2] = (Uint8)(sample.u >> 8);
+				dst[3] = (Uint8)sample.u;
+			}
+		}
+		return;
+	}
+	for ( i=0; i<samples; ++i ) {
+		Sint32 s = mix[i].i;
+		if ( s > 32767 ) {
+			s = 32767;
+		} else if ( s < -32768 ) {
+			s = -32768;
+		}
+		switch (format) {
+		    case AUDIO_U8:
+			stream[i] = (Uint8)((s >> 8) + 128);
+			break;
+		    case AUDIO_S8:
+			stream[i] = (Uint8)(s >> 8);
+			break;
+		    case AUDIO_S16LSB:
+			stream[2*i] = (Uint8)s;
+			stream[2*i+1] = (Uint8)(s >> 8);
+			break;
+		    default:
+			stream[2*i] = (Uint8)(s >> 8);
+			stream[2*i+1] = (Uint8)s;
+			break;
+		}
+	}
+}
@@ -81,6 +81,7 @@ static SDL_AudioDevice *Audio_CreateDevice(int devindex)
     this->PlayAudio = Core_PlayAudio;
     this->GetAudioBuf = Core_GetAudioBuf;
     this->CloseAudio = Core_CloseAudio;
+    this->plays_float = 1;
 
     this->free = Audio_DeleteDevice;
 
@@ -224,7 +225,9 @@ int Core_OpenAudio(_THIS, SDL_AudioSpec *spec)
     requestedDesc.mSampleRate = spec->freq;
     
     requestedDesc.mBitsPerChannel = spec->format & 0xFF;
-    if (spec->format & 0x8000)
+    if ((spec->format & 0xFF) == 32)
+        requestedDesc.mFormatFlags |= kLinearPCMFormatFlagIsFloat;
+    else if (spec->format & 0x8000)
         requestedDesc.mFormatFlags |= kLinearPCMFormatFlagIsSignedInteger;
     if (spec->format & 0x1000)
         requestedDesc.mFormatFlags |= kLinearPCMFormatFlagIsBigEndian;
@@ -4,6 +4,9 @@
 
 #include <assert.h>
 #include <ppapi/cpp/instance.h>
+#include <ppapi/cpp/module.h>
+#include <ppapi/cpp/core.h>
+#include <ppapi/cpp/completion_callback.h>
 
 extern pp::Instance* gNaclPPInstance;
 
@@ -13,6 +16,7 @@ extern "C" {
 #include "SDL_timer.h"
 #include "SDL_audio.h"
 #include "SDL_mutex.h"
+#include "SDL_nacl.h"
 #include "../SDL_audiomem.h"
 #include "../SDL_audio_c.h"
 #include "../SDL_audiodev_c.h"
@@ -20,10 +24,13 @@ extern "C" {
   /* The tag name used by NACL audio */
 #define NACLAUD_DRIVER_NAME         "nacl"
 
-const uint32_t kSampleFrameCount = 4096u;
+const int kChannels = 2;
 
 /* Audio driver functions */
 static int NACLAUD_OpenAudio(_THIS, SDL_AudioSpec *spec);
+static void NACLAUD_WaitAudio(_THIS);
+static void NACLAUD_PlayAudio(_THIS);
+static Uint8 *NACLAUD_GetAudioBuf(_THIS);
 static void NACLAUD_CloseAudio(_THIS);
 
 static void AudioCallback(void* samples, size_t buffer_size, void* data);
@@ -35,7 +42,9 @@ static int NACLAUD_Available(void) {
 }
 
 static void NACLAUD_DeleteDevice(SDL_AudioDevice *device) {
-  // We should stop playback here, but it can only be done on the main thread :(
+  // Playback was stopped on the main thread by NACLAUD_CloseAudio.
+  SDL_free(device->hidden);
+  SDL_free(device);
 }
 
 static SDL_AudioDevice *NACLAUD_CreateDevice(int devindex) {
@@ -57,27 +66,15 @@ static SDL_AudioDevice *NACLAUD_CreateDevice(int devindex) {
   }
   SDL_memset(_this->hidden, 0, (sizeof *_this->hidden));
 
-  _this->hidden->mutex = SDL_CreateMutex();
-
-  _this->hidden->opened = false;
-
-  // TODO: Move audio device creation to NACLAUD_OpenAudio.
-  _this->hidden->sample_frame_count =
-      pp::AudioConfig::RecommendSampleFrameCount(PP_AUDIOSAMPLERATE_44100,
-          kSampleFrameCount);
-  _this->hidden->audio = pp::Audio(
-      gNaclPPInstance,
-      pp::AudioConfig(gNaclPPInstance,
-          PP_AUDIOSAMPLERATE_44100,
-          _this->hidden->sample_frame_count),
-      AudioCallback, _this);
-
-  // Start audio playback while we are still on the main thread.
-  _this->hidden->audio.StartPlayback();
+  _this->hidden->opened = 0;
 
   /* Set the function pointers */
   _this->OpenAudio = NACLAUD_OpenAudio;
+  _this->WaitAudio = NACLAUD_WaitAudio;
+  _this->PlayAudio = NACLAUD_PlayAudio;
+  _this->GetAudioBuf = NACLAUD_GetAudioBuf;
   _this->CloseAudio = NACLAUD_CloseAudio;
+  _this->plays_float = 1;
 
   _this->free = NACLAUD_DeleteDevice;
 
@@ -90,44 +87,321 @@ AudioBootStrap NACLAUD_bootstrap = {
 };
 
 
+static void freeBuffers(_THIS) {
+  struct SDL_PrivateAudioData* hidden = _this->hidden;
+
+  if (hidden->cvt.buf) {
+    SDL_free(hidden->cvt.buf);
+    hidden->cvt.buf = NULL;
+  }
+  if (hidden->resample) {
+    SDL_FreeResampler(&hidden->resampler);
+    hidden->resample = false;
+  }
+  if (hidden->fifo) {
+    SDL_free(hidden->fifo);
+    hidden->fifo = NULL;
+  }
+  if (hidden->blocks) {
+    SDL_free(hidden->blocks);
+    hidden->blocks = NULL;
+  }
+  if (hidden->free_blocks) {
+    SDL_DestroySemaphore(hidden->free_blocks);
+    hidden->free_blocks = NULL;
+  }
+  hidden->convert = false;
+}
+
+/* Pepper audio resources can only be used on the main thread, so the
+   device is created, started and stopped there while the calling thread
+   waits.
+ */
+struct MainThreadCall {
+  SDL_AudioDevice* device;
+  void (*func)(SDL_AudioDevice* device);
+  SDL_sem* done;
+};
+
+static void mainThreadTrampoline(void* data, int32_t unused) {
+  MainThreadCall* call = reinterpret_cast<MainThreadCall*>(data);
+  call->func(call->device);
+  SDL_SemPost(call->done);
+}
+
+static void runOnMainThread(_THIS, void (*func)(SDL_AudioDevice* device)) {
+  pp::Core* core = pp::Module::Get()->core();
+  MainThreadCall call;
+
+  if (core->IsMainThread()) {
+    func(_this);
+    return;
+  }
+  call.device = _this;
+  call.func = func;
+  call.done = SDL_CreateSemaphore(0);
+  core->CallOnMainThread(0,
+      pp::CompletionCallback(&mainThreadTrampoline, &call));
+  SDL_SemWait(call.done);
+  SDL_DestroySemaphore(call.done);
+}
+
+static void startPlayback(_THIS) {
+  _this->hidden->audio = pp::Audio(
+      gNaclPPInstance,
+      pp::AudioConfig(gNaclPPInstance,
+          (PP_AudioSampleRate)_this->hidden->sample_rate,
+          _this->hidden->sample_frame_count),
+      AudioCallback, _this);
+  _this->hidden->playing = _this->hidden->audio.StartPlayback();
+}
+
+static void stopPlayback(_THIS) {
+  _this->hidden->audio.StopPlayback();
+  _this->hidden->audio = pp::Audio();
+  _this->hidden->playing = false;
+}
+
 static void NACLAUD_CloseAudio(_THIS) {
-  SDL_LockMutex(_this->hidden->mutex);
+  if (_this->hidden->playing)
+    runOnMainThread(_this, stopPlayback);
   _this->hidden->opened = 0;
-  SDL_UnlockMutex(_this->hidden->mutex);
+  __sync_synchronize();
+  /* Wait for a running Pepper callback to let go of the buffers */
+  while (_this->hidden->in_callback)
+    SDL_Delay(1);
+  freeBuffers(_this);
 }
 
 
 static void AudioCallback(void* samples, size_t buffer_size, void* data) {
   SDL_AudioDevice* _this = reinterpret_cast<SDL_AudioDevice*>(data);
-
-  SDL_LockMutex(_this->hidden->mutex);
-  if (_this->hidden->opened) {
-    SDL_memset(samples, _this->spec.silence, buffer_size);
-    SDL_LockMutex(_this->mixer_lock);
-    (*_this->spec.callback)(_this->spec.userdata,
-        (Uint8*)samples, buffer_size);
-    SDL_UnlockMutex(_this->mixer_lock);
+  struct SDL_PrivateAudioData* hidden = _this->hidden;
+
+  hidden->in_callback = 1;
+  __sync_synchronize();
+  if (hidden->opened && hidden->read_block != hidden->write_block) {
+    const size_t size = SDL_min(buffer_size, (size_t)hidden->block_size);
+    const unsigned block = hidden->read_block % NACLAUD_NUM_BLOCKS;
+    __sync_synchronize();  // read the block after seeing write_block
+    SDL_memcpy(samples, hidden->blocks + block * hidden->block_size, size);
+    if (size < buffer_size)
+      SDL_memset((Uint8*)samples + size, 0, buffer_size - size);
+    __sync_synchronize();  // done reading before releasing the block
+    hidden->read_block++;
+    hidden->callbacks++;
+    SDL_SemPost(hidden->free_blocks);
   } else {
     SDL_memset(samples, 0, buffer_size);
+    if (hidden->opened) {
+      hidden->callbacks++;
+      if (hidden->primed)
+        hidden->underruns++;
+    }
   }
-  SDL_UnlockMutex(_this->hidden->mutex);
+  __sync_synchronize();
+  hidden->in_callback = 0;
+}
+
+
+/* Wait until the ring has room for another block */
+static bool waitFreeBlock(_THIS) {
+  struct SDL_PrivateAudioData* hidden = _this->hidden;
 
-  return;
+  while (hidden->write_block - hidden->read_block == NACLAUD_NUM_BLOCKS) {
+    hidden->primed = true;
+    if (!_this->enabled)
+      return false;
+    SDL_SemWaitTimeout(hidden->free_blocks, 100);
+  }
+  return true;
 }
 
+static void publishBlock(_THIS) {
+  __sync_synchronize();  // publish the block before the new index
+  _this->hidden->write_block++;
+}
+
+static Uint8* nextBlock(_THIS) {
+  return _this->hidden->blocks +
+      (_this->hidden->write_block % NACLAUD_NUM_BLOCKS) *
+      _this->hidden->block_size;
+}
+
+/* Move every complete block out of the fifo, waiting for room in the
+   ring.  Only fails once the device is being closed.
+ */
+static bool drainFifo(_THIS) {
+  struct SDL_PrivateAudioData* hidden = _this->hidden;
+  const int block_frames = hidden->sample_frame_count;
+
+  while (hidden->fifo_frames >= block_frames) {
+    if (!waitFreeBlock(_this))
+      return false;
+    SDL_memcpy(nextBlock(_this), hidden->fifo, hidden->block_size);
+    publishBlock(_this);
+    hidden->fifo_frames -= block_frames;
+    SDL_memmove(hidden->fifo, hidden->fifo + block_frames * kChannels,
+        hidden->fifo_frames * kChannels * sizeof(Sint16));
+  }
+  return true;
+}
+
+/* These functions run on the SDL audio thread */
+static Uint8 *NACLAUD_GetAudioBuf(_THIS) {
+  if (_this->hidden->convert)
+    return _this->hidden->cvt.buf;
+  return nextBlock(_this);
+}
+
+static void NACLAUD_PlayAudio(_THIS) {
+  struct SDL_PrivateAudioData* hidden = _this->hidden;
+  Sint16* dst;
+  int frames, out_frames;
+
+  if (!hidden->convert) {
+    publishBlock(_this);
+    return;
+  }
+
+  /* Convert the chunk the application just mixed into the fifo */
+  hidden->cvt.len = _this->spec.size;
+  hidden->cvt.len_cvt = _this->spec.size;
+  if (hidden->cvt.needed)
+    SDL_ConvertAudio(&hidden->cvt);
+  frames = hidden->cvt.len_cvt / (kChannels * sizeof(Sint16));
+
+  /* The fifo is sized for a partial block plus a whole chunk, so once the
+     complete blocks are out the chunk fits.  Draining can only fail when
+     the device is closing, and then the chunk doesn't matter any more.
+   */
+  out_frames = hidden->resample ?
+      SDL_ResampleMaxOutput(&hidden->resampler, frames) : frames;
+  if (hidden->fifo_frames + out_frames > hidden->fifo_max &&
+      !drainFifo(_this))
+    return;
+  assert(hidden->fifo_frames + out_frames <= hidden->fifo_max);
+
+  dst = hidden->fifo + hidden->fifo_frames * kChannels;
+  if (hidden->resample) {
+    frames = SDL_Resample(&hidden->resampler,
+        (Sint16*)hidden->cvt.buf, frames, dst);
+    if (frames < 0)
+      return;
+  } else {
+    SDL_memcpy(dst, hidden->cvt.buf, frames * kChannels * sizeof(Sint16));
+  }
+  hidden->fifo_frames += frames;
+}
+
+static void NACLAUD_WaitAudio(_THIS) {
+  if (!_this->hidden->convert) {
+    waitFreeBlock(_this);
+    return;
+  }
+
+  /* Move every complete block out of the fifo, then ask for more */
+  drainFifo(_this);
+}
+
+
+/* Pick the Pepper buffer size for the requested latency: SDL_AUDIO_LATENCY
+   in milliseconds if set, spec->samples at the requested rate otherwise.
+ */
+static uint32_t chooseSampleFrameCount(const SDL_AudioSpec* spec,
+    int sample_rate) {
+  const char* latency = SDL_getenv("SDL_AUDIO_LATENCY");
+  double frames;
+
+  if (latency && SDL_atoi(latency) > 0) {
+    frames = (double)SDL_atoi(latency) * sample_rate / 1000;
+  } else {
+    frames = (double)spec->samples * sample_rate / spec->freq;
+  }
+  return pp::AudioConfig::RecommendSampleFrameCount(
+      (PP_AudioSampleRate)sample_rate, (uint32_t)frames);
+}
 
 static int NACLAUD_OpenAudio(_THIS, SDL_AudioSpec *spec) {
-  // We don't care what the user wants.
-  spec->freq = 44100;
-  spec->format = AUDIO_S16LSB;
-  spec->channels = 2;
-  spec->samples = _this->hidden->sample_frame_count;
-
-  SDL_LockMutex(_this->hidden->mutex);
-  _this->hidden->opened = 1;
-  SDL_UnlockMutex(_this->hidden->mutex);
-
-  // Do not create an audio thread.
-  return 1;
+  struct SDL_PrivateAudioData* hidden = _this->hidden;
+
+  freeBuffers(_this);
+
+  /* Pepper plays 44.1 kHz or 48 kHz, use whichever needs less resampling */
+  hidden->sample_rate = (spec->freq % 4000 == 0) ? 48000 : 44100;
+  hidden->sample_frame_count = chooseSampleFrameCount(spec,
+      hidden->sample_rate);
+
+  if (spec->freq == hidden->sample_rate && spec->format == AUDIO_S16SYS &&
+      spec->channels == kChannels) {
+    // Native format, the application mixes straight into the ring.
+    spec->samples = hidden->sample_frame_count;
+    SDL_CalculateAudioSpec(spec);
+  } else {
+    // Keep what the application asked for and convert on the fly.
+    if (SDL_BuildAudioCVT(&hidden->cvt, spec->format, spec->channels,
+            spec->freq, AUDIO_S16SYS, kChannels, spec->freq) < 0) {
+      return -1;
+    }
+    hidden->cvt.buf = (Uint8*)SDL_malloc(spec->size * hidden->cvt.len_mult);
+    hidden->convert = true;
+
+    int chunk_frames = spec->samples;
+    if (spec->freq != hidden->sample_rate) {
+      if (SDL_InitResampler(&hidden->resampler, kChannels, spec->freq,
+              hidden->sample_rate,
+              SDL_GetResampleQuality(SDL_RESAMPLE_MEDIUM)) < 0) {
+        freeBuffers(_this);
+        return -1;
+      }
+      hidden->resample = true;
+      chunk_frames =
+          (int)((double)spec->samples * hidden->sample_rate / spec->freq) +
+          hidden->resampler.taps + 2;
+    }
+
+    // Room for a partial block plus a full new chunk.
+    hidden->fifo_max = hidden->sample_frame_count + chunk_frames;
+    hidden->fifo = (Sint16*)SDL_malloc(
+        hidden->fifo_max * kChannels * sizeof(Sint16));
+    hidden->fifo_frames = 0;
+  }
+
+  hidden->block_size = hidden->sample_frame_count * kChannels * sizeof(Sint16);
+  hidden->blocks = (Uint8*)SDL_malloc(NACLAUD_NUM_BLOCKS * hidden->block_size);
+  hidden->free_blocks = SDL_CreateSemaphore(0);
+  if ((hidden->convert && (hidden->cvt.buf == NULL || hidden->fifo == NULL)) ||
+      hidden->blocks == NULL || hidden->free_blocks == NULL) {
+    freeBuffers(_this);
+    SDL_OutOfMemory();
+    return -1;
+  }
+  hidden->read_block = 0;
+  hidden->write_block = 0;
+  hidden->primed = false;
+  hidden->callbacks = 0;
+  hidden->underruns = 0;
+
+  __sync_synchronize();  // everything is set up before the callback sees it
+  hidden->opened = 1;
+
+  runOnMainThread(_this, startPlayback);
+  if (!hidden->playing) {
+    NACLAUD_CloseAudio(_this);
+    SDL_SetError("Couldn't start Pepper audio playback");
+    return -1;
+  }
+
+  // Mix on an SDL audio thread, feeding the ring.
+  return 0;
+}
+
+void SDL_NACL_GetAudioStats(SDL_NACL_AudioStats* stats) {
+  SDL_memset(stats, 0, sizeof(*stats));
+  if (current_audio &&
+      SDL_strcmp(current_audio->name, NACLAUD_DRIVER_NAME) == 0) {
+    stats->callbacks = current_audio->hidden->callbacks;
+    stats->underruns = current_audio->hidden->underruns;
+  }
 }
 } // extern "C"
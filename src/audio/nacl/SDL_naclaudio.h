@@ -6,6 +6,7 @@
 extern "C" {
 #include "SDL_audio.h"
 #include "../SDL_sysaudio.h"
+#include "../SDL_resample_c.h"
 #include "SDL_mutex.h"
 }
 
@@ -14,17 +15,55 @@ extern "C" {
 /* Hidden "this" pointer for the video functions */
 #define _THIS	SDL_AudioDevice *_this
 
+/* Number of Pepper-sized blocks queued between the SDL audio thread and
+   the Pepper audio callback.
+ */
+#define NACLAUD_NUM_BLOCKS 2
+
 struct SDL_PrivateAudioData {
 
-  SDL_mutex* mutex;
   // This flag is use to determine when the audio is opened and we can start
-  // serving audio data instead of silence. This is needed because current
-  // Pepper2 can only be used from the main thread; Therefore, we start the
-  // audio thread very early.
-  bool opened;
+  // serving audio data instead of silence.  It is read by the Pepper
+  // callback without a lock, so it is only changed with memory barriers
+  // around it, and in_callback tells NACLAUD_CloseAudio when the callback
+  // is done with the buffers.
+  volatile int opened;
+  volatile int in_callback;
 
+  // The Pepper device is created by NACLAUD_OpenAudio for the requested
+  // rate and buffer size, and destroyed by NACLAUD_CloseAudio.
+  int sample_rate;
   int sample_frame_count;
   pp::Audio audio;
+  bool playing;
+
+  // Single-producer/single-consumer ring of blocks of sample_frame_count
+  // S16 stereo frames.  The SDL audio thread runs the application callback
+  // and fills the ring; the realtime Pepper callback only copies a block
+  // out, so it never waits for SDL_LockAudio or the application.
+  Uint8* blocks;
+  int block_size;
+  volatile unsigned read_block;   // written by the Pepper callback
+  volatile unsigned write_block;  // written by the SDL audio thread
+  SDL_sem* free_blocks;
+  bool primed;                    // the ring has been filled once
+
+  // Statistics, written by the Pepper callback.
+  volatile Uint32 callbacks;
+  volatile Uint32 underruns;
+
+  // Pepper plays signed 16-bit stereo at a fixed rate.  Any other format
+  // asked for by the application is converted on the SDL audio thread: cvt
+  // does the format and channel conversion of one spec.size chunk in
+  // cvt.buf, the resampler the rate conversion, and the result is queued in
+  // fifo until it fills a block.
+  bool convert;
+  SDL_AudioCVT cvt;
+  bool resample;
+  SDL_Resampler resampler;
+  Sint16* fifo;
+  int fifo_frames;
+  int fifo_max;
 };
 
 #endif /* _SDL_naclaudio_h */
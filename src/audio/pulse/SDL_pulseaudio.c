@@ -281,6 +281,7 @@ static SDL_AudioDevice *Audio_CreateDevice(int devindex)
 	this->GetAudioBuf = PULSE_GetAudioBuf;
 	this->CloseAudio = PULSE_CloseAudio;
 	this->WaitDone = PULSE_WaitDone;
+	this->plays_float = 1;
 
 	this->free = Audio_DeleteDevice;
 
@@ -415,9 +416,16 @@ static int PULSE_OpenAudio(_THIS, SDL_AudioSpec *spec)
 			case AUDIO_S16MSB:
 				paspec.format = PA_SAMPLE_S16BE;
 				break;
+			case AUDIO_F32LSB:
+				paspec.format = PA_SAMPLE_FLOAT32LE;
+				break;
+			case AUDIO_F32MSB:
+				paspec.format = PA_SAMPLE_FLOAT32BE;
+				break;
 		}
 		if ( paspec.format != PA_SAMPLE_INVALID )
 			break;
+		test_format = SDL_NextAudioFormat();
 	}
 	if (paspec.format == PA_SAMPLE_INVALID ) {
 		SDL_SetError("Couldn't find any suitable audio formats");
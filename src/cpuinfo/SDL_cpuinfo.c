@@ -41,6 +41,8 @@
 #define CPU_HAS_SSE	0x00000040
 #define CPU_HAS_SSE2	0x00000080
 #define CPU_HAS_ALTIVEC	0x00000100
+#define CPU_HAS_AVX2	0x00000200
+#define CPU_HAS_SSSE3	0x00000400
 
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__
 /* This is the brute force way of detecting instruction sets...
@@ -347,6 +349,68 @@ static __inline__ int CPU_haveSSE2(void)
 	return 0;
 }
 
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && (defined(i386) || defined(__x86_64__))
+/* cpuid clobbers %ebx, which may hold the PIC register */
+#if defined(__x86_64__)
+#define CPUID(func, a, b, c, d) \
+	__asm__ __volatile__ ( \
+"        xchgq   %%rbx,%q1  \n" \
+"        cpuid              \n" \
+"        xchgq   %%rbx,%q1  \n" \
+	: "=a" (a), "=&r" (b), "=c" (c), "=d" (d) : "a" (func), "c" (0))
+#else
+#define CPUID(func, a, b, c, d) \
+	__asm__ __volatile__ ( \
+"        xchgl   %%ebx,%1   \n" \
+"        cpuid              \n" \
+"        xchgl   %%ebx,%1   \n" \
+	: "=a" (a), "=&r" (b), "=c" (c), "=d" (d) : "a" (func), "c" (0))
+#endif
+#endif
+
+static __inline__ int CPU_haveSSSE3(void)
+{
+	int ssse3 = 0;
+#ifdef CPUID
+	if ( CPU_haveCPUID() ) {
+		unsigned int a, b, c, d;
+
+		CPUID(0, a, b, c, d);
+		if ( a >= 1 ) {
+			CPUID(1, a, b, c, d);
+			ssse3 = (c & 0x00000200);
+		}
+	}
+#endif
+	return ssse3;
+}
+
+static __inline__ int CPU_haveAVX2(void)
+{
+	int avx2 = 0;
+#ifdef CPUID
+	if ( CPU_haveCPUID() ) {
+		unsigned int a, b, c, d;
+
+		CPUID(0, a, b, c, d);
+		if ( a >= 7 ) {
+			CPUID(1, a, b, c, d);
+			/* AVX, and the OS saves the YMM registers (OSXSAVE) */
+			if ( (c & 0x18000000) == 0x18000000 ) {
+				__asm__ __volatile__ (
+"        .byte   0x0f, 0x01, 0xd0    # xgetbv                          \n"
+				: "=a" (a), "=d" (d) : "c" (0));
+				if ( (a & 0x6) == 0x6 ) {
+					CPUID(7, a, b, c, d);
+					avx2 = (b & 0x00000020);
+				}
+			}
+		}
+	}
+#endif
+	return avx2;
+}
+
 static __inline__ int CPU_haveAltiVec(void)
 {
 	volatile int altivec = 0;
@@ -399,6 +463,12 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveSSE2() ) {
 			SDL_CPUFeatures |= CPU_HAS_SSE2;
 		}
+		if ( CPU_haveSSSE3() ) {
+			SDL_CPUFeatures |= CPU_HAS_SSSE3;
+		}
+		if ( CPU_haveAVX2() ) {
+			SDL_CPUFeatures |= CPU_HAS_AVX2;
+		}
 		if ( CPU_haveAltiVec() ) {
 			SDL_CPUFeatures |= CPU_HAS_ALTIVEC;
 		}
@@ -462,6 +532,22 @@ SDL_bool SDL_HasSSE2(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasSSSE3(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_SSSE3 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
+SDL_bool SDL_HasAVX2(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_AVX2 ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 SDL_bool SDL_HasAltiVec(void)
 {
 	if ( SDL_GetCPUFeatures() & CPU_HAS_ALTIVEC ) {
@@ -483,6 +569,8 @@ int main()
 	printf("3DNowExt: %d\n", SDL_Has3DNowExt());
 	printf("SSE: %d\n", SDL_HasSSE());
 	printf("SSE2: %d\n", SDL_HasSSE2());
+	printf("SSSE3: %d\n", SDL_HasSSSE3());
+	printf("AVX2: %d\n", SDL_HasAVX2());
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
 	return 0;
 }
@@ -37,18 +37,133 @@ SDL_EventFilter SDL_EventOK = NULL;
 Uint8 SDL_ProcessEvents[SDL_NUMEVENTS];
 static Uint32 SDL_eventstate = 0;
 
+/* Merge mouse motion once this many events are waiting, 0 to never merge */
+#define DEFAULT_MOTION_COALESCE	64
+static int SDL_MotionCoalesce = DEFAULT_MOTION_COALESCE;
+
 /* Private data -- event queue */
-#define MAXEVENTS	128
+#define MINEVENTS	128	/* initial size of the queue, a power of two */
+#define MAXEVENTS	65536	/* the queue doesn't grow past this */
+#define WMMSGCHUNK	128	/* window manager messages per allocation */
 static struct {
 	SDL_mutex *lock;
 	int active;
 	int head;
 	int tail;
-	SDL_Event event[MAXEVENTS];
+	int size;			/* allocated events, a power of two */
+	SDL_Event *event;
+	volatile int room;		/* events that can still be added */
+	SDL_EventStats stats;
+	/* The messages of queued SDL_SYSWMEVENTs, in a ring as big as the
+	   queue so a message isn't reused while its event is still queued.
+	   It's allocated in chunks as it fills up, and the chunks are never
+	   moved, so the events always point at their own messages.
+	 */
 	int wmmsg_next;
-	struct SDL_SysWMmsg wmmsg[MAXEVENTS];
+	struct SDL_SysWMmsg *wmmsg[MAXEVENTS/WMMSGCHUNK];
 } SDL_EventQ;
 
+/* With GCC atomics, events pushed from other threads go through a bounded
+   lock-free inbox first, so they don't wait for the queue lock while the
+   queue is being searched.  Whoever holds the queue lock moves them over
+   before looking at the queue.  If the inbox is full, the producer takes
+   the lock and adds the event directly.  Room in the queue is reserved
+   before an event goes in the inbox, so an event that was accepted is
+   never dropped later.
+ */
+#if !SDL_THREADS_DISABLED && defined(__GNUC__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define SDL_EVENT_INBOX
+#define INBOXSIZE	256	/* a power of two */
+#define CACHELINE	64
+
+/* Each slot's sequence number says whether it's free for the producer
+   claiming position 'pos' (seq == pos) or holds an event for the consumer
+   at position 'pos' (seq == pos+1).
+ */
+static struct {
+	volatile Uint32 put;		/* next position to claim */
+	char pad0[CACHELINE - sizeof(Uint32)];
+	Uint32 get;			/* next position to read, under lock */
+	char pad1[CACHELINE - sizeof(Uint32)];
+	struct {
+		volatile Uint32 seq;
+		SDL_Event event;
+	} slot[INBOXSIZE];
+} SDL_EventInbox;
+
+static void SDL_ResetInbox(void)
+{
+	int i;
+
+	SDL_EventInbox.put = 0;
+	SDL_EventInbox.get = 0;
+	for ( i=0; i<INBOXSIZE; ++i ) {
+		SDL_EventInbox.slot[i].seq = i;
+	}
+}
+
+/* Add an event to the inbox, returning 0 if it's full */
+static int SDL_InboxPut(const SDL_Event *event)
+{
+	Uint32 pos, seq;
+
+	pos = SDL_EventInbox.put;
+	for ( ; ; ) {
+		seq = SDL_EventInbox.slot[pos & (INBOXSIZE-1)].seq;
+		if ( seq == pos ) {
+			if ( __sync_bool_compare_and_swap(&SDL_EventInbox.put,
+							pos, pos+1) ) {
+				break;
+			}
+		} else if ( (Sint32)(seq - pos) < 0 ) {
+			return(0);
+		}
+		pos = SDL_EventInbox.put;
+	}
+	SDL_EventInbox.slot[pos & (INBOXSIZE-1)].event = *event;
+	__sync_synchronize();	/* publish the event before the slot */
+	SDL_EventInbox.slot[pos & (INBOXSIZE-1)].seq = pos+1;
+	return(1);
+}
+#endif /* SDL_EVENT_INBOX */
+
+/* Reserve room in the queue for an event, returning 0 if it's full.
+   Without the inbox, this is only called with the queue locked.
+ */
+static int SDL_ReserveEvent(void)
+{
+#ifdef SDL_EVENT_INBOX
+	if ( __sync_sub_and_fetch(&SDL_EventQ.room, 1) >= 0 ) {
+		return(1);
+	}
+	__sync_add_and_fetch(&SDL_EventQ.room, 1);
+	return(0);
+#else
+	if ( SDL_EventQ.room > 0 ) {
+		--SDL_EventQ.room;
+		return(1);
+	}
+	return(0);
+#endif
+}
+
+static void SDL_ReleaseEvents(int count)
+{
+#ifdef SDL_EVENT_INBOX
+	__sync_add_and_fetch(&SDL_EventQ.room, count);
+#else
+	SDL_EventQ.room += count;
+#endif
+}
+
+/* Private data -- threads waiting in SDL_WaitEventTimeout() */
+static struct {
+	SDL_mutex *lock;
+	SDL_cond *cond;
+	volatile int waiting;
+} SDL_EventWait;
+
 /* Private data -- event locking structure */
 static struct {
 	SDL_mutex *lock;
@@ -157,6 +272,9 @@ static int SDL_StartEventThread(Uint32 flags)
 		return(-1);
 #endif
 	}
+	SDL_EventWait.lock = SDL_CreateMutex();
+	SDL_EventWait.cond = SDL_CreateCond();
+	SDL_EventWait.waiting = 0;
 #endif /* !SDL_THREADS_DISABLED */
 	SDL_EventQ.active = 1;
 
@@ -197,6 +315,14 @@ static void SDL_StopEventThread(void)
 	SDL_DestroyMutex(SDL_EventQ.lock);
 	SDL_EventQ.lock = NULL;
 #endif
+	if ( SDL_EventWait.cond ) {
+		SDL_DestroyCond(SDL_EventWait.cond);
+		SDL_EventWait.cond = NULL;
+	}
+	if ( SDL_EventWait.lock ) {
+		SDL_DestroyMutex(SDL_EventWait.lock);
+		SDL_EventWait.lock = NULL;
+	}
 }
 
 Uint32 SDL_EventThreadID(void)
@@ -208,6 +334,8 @@ Uint32 SDL_EventThreadID(void)
 
 void SDL_StopEventLoop(void)
 {
+	int i;
+
 	/* Halt the event thread, if running */
 	SDL_StopEventThread();
 
@@ -218,9 +346,25 @@ void SDL_StopEventLoop(void)
 	SDL_QuitQuit();
 
 	/* Clean out EventQ */
+	if ( SDL_EventQ.event ) {
+		SDL_free(SDL_EventQ.event);
+		SDL_EventQ.event = NULL;
+	}
+	SDL_EventQ.size = 0;
 	SDL_EventQ.head = 0;
 	SDL_EventQ.tail = 0;
+	SDL_EventQ.room = MAXEVENTS-1;
+	SDL_memset(&SDL_EventQ.stats, 0, sizeof(SDL_EventQ.stats));
+	for ( i=0; i<SDL_arraysize(SDL_EventQ.wmmsg); ++i ) {
+		if ( SDL_EventQ.wmmsg[i] ) {
+			SDL_free(SDL_EventQ.wmmsg[i]);
+			SDL_EventQ.wmmsg[i] = NULL;
+		}
+	}
 	SDL_EventQ.wmmsg_next = 0;
+#ifdef SDL_EVENT_INBOX
+	SDL_ResetInbox();
+#endif
 }
 
 /* This function (and associated calls) may be called more than once */
@@ -231,6 +375,8 @@ int SDL_StartEventLoop(Uint32 flags)
 	/* Clean out the event queue */
 	SDL_EventThread = NULL;
 	SDL_EventQ.lock = NULL;
+	SDL_EventWait.lock = NULL;
+	SDL_EventWait.cond = NULL;
 	SDL_StopEventLoop();
 
 	/* No filter to start with, process most event types */
@@ -241,6 +387,13 @@ int SDL_StartEventLoop(Uint32 flags)
 	SDL_eventstate &= ~(0x00000001 << SDL_SYSWMEVENT);
 	SDL_ProcessEvents[SDL_SYSWMEVENT] = SDL_IGNORE;
 
+	/* How far the application may fall behind before motion is merged */
+	if ( SDL_getenv("SDL_MOUSE_COALESCE") ) {
+		SDL_MotionCoalesce = SDL_atoi(SDL_getenv("SDL_MOUSE_COALESCE"));
+	} else {
+		SDL_MotionCoalesce = DEFAULT_MOTION_COALESCE;
+	}
+
 	/* Initialize event handlers */
 	retcode = 0;
 	retcode += SDL_AppActiveInit();
@@ -261,58 +414,161 @@ int SDL_StartEventLoop(Uint32 flags)
 }
 
 
-/* Add an event to the event queue -- called with the queue locked */
+/* Count an event in one of the SDL_EventQ.stats arrays */
+#define COUNT_EVENT(what, event) \
+	if ( (event)->type < SDL_NUMEVENTS ) { \
+		++SDL_EventQ.stats.what[(event)->type]; \
+	}
+
+/* Make room for more events -- called with the queue locked */
+static int SDL_GrowEventQueue(void)
+{
+	SDL_Event *event;
+	int size, count, first;
+
+	size = SDL_EventQ.size ? SDL_EventQ.size*2 : MINEVENTS;
+	if ( size > MAXEVENTS ) {
+		return(0);
+	}
+	event = (SDL_Event *)SDL_malloc(size*sizeof(*event));
+	if ( event == NULL ) {
+		return(0);
+	}
+
+	/* Unwrap the queued events to the start of the new array */
+	count = 0;
+	if ( SDL_EventQ.event ) {
+		count = (SDL_EventQ.tail-SDL_EventQ.head) & (SDL_EventQ.size-1);
+		first = SDL_min(count, SDL_EventQ.size-SDL_EventQ.head);
+		SDL_memcpy(event, &SDL_EventQ.event[SDL_EventQ.head],
+					first*sizeof(*event));
+		SDL_memcpy(event+first, SDL_EventQ.event,
+					(count-first)*sizeof(*event));
+		SDL_free(SDL_EventQ.event);
+	}
+	SDL_EventQ.event = event;
+	SDL_EventQ.size = size;
+	SDL_EventQ.head = 0;
+	SDL_EventQ.tail = count;
+	return(1);
+}
+
+/* Copy a window manager message into the ring -- called with the queue
+   locked, after it has grown to make room for the message's event */
+static struct SDL_SysWMmsg *SDL_AddWMmsg(const struct SDL_SysWMmsg *msg)
+{
+	struct SDL_SysWMmsg **chunk;
+	int next = SDL_EventQ.wmmsg_next;
+
+	chunk = &SDL_EventQ.wmmsg[next / WMMSGCHUNK];
+	if ( *chunk == NULL ) {
+		*chunk = (struct SDL_SysWMmsg *)
+			SDL_malloc(WMMSGCHUNK * sizeof(**chunk));
+		if ( *chunk == NULL ) {
+			return(NULL);
+		}
+	}
+	(*chunk)[next % WMMSGCHUNK] = *msg;
+	SDL_EventQ.wmmsg_next = (next+1) & (SDL_EventQ.size-1);
+	return(&(*chunk)[next % WMMSGCHUNK]);
+}
+
+/* Add an event there is room reserved for to the event queue
+                             -- called with the queue locked */
 static int SDL_AddEvent(SDL_Event *event)
 {
-	int tail, added;
+	if ( (SDL_EventQ.size == 0 ||
+	      ((SDL_EventQ.tail+1) & (SDL_EventQ.size-1)) == SDL_EventQ.head) &&
+	     ! SDL_GrowEventQueue() ) {
+		/* Out of memory, drop event */
+		SDL_ReleaseEvents(1);
+		COUNT_EVENT(dropped, event);
+		return(0);
+	}
+	SDL_EventQ.event[SDL_EventQ.tail] = *event;
+	if (event->type == SDL_SYSWMEVENT) {
+		struct SDL_SysWMmsg *msg = SDL_AddWMmsg(event->syswm.msg);
+		if ( msg == NULL ) {
+			/* Out of memory, drop event */
+			SDL_ReleaseEvents(1);
+			COUNT_EVENT(dropped, event);
+			return(0);
+		}
+		SDL_EventQ.event[SDL_EventQ.tail].syswm.msg = msg;
+	}
+	COUNT_EVENT(queued, event);
+	SDL_EventQ.tail = (SDL_EventQ.tail+1) & (SDL_EventQ.size-1);
+	return(1);
+}
 
-	tail = (SDL_EventQ.tail+1)%MAXEVENTS;
-	if ( tail == SDL_EventQ.head ) {
-		/* Overflow, drop event */
-		added = 0;
-	} else {
-		SDL_EventQ.event[SDL_EventQ.tail] = *event;
-		if (event->type == SDL_SYSWMEVENT) {
-			/* Note that it's possible to lose an event */
-			int next = SDL_EventQ.wmmsg_next;
-			SDL_EventQ.wmmsg[next] = *event->syswm.msg;
-		        SDL_EventQ.event[SDL_EventQ.tail].syswm.msg =
-						&SDL_EventQ.wmmsg[next];
-			SDL_EventQ.wmmsg_next = (next+1)%MAXEVENTS;
+#ifdef SDL_EVENT_INBOX
+/* Move the events pushed without the lock into the queue, in the order
+   they were pushed.  With 'wait' set, this waits for slots that producers
+   have claimed but are still filling in, so an event added next goes
+   after everything pushed before it -- called with the queue locked
+ */
+static void SDL_DrainInbox(int wait)
+{
+	Uint32 pos = SDL_EventInbox.get;
+	Uint32 end = SDL_EventInbox.put;
+
+	for ( ; ; ) {
+		if ( SDL_EventInbox.slot[pos & (INBOXSIZE-1)].seq != pos+1 ) {
+			if ( wait && (Sint32)(end - pos) > 0 ) {
+				/* The producer may have been preempted, give
+				   it the processor instead of spinning */
+				SDL_Delay(0);
+				continue;
+			}
+			break;
 		}
-		SDL_EventQ.tail = tail;
-		added = 1;
-	}
-	return(added);
-}
-
-/* Cut an event, and return the next valid spot, or the tail */
-/*                           -- called with the queue locked */
-static int SDL_CutEvent(int spot)
-{
-	if ( spot == SDL_EventQ.head ) {
-		SDL_EventQ.head = (SDL_EventQ.head+1)%MAXEVENTS;
-		return(SDL_EventQ.head);
-	} else
-	if ( (spot+1)%MAXEVENTS == SDL_EventQ.tail ) {
-		SDL_EventQ.tail = spot;
-		return(SDL_EventQ.tail);
-	} else
-	/* We cut the middle -- shift everything over */
-	{
-		int here, next;
-
-		/* This can probably be optimized with SDL_memcpy() -- careful! */
-		if ( --SDL_EventQ.tail < 0 ) {
-			SDL_EventQ.tail = MAXEVENTS-1;
+		__sync_synchronize();	/* see the event the producer wrote */
+		SDL_AddEvent(&SDL_EventInbox.slot[pos & (INBOXSIZE-1)].event);
+		__sync_synchronize();	/* done with it before freeing the slot */
+		SDL_EventInbox.slot[pos & (INBOXSIZE-1)].seq = pos+INBOXSIZE;
+		++pos;
+	}
+	SDL_EventInbox.get = pos;
+}
+#endif
+
+/* Remove the events matching 'mask' from the head of the queue up to and
+   including 'last', moving the ones left in between up to the new head so
+   that taking events off the front costs nothing
+                             -- called with the queue locked */
+static void SDL_CutEvents(int last, Uint32 mask)
+{
+	const int wrap = SDL_EventQ.size-1;
+	int spot, keep;
+
+	keep = spot = last;
+	for ( ; ; ) {
+		if ( !(mask & SDL_EVENTMASK(SDL_EventQ.event[spot].type)) ) {
+			if ( keep != spot ) {
+				SDL_EventQ.event[keep] = SDL_EventQ.event[spot];
+			}
+			keep = (keep-1) & wrap;
 		}
-		for ( here=spot; here != SDL_EventQ.tail; here = next ) {
-			next = (here+1)%MAXEVENTS;
-			SDL_EventQ.event[here] = SDL_EventQ.event[next];
+		if ( spot == SDL_EventQ.head ) {
+			break;
 		}
-		return(spot);
+		spot = (spot-1) & wrap;
+	}
+	SDL_EventQ.head = (keep+1) & wrap;
+}
+
+/* Wake up the threads waiting for an event, after adding some */
+static void SDL_WakeEventWaiters(void)
+{
+#ifdef SDL_EVENT_INBOX
+	/* Don't read 'waiting' before the event is visible to the waiter */
+	__sync_synchronize();
+#endif
+	if ( SDL_EventWait.waiting ) {
+		SDL_mutexP(SDL_EventWait.lock);
+		SDL_CondBroadcast(SDL_EventWait.cond);
+		SDL_mutexV(SDL_EventWait.lock);
 	}
-	/* NOTREACHED */
 }
 
 /* Lock the event queue, take a peep at it, and unlock it */
@@ -325,16 +581,44 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 	if ( ! SDL_EventQ.active ) {
 		return(-1);
 	}
-	/* Lock the event queue */
+	i = 0;
 	used = 0;
+#ifdef SDL_EVENT_INBOX
+	if ( action == SDL_ADDEVENT ) {
+		/* System messages are copied into the queue, they can't wait */
+		while ( (i < numevents) &&
+		        (events[i].type != SDL_SYSWMEVENT) &&
+		        SDL_ReserveEvent() ) {
+			if ( ! SDL_InboxPut(&events[i]) ) {
+				SDL_ReleaseEvents(1);
+				break;
+			}
+			++i;
+		}
+		used = i;
+		if ( i == numevents ) {
+			SDL_WakeEventWaiters();
+			return(used);
+		}
+	}
+#endif
+	/* Lock the event queue */
 	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
+#ifdef SDL_EVENT_INBOX
+		SDL_DrainInbox(action == SDL_ADDEVENT);
+#endif
 		if ( action == SDL_ADDEVENT ) {
-			for ( i=0; i<numevents; ++i ) {
-				used += SDL_AddEvent(&events[i]);
+			for ( ; i<numevents; ++i ) {
+				if ( SDL_ReserveEvent() ) {
+					used += SDL_AddEvent(&events[i]);
+				} else {
+					/* Overflow, drop event */
+					COUNT_EVENT(dropped, &events[i]);
+				}
 			}
 		} else {
 			SDL_Event tmpevent;
-			int spot;
+			int spot, last;
 
 			/* If 'events' is NULL, just see if they exist */
 			if ( events == NULL ) {
@@ -342,18 +626,18 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 				numevents = 1;
 				events = &tmpevent;
 			}
+			last = -1;
 			spot = SDL_EventQ.head;
 			while ((used < numevents)&&(spot != SDL_EventQ.tail)) {
 				if ( mask & SDL_EVENTMASK(SDL_EventQ.event[spot].type) ) {
 					events[used++] = SDL_EventQ.event[spot];
-					if ( action == SDL_GETEVENT ) {
-						spot = SDL_CutEvent(spot);
-					} else {
-						spot = (spot+1)%MAXEVENTS;
-					}
-				} else {
-					spot = (spot+1)%MAXEVENTS;
+					last = spot;
 				}
+				spot = (spot+1) & (SDL_EventQ.size-1);
+			}
+			if ( (action == SDL_GETEVENT) && (used > 0) ) {
+				SDL_CutEvents(last, mask);
+				SDL_ReleaseEvents(used);
 			}
 		}
 		SDL_mutexV(SDL_EventQ.lock);
@@ -361,9 +645,103 @@ int SDL_PeepEvents(SDL_Event *events, int numevents, SDL_eventaction action,
 		SDL_SetError("Couldn't lock event queue");
 		used = -1;
 	}
+	/* Not with the queue locked, waiters take it inside their lock */
+	if ( (action == SDL_ADDEVENT) && (used > 0) ) {
+		SDL_WakeEventWaiters();
+	}
 	return(used);
 }
 
+Uint32 SDL_GetDroppedEvents(void)
+{
+	Uint32 dropped;
+	int i;
+
+	dropped = 0;
+	for ( i=0; i<SDL_NUMEVENTS; ++i ) {
+		dropped += SDL_EventQ.stats.dropped[i];
+	}
+	return(dropped);
+}
+
+void SDL_GetEventStats(SDL_EventStats *stats)
+{
+	if ( SDL_mutexP(SDL_EventQ.lock) == 0 ) {
+		*stats = SDL_EventQ.stats;
+		SDL_mutexV(SDL_EventQ.lock);
+	} else {
+		*stats = SDL_EventQ.stats;
+	}
+}
+
+static Sint16 AddMotion(Sint16 a, Sint16 b)
+{
+	int sum = a + b;
+
+	if ( sum > 32767 ) {
+		return(32767);
+	}
+	if ( sum < -32768 ) {
+		return(-32768);
+	}
+	return((Sint16)sum);
+}
+
+/* Add a mouse motion event.  When at least SDL_MotionCoalesce events are
+   waiting and the last of them is motion with the same buttons held, the
+   new motion is folded into it instead, so a fast mouse can't flood the
+   queue.  Only the last event is ever changed, so the motion stays in
+   order with the button and key events around it.
+ */
+int SDL_PushMotionEvent(SDL_Event *event)
+{
+	SDL_MouseMotionEvent *last;
+	int count, added;
+
+	if ( SDL_MotionCoalesce <= 0 || ! SDL_EventQ.active ) {
+		return(SDL_PushEvent(event));
+	}
+	if ( SDL_mutexP(SDL_EventQ.lock) < 0 ) {
+		SDL_SetError("Couldn't lock event queue");
+		return(-1);
+	}
+#ifdef SDL_EVENT_INBOX
+	SDL_DrainInbox(1);
+#endif
+	added = 0;
+	count = 0;
+	if ( SDL_EventQ.size ) {
+		count = (SDL_EventQ.tail-SDL_EventQ.head) & (SDL_EventQ.size-1);
+	}
+	last = NULL;
+	if ( count > 0 && count >= SDL_MotionCoalesce ) {
+		last = &SDL_EventQ.event[(SDL_EventQ.tail-1) &
+					(SDL_EventQ.size-1)].motion;
+		if ( last->type != SDL_MOUSEMOTION ||
+		     last->which != event->motion.which ||
+		     last->state != event->motion.state ) {
+			last = NULL;
+		}
+	}
+	if ( last ) {
+		last->x = event->motion.x;
+		last->y = event->motion.y;
+		last->xrel = AddMotion(last->xrel, event->motion.xrel);
+		last->yrel = AddMotion(last->yrel, event->motion.yrel);
+		COUNT_EVENT(coalesced, event);
+	} else if ( SDL_ReserveEvent() ) {
+		added = SDL_AddEvent(event);
+	} else {
+		COUNT_EVENT(dropped, event);
+	}
+	SDL_mutexV(SDL_EventQ.lock);
+
+	if ( added ) {
+		SDL_WakeEventWaiters();
+	}
+	return((last || added) ? 0 : -1);
+}
+
 /* Run the system dependent event loops */
 void SDL_PumpEvents(void)
 {
@@ -400,14 +778,71 @@ int SDL_PollEvent (SDL_Event *event)
 	return 1;
 }
 
+/* Sleep until an event is added, for at most 'ms' milliseconds, or for
+   as long as it takes if 'ms' is negative.
+ */
+static void SDL_WaitForEvents(int ms)
+{
+	/* Without the event thread, nothing reads the video driver and the
+	   joysticks or repeats keys while we sleep, so come back to pump
+	   them every timeslice.
+	 */
+	if ( !SDL_EventThread && (current_video
+#if !SDL_JOYSTICK_DISABLED
+	                          || SDL_numjoysticks
+#endif
+	                         ) ) {
+		if ( (ms < 0) || (ms > SDL_TIMESLICE) ) {
+			ms = SDL_TIMESLICE;
+		}
+	}
+	if ( !SDL_EventWait.cond ) {
+		SDL_Delay((ms < 0) ? SDL_TIMESLICE : ms);
+		return;
+	}
+
+	/* Look again once we're counted as waiting, so an event added
+	   before then can't be missed.
+	 */
+	SDL_mutexP(SDL_EventWait.lock);
+	++SDL_EventWait.waiting;
+	if ( SDL_PeepEvents(NULL, 0, SDL_PEEKEVENT, SDL_ALLEVENTS) == 0 ) {
+		if ( ms < 0 ) {
+			SDL_CondWait(SDL_EventWait.cond, SDL_EventWait.lock);
+		} else {
+			SDL_CondWaitTimeout(SDL_EventWait.cond,
+						SDL_EventWait.lock, ms);
+		}
+	}
+	--SDL_EventWait.waiting;
+	SDL_mutexV(SDL_EventWait.lock);
+}
+
 int SDL_WaitEvent (SDL_Event *event)
 {
+	return SDL_WaitEventTimeout(event, -1);
+}
+
+int SDL_WaitEventTimeout (SDL_Event *event, int timeout)
+{
+	Uint32 start, elapsed;
+
+	start = SDL_GetTicks();
 	while ( 1 ) {
 		SDL_PumpEvents();
 		switch(SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_ALLEVENTS)) {
 		    case -1: return 0;
 		    case 1: return 1;
-		    case 0: SDL_Delay(10);
+		    case 0: break;
+		}
+		if ( timeout < 0 ) {
+			SDL_WaitForEvents(-1);
+		} else {
+			elapsed = SDL_GetTicks() - start;
+			if ( elapsed >= (Uint32)timeout ) {
+				return 0;
+			}
+			SDL_WaitForEvents(timeout - elapsed);
 		}
 	}
 }
@@ -64,6 +64,9 @@ extern int SDL_PrivateExpose(void);
 extern int SDL_PrivateQuit(void);
 extern int SDL_PrivateSysWMEvent(SDL_SysWMmsg *message);
 
+/* Used by SDL_PrivateMouseMotion() to add motion that may be merged */
+extern int SDL_PushMotionEvent(SDL_Event *event);
+
 /* Used to clamp the mouse coordinates separately from the video surface */
 extern void SDL_SetMouseRange(int maxX, int maxY);
 
@@ -24,6 +24,7 @@
 #include "SDL_timer.h"
 #include "SDL_timer_c.h"
 #include "SDL_mutex.h"
+#include "SDL_thread.h"
 #include "SDL_systimer.h"
 
 /* #define DEBUG_TIMERS */
@@ -38,17 +39,61 @@ SDL_TimerCallback SDL_alarm_callback;
 /* Data used for a thread-based timer */
 static int SDL_timer_threaded = 0;
 
+/* A timer's index while it's out of the heap waiting for or running its
+   callback, and while it's unused
+ */
+#define TIMER_BUSY	-2
+#define TIMER_UNUSED	-1
+
 struct _SDL_TimerID {
 	Uint32 interval;
 	SDL_NewTimerCallback cb;
 	void *param;
-	Uint32 last_alarm;
-	struct _SDL_TimerID *next;
+	Uint32 deadline;		/* when the timer goes off next */
+	Uint32 base;			/* what the next deadline counts from */
+	int index;			/* position in the heap, or as above */
+	int generation;			/* SDL_timer_generation when added */
+	int worker;			/* the worker running its callbacks */
+	SDL_TimerStats stats;
+	struct _SDL_TimerID *next;	/* next unused or queued timer */
 };
 
-static SDL_TimerID SDL_timers = NULL;
+/* The timers are kept in a binary heap ordered by deadline, so the next
+   one due is always at the top.  A timer leaves the heap while its
+   callback is pending, so it never runs twice at once, and whoever runs
+   the callback puts it back or releases it.  Removed timers are recycled
+   rather than freed until SDL_TimerQuit(), so removing a timer that has
+   already gone away is harmless.
+ */
+static SDL_TimerID *SDL_timers = NULL;
+static int SDL_timers_max = 0;
+static int SDL_timers_busy = 0;
+static int SDL_timer_generation = 0;	/* bumped by SDL_SetTimer() */
+static SDL_TimerID SDL_free_timers = NULL;
 static SDL_mutex *SDL_timer_mutex;
-static volatile SDL_bool list_changed = SDL_FALSE;
+static SDL_cond *SDL_timer_cond;
+static SDL_bool SDL_timer_wakeup = SDL_FALSE;
+
+/* With SDL_TIMER_WORKERS set, callbacks run on that many worker threads
+   rather than on the thread watching the deadlines, so a slow callback
+   only holds up the timers sharing its worker.  Each timer sticks to one
+   worker, which runs its callbacks in order.
+ */
+#define MAX_TIMER_WORKERS	16
+
+typedef struct SDL_TimerWorker {
+	SDL_Thread *thread;
+	SDL_cond *cond;
+	SDL_TimerID head;		/* callbacks waiting to run */
+	SDL_TimerID tail;
+} SDL_TimerWorker;
+
+static SDL_TimerWorker *SDL_timer_workers = NULL;
+static int SDL_timer_num_workers = 0;
+static int SDL_timer_next_worker = 0;
+static SDL_bool SDL_timer_workers_quit = SDL_FALSE;
+
+static int SDLCALL RunTimerWorker(void *data);
 
 /* Set whether or not the timer should use a thread.
    This should not be called while the timer subsystem is running.
@@ -67,6 +112,70 @@ int SDL_SetTimerThreaded(int value)
 	return retval;
 }
 
+static void StartTimerWorkers(void)
+{
+	const char *env;
+	int i, num;
+
+	env = SDL_getenv("SDL_TIMER_WORKERS");
+	num = env ? SDL_atoi(env) : 0;
+	if ( num <= 0 ) {
+		return;
+	}
+	if ( num > MAX_TIMER_WORKERS ) {
+		num = MAX_TIMER_WORKERS;
+	}
+	SDL_timer_workers = (SDL_TimerWorker *)SDL_malloc(
+					num * sizeof(*SDL_timer_workers));
+	if ( SDL_timer_workers == NULL ) {
+		return;
+	}
+	SDL_memset(SDL_timer_workers, 0, num * sizeof(*SDL_timer_workers));
+	SDL_timer_workers_quit = SDL_FALSE;
+
+	/* Run the callbacks here if the workers can't be started */
+	for ( i=0; i<num; ++i ) {
+		SDL_TimerWorker *worker = &SDL_timer_workers[i];
+
+		worker->cond = SDL_CreateCond();
+		if ( worker->cond == NULL ) {
+			break;
+		}
+		worker->thread = SDL_CreateThread(RunTimerWorker, worker);
+		if ( worker->thread == NULL ) {
+			SDL_DestroyCond(worker->cond);
+			break;
+		}
+	}
+	SDL_timer_num_workers = i;
+	if ( SDL_timer_num_workers == 0 ) {
+		SDL_free(SDL_timer_workers);
+		SDL_timer_workers = NULL;
+	}
+}
+
+static void StopTimerWorkers(void)
+{
+	int i;
+
+	SDL_mutexP(SDL_timer_mutex);
+	SDL_timer_workers_quit = SDL_TRUE;
+	for ( i=0; i<SDL_timer_num_workers; ++i ) {
+		SDL_CondSignal(SDL_timer_workers[i].cond);
+	}
+	SDL_mutexV(SDL_timer_mutex);
+
+	for ( i=0; i<SDL_timer_num_workers; ++i ) {
+		SDL_WaitThread(SDL_timer_workers[i].thread, NULL);
+		SDL_DestroyCond(SDL_timer_workers[i].cond);
+	}
+	if ( SDL_timer_workers ) {
+		SDL_free(SDL_timer_workers);
+		SDL_timer_workers = NULL;
+	}
+	SDL_timer_num_workers = 0;
+}
+
 int SDL_TimerInit(void)
 {
 	int retval;
@@ -80,6 +189,8 @@ int SDL_TimerInit(void)
 	}
 	if ( SDL_timer_threaded ) {
 		SDL_timer_mutex = SDL_CreateMutex();
+		SDL_timer_cond = SDL_CreateCond();
+		StartTimerWorkers();
 	}
 	if ( retval == 0 ) {
 		SDL_timer_started = 1;
@@ -94,87 +205,288 @@ void SDL_TimerQuit(void)
 		SDL_SYS_TimerQuit();
 	}
 	if ( SDL_timer_threaded ) {
+		StopTimerWorkers();
+		SDL_DestroyCond(SDL_timer_cond);
+		SDL_timer_cond = NULL;
 		SDL_DestroyMutex(SDL_timer_mutex);
 		SDL_timer_mutex = NULL;
 	}
+	while ( SDL_free_timers ) {
+		SDL_TimerID freeme = SDL_free_timers;
+		SDL_free_timers = freeme->next;
+		SDL_free(freeme);
+	}
+	if ( SDL_timers ) {
+		SDL_free(SDL_timers);
+		SDL_timers = NULL;
+		SDL_timers_max = 0;
+	}
 	SDL_timer_started = 0;
 	SDL_timer_threaded = 0;
 }
 
-void SDL_ThreadedTimerCheck(void)
+/* Whether timer 'a' goes off before timer 'b', allowing for wraparound */
+#define TIMER_BEFORE(a, b)	((Sint32)((a)->deadline - (b)->deadline) < 0)
+
+static void HeapSet(int index, SDL_TimerID t)
 {
-	Uint32 now, ms;
-	SDL_TimerID t, prev, next;
-	SDL_bool removed;
+	SDL_timers[index] = t;
+	t->index = index;
+}
 
-	SDL_mutexP(SDL_timer_mutex);
-	list_changed = SDL_FALSE;
-	now = SDL_GetTicks();
-	for ( prev = NULL, t = SDL_timers; t; t = next ) {
-		removed = SDL_FALSE;
-		ms = t->interval - SDL_TIMESLICE;
-		next = t->next;
-		if ( (int)(now - t->last_alarm) > (int)ms ) {
-			struct _SDL_TimerID timer;
-
-			if ( (now - t->last_alarm) < t->interval ) {
-				t->last_alarm += t->interval;
-			} else {
-				t->last_alarm = now;
-			}
+/* Move the timer at 'index' up or down to where its deadline belongs */
+static void HeapFix(int index)
+{
+	SDL_TimerID t = SDL_timers[index];
+	int child;
+
+	while ( index > 0 && TIMER_BEFORE(t, SDL_timers[(index-1)/2]) ) {
+		HeapSet(index, SDL_timers[(index-1)/2]);
+		index = (index-1)/2;
+	}
+	while ( (child = 2*index+1) < SDL_timer_running ) {
+		if ( child+1 < SDL_timer_running &&
+		     TIMER_BEFORE(SDL_timers[child+1], SDL_timers[child]) ) {
+			++child;
+		}
+		if ( ! TIMER_BEFORE(SDL_timers[child], t) ) {
+			break;
+		}
+		HeapSet(index, SDL_timers[child]);
+		index = child;
+	}
+	HeapSet(index, t);
+}
+
+static void HeapRemove(SDL_TimerID t)
+{
+	int index = t->index;
+
+	--SDL_timer_running;
+	if ( index != SDL_timer_running ) {
+		HeapSet(index, SDL_timers[SDL_timer_running]);
+		HeapFix(index);
+	}
+	t->index = TIMER_UNUSED;
+}
+
+/* Put a timer that is no longer scheduled back on the unused list */
+static void ReleaseTimer(SDL_TimerID t)
+{
+	t->index = TIMER_UNUSED;
+	t->next = SDL_free_timers;
+	SDL_free_timers = t;
+}
+
+/* Called with the timer mutex held */
+static void WakeTimerThread(void)
+{
+	SDL_timer_wakeup = SDL_TRUE;
+	SDL_CondSignal(SDL_timer_cond);
+}
+
+/* Run the callback of a busy timer with the timer mutex held, then put it
+   back in the heap, or release it if it was removed or returned 0.
+ */
+static void RunTimerCallback(SDL_TimerID t)
+{
+	Uint32 late, ms;
+
+	if ( t->index != TIMER_BUSY ||
+	     t->generation != SDL_timer_generation ) {
+		/* Removed while waiting for a worker */
+		--SDL_timers_busy;
+		ReleaseTimer(t);
+		return;
+	}
+
+	late = SDL_GetTicks() - t->deadline;
+	++t->stats.calls;
+	t->stats.late_total += late;
+	if ( late > t->stats.late_max ) {
+		t->stats.late_max = late;
+	}
 #ifdef DEBUG_TIMERS
-			printf("Executing timer %p (thread = %d)\n",
-				t, SDL_ThreadID());
+	printf("Executing timer %p (thread = %d)\n",
+		t, SDL_ThreadID());
 #endif
-			timer = *t;
-			SDL_mutexV(SDL_timer_mutex);
-			ms = timer.cb(timer.interval, timer.param);
-			SDL_mutexP(SDL_timer_mutex);
-			if ( list_changed ) {
-				/* Abort, list of timers modified */
-				/* FIXME: what if ms was changed? */
-				break;
-			}
-			if ( ms != t->interval ) {
-				if ( ms ) {
-					t->interval = ROUND_RESOLUTION(ms);
-				} else {
-					/* Remove timer from the list */
+	SDL_mutexV(SDL_timer_mutex);
+	ms = t->cb(t->interval, t->param);
+	SDL_mutexP(SDL_timer_mutex);
+	--SDL_timers_busy;
+
+	if ( t->index != TIMER_BUSY ||
+	     t->generation != SDL_timer_generation ) {
+		/* Removed while the callback was running */
+		ReleaseTimer(t);
+	} else if ( ms == 0 ) {
 #ifdef DEBUG_TIMERS
-					printf("SDL: Removing timer %p\n", t);
+		printf("SDL: Removing timer %p\n", t);
 #endif
-					if ( prev ) {
-						prev->next = next;
-					} else {
-						SDL_timers = next;
-					}
-					SDL_free(t);
-					--SDL_timer_running;
-					removed = SDL_TRUE;
-				}
+		ReleaseTimer(t);
+	} else {
+		t->interval = ms;
+		t->deadline = t->base + t->interval;
+		HeapSet(SDL_timer_running++, t);
+		HeapFix(t->index);
+		if ( t->index == 0 && SDL_timer_workers ) {
+			/* Rescheduled from a worker, ahead of everything else */
+			WakeTimerThread();
+		}
+	}
+}
+
+/* Run or hand out the timers that are due, with the timer mutex held.
+   Returns the number of milliseconds until the next timer is due, or ~0
+   if there are no timers.
+ */
+static Uint32 SDL_RunTimers(void)
+{
+	Uint32 now;
+	SDL_TimerID t;
+
+	now = SDL_GetTicks();
+	while ( SDL_timer_running ) {
+		t = SDL_timers[0];
+		if ( (Sint32)(t->deadline - now) > 0 ) {
+			return(t->deadline - now);
+		}
+
+		/* Keep to the schedule, unless a whole interval was missed */
+		if ( (now - t->deadline) < t->interval ) {
+			t->base = t->deadline;
+		} else {
+			t->base = now;
+			++t->stats.missed;
+		}
+		HeapRemove(t);
+		t->index = TIMER_BUSY;
+		++SDL_timers_busy;
+
+		if ( SDL_timer_workers ) {
+			SDL_TimerWorker *worker = &SDL_timer_workers[t->worker];
+
+			t->next = NULL;
+			if ( worker->tail ) {
+				worker->tail->next = t;
+			} else {
+				worker->head = t;
 			}
+			worker->tail = t;
+			SDL_CondSignal(worker->cond);
+		} else {
+			RunTimerCallback(t);
+			now = SDL_GetTicks();
 		}
-		/* Don't update prev if the timer has disappeared */
-		if ( ! removed ) {
-			prev = t;
+	}
+	return((Uint32)~0);
+}
+
+static int SDLCALL RunTimerWorker(void *data)
+{
+	SDL_TimerWorker *worker = (SDL_TimerWorker *)data;
+	SDL_TimerID t;
+
+	SDL_mutexP(SDL_timer_mutex);
+	for ( ; ; ) {
+		while ( ! worker->head && ! SDL_timer_workers_quit ) {
+			SDL_CondWait(worker->cond, SDL_timer_mutex);
 		}
+		t = worker->head;
+		if ( t == NULL ) {
+			break;
+		}
+		worker->head = t->next;
+		if ( worker->head == NULL ) {
+			worker->tail = NULL;
+		}
+		RunTimerCallback(t);
 	}
 	SDL_mutexV(SDL_timer_mutex);
+	return(0);
+}
+
+void SDL_ThreadedTimerCheck(void)
+{
+	SDL_mutexP(SDL_timer_mutex);
+	SDL_RunTimers();
+	SDL_mutexV(SDL_timer_mutex);
+}
+
+void SDL_ThreadedTimerWait(void)
+{
+	Uint32 ms;
+
+	if ( ! SDL_timer_cond ) {
+		/* Not set up yet */
+		SDL_Delay(1);
+		return;
+	}
+	SDL_mutexP(SDL_timer_mutex);
+	ms = SDL_RunTimers();
+	if ( ! SDL_timer_wakeup ) {
+		if ( ms == (Uint32)~0 ) {
+			SDL_CondWait(SDL_timer_cond, SDL_timer_mutex);
+		} else {
+			SDL_CondWaitTimeout(SDL_timer_cond, SDL_timer_mutex, ms);
+		}
+	}
+	SDL_timer_wakeup = SDL_FALSE;
+	SDL_mutexV(SDL_timer_mutex);
+}
+
+void SDL_ThreadedTimerWake(void)
+{
+	if ( SDL_timer_cond ) {
+		SDL_mutexP(SDL_timer_mutex);
+		WakeTimerThread();
+		SDL_mutexV(SDL_timer_mutex);
+	}
 }
 
 static SDL_TimerID SDL_AddTimerInternal(Uint32 interval, SDL_NewTimerCallback callback, void *param)
 {
 	SDL_TimerID t;
-	t = (SDL_TimerID) SDL_malloc(sizeof(struct _SDL_TimerID));
+
+	/* Leave room to put back the timers that are out of the heap */
+	if ( SDL_timer_running + SDL_timers_busy == SDL_timers_max ) {
+		int max = SDL_timers_max ? SDL_timers_max * 2 : 16;
+		SDL_TimerID *timers = (SDL_TimerID *)SDL_realloc(SDL_timers,
+						max * sizeof(*timers));
+		if ( timers == NULL ) {
+			SDL_OutOfMemory();
+			return NULL;
+		}
+		SDL_timers = timers;
+		SDL_timers_max = max;
+	}
+	if ( SDL_free_timers ) {
+		t = SDL_free_timers;
+		SDL_free_timers = t->next;
+	} else {
+		t = (SDL_TimerID) SDL_malloc(sizeof(struct _SDL_TimerID));
+	}
 	if ( t ) {
-		t->interval = ROUND_RESOLUTION(interval);
+		t->interval = interval;
 		t->cb = callback;
 		t->param = param;
-		t->last_alarm = SDL_GetTicks();
-		t->next = SDL_timers;
-		SDL_timers = t;
-		++SDL_timer_running;
-		list_changed = SDL_TRUE;
+		t->deadline = SDL_GetTicks() + t->interval;
+		t->generation = SDL_timer_generation;
+		if ( SDL_timer_workers ) {
+			t->worker = SDL_timer_next_worker;
+			SDL_timer_next_worker = (SDL_timer_next_worker + 1) %
+						SDL_timer_num_workers;
+		} else {
+			t->worker = 0;
+		}
+		SDL_memset(&t->stats, 0, sizeof(t->stats));
+		t->next = NULL;
+		HeapSet(SDL_timer_running++, t);
+		HeapFix(t->index);
+		if ( t->index == 0 ) {
+			/* The timer thread may be sleeping past the new deadline */
+			WakeTimerThread();
+		}
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_AddTimer(%d) = %08x num_timers = %d\n", interval, (Uint32)t, SDL_timer_running);
@@ -203,27 +515,34 @@ SDL_TimerID SDL_AddTimer(Uint32 interval, SDL_NewTimerCallback callback, void *p
 	return t;
 }
 
+/* Whether 'id' is a timer that hasn't been removed, with the mutex held */
+static SDL_bool ValidTimer(SDL_TimerID id)
+{
+	if ( id == NULL || SDL_timers == NULL ) {
+		return SDL_FALSE;
+	}
+	if ( id->index == TIMER_BUSY ) {
+		return (id->generation == SDL_timer_generation);
+	}
+	return ( id->index >= 0 && id->index < SDL_timer_running &&
+	         SDL_timers[id->index] == id );
+}
+
 SDL_bool SDL_RemoveTimer(SDL_TimerID id)
 {
-	SDL_TimerID t, prev = NULL;
 	SDL_bool removed;
 
 	removed = SDL_FALSE;
 	SDL_mutexP(SDL_timer_mutex);
-	/* Look for id in the linked list of timers */
-	for (t = SDL_timers; t; prev=t, t = t->next ) {
-		if ( t == id ) {
-			if(prev) {
-				prev->next = t->next;
-			} else {
-				SDL_timers = t->next;
-			}
-			SDL_free(t);
-			--SDL_timer_running;
-			removed = SDL_TRUE;
-			list_changed = SDL_TRUE;
-			break;
+	if ( ValidTimer(id) ) {
+		if ( id->index == TIMER_BUSY ) {
+			/* Released once its callback is done with it */
+			id->index = TIMER_UNUSED;
+		} else {
+			HeapRemove(id);
+			ReleaseTimer(id);
 		}
+		removed = SDL_TRUE;
 	}
 #ifdef DEBUG_TIMERS
 	printf("SDL_RemoveTimer(%08x) = %d num_timers = %d thread = %d\n", (Uint32)id, removed, SDL_timer_running, SDL_ThreadID());
@@ -232,6 +551,48 @@ SDL_bool SDL_RemoveTimer(SDL_TimerID id)
 	return removed;
 }
 
+int SDL_GetTimerStats(SDL_TimerID id, SDL_TimerStats *stats)
+{
+	int retval;
+
+	if ( ! SDL_timer_mutex ) {
+		SDL_SetError("Timers are not running");
+		return(-1);
+	}
+	SDL_mutexP(SDL_timer_mutex);
+	if ( ValidTimer(id) ) {
+		*stats = id->stats;
+		retval = 0;
+	} else {
+		SDL_SetError("Invalid timer ID");
+		retval = -1;
+	}
+	SDL_mutexV(SDL_timer_mutex);
+	return(retval);
+}
+
+#if defined(SDL_HAS_64BIT_TYPE) && !defined(SDL_TIMER_UNIX)
+/* Platforms without a finer clock count milliseconds */
+Uint64 SDL_GetPerformanceCounter(void)
+{
+	return(SDL_GetTicks());
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return(1000);
+}
+
+void SDL_DelayUntil(Uint64 counter)
+{
+	Uint32 left = (Uint32)counter - SDL_GetTicks();
+
+	if ( (Sint32)left > 0 ) {
+		SDL_Delay(left);
+	}
+}
+#endif /* SDL_HAS_64BIT_TYPE && !SDL_TIMER_UNIX */
+
 /* Old style callback functions are wrapped through this */
 static Uint32 SDLCALL callback_wrapper(Uint32 ms, void *param)
 {
@@ -251,19 +612,18 @@ int SDL_SetTimer(Uint32 ms, SDL_TimerCallback callback)
 	if ( SDL_timer_threaded ) {
 		SDL_mutexP(SDL_timer_mutex);
 	}
-	if ( SDL_timer_running ) {	/* Stop any currently running timer */
-		if ( SDL_timer_threaded ) {
-			while ( SDL_timers ) {
-				SDL_TimerID freeme = SDL_timers;
-				SDL_timers = SDL_timers->next;
-				SDL_free(freeme);
-			}
-			SDL_timer_running = 0;
-			list_changed = SDL_TRUE;
-		} else {
-			SDL_SYS_StopTimer();
-			SDL_timer_running = 0;
+	/* Stop any currently running timer */
+	if ( SDL_timer_threaded ) {
+		while ( SDL_timer_running ) {
+			SDL_TimerID t = SDL_timers[SDL_timer_running-1];
+			HeapRemove(t);
+			ReleaseTimer(t);
 		}
+		/* The ones out of the heap go when their callbacks are done */
+		++SDL_timer_generation;
+	} else if ( SDL_timer_running ) {
+		SDL_SYS_StopTimer();
+		SDL_timer_running = 0;
 	}
 	if ( ms ) {
 		if ( SDL_timer_threaded ) {
@@ -44,3 +44,10 @@ extern void SDL_TimerQuit(void);
 
 /* This function is called from the SDL event thread if it is available */
 extern void SDL_ThreadedTimerCheck(void);
+
+/* A dedicated timer thread calls this in a loop instead: it runs the timers
+   that are due and then sleeps until the next one is, until a timer with
+   an earlier deadline is added, or until SDL_ThreadedTimerWake() is called.
+ */
+extern void SDL_ThreadedTimerWait(void);
+extern void SDL_ThreadedTimerWake(void);
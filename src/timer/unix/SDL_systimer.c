@@ -134,6 +134,91 @@ void SDL_Delay (Uint32 ms)
 #endif /* SDL_THREAD_PTH */
 }
 
+#ifdef SDL_HAS_64BIT_TYPE
+
+/* The performance counter counts nanoseconds or microseconds since start */
+#if HAVE_CLOCK_GETTIME
+#define PERFORMANCE_FREQUENCY	1000000000
+#else
+#define PERFORMANCE_FREQUENCY	1000000
+#endif
+
+Uint64 SDL_GetPerformanceCounter(void)
+{
+#if HAVE_CLOCK_GETTIME
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((Uint64)(now.tv_sec-start.tv_sec)*1000000000 +
+					now.tv_nsec - start.tv_nsec);
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return((Uint64)(now.tv_sec-start.tv_sec)*1000000 +
+					now.tv_usec - start.tv_usec);
+#endif
+}
+
+Uint64 SDL_GetPerformanceFrequency(void)
+{
+	return(PERFORMANCE_FREQUENCY);
+}
+
+void SDL_DelayUntil(Uint64 counter)
+{
+#if HAVE_CLOCK_GETTIME && defined(TIMER_ABSTIME) && !SDL_THREAD_PTH
+	struct timespec deadline;
+
+	/* Sleeping to an absolute time doesn't drift when it's interrupted
+	   and restarted, or when the thread is preempted before sleeping.
+	 */
+	deadline.tv_sec = start.tv_sec + (time_t)(counter / 1000000000);
+	deadline.tv_nsec = start.tv_nsec + (long)(counter % 1000000000);
+	if ( deadline.tv_nsec >= 1000000000 ) {
+		deadline.tv_nsec -= 1000000000;
+		++deadline.tv_sec;
+	}
+	while ( clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+					&deadline, NULL) == EINTR ) {
+		continue;
+	}
+#else
+	Uint64 now, left;
+
+	/* Sleep for what's left until the deadline, and check it again in
+	   case we woke up early because of a signal.
+	 */
+	while ( (now = SDL_GetPerformanceCounter()) < counter ) {
+		left = (counter - now) * (1000000000 / PERFORMANCE_FREQUENCY);
+#if SDL_THREAD_PTH
+		{
+			pth_time_t tv;
+			tv.tv_sec = (long)(left / 1000000000);
+			tv.tv_usec = (long)((left % 1000000000) / 1000);
+			pth_nap(tv);
+		}
+#elif HAVE_NANOSLEEP
+		{
+			struct timespec tv;
+			tv.tv_sec = (time_t)(left / 1000000000);
+			tv.tv_nsec = (long)(left % 1000000000);
+			nanosleep(&tv, NULL);
+		}
+#else
+		{
+			struct timeval tv;
+			/* Round up, so we don't spin on the last microsecond */
+			left += 999;
+			tv.tv_sec = (long)(left / 1000000000);
+			tv.tv_usec = (long)((left % 1000000000) / 1000);
+			select(0, NULL, NULL, NULL, &tv);
+		}
+#endif
+	}
+#endif /* HAVE_CLOCK_GETTIME && TIMER_ABSTIME */
+}
+
+#endif /* SDL_HAS_64BIT_TYPE */
+
 #ifdef USE_ITIMER
 
 static void HandleAlarm(int sig)
@@ -197,10 +282,7 @@ static SDL_Thread *timer = NULL;
 static int RunTimer(void *unused)
 {
 	while ( timer_alive ) {
-		if ( SDL_timer_running ) {
-			SDL_ThreadedTimerCheck();
-		}
-		SDL_Delay(1);
+		SDL_ThreadedTimerWait();
 	}
 	return(0);
 }
@@ -218,6 +300,7 @@ int SDL_SYS_TimerInit(void)
 void SDL_SYS_TimerQuit(void)
 {
 	timer_alive = 0;
+	SDL_ThreadedTimerWake();
 	if ( timer ) {
 		SDL_WaitThread(timer, NULL);
 		timer = NULL;
@@ -0,0 +1,251 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* A pool of worker threads for splitting pixel work into bands of rows.
+
+   Work is queued as jobs.  The thread that queued a job takes bands from
+   it too, and only waits for the bands the workers have already started,
+   so nothing is ever left waiting on a busy pool, and a band that queues
+   more work itself can't deadlock.
+ */
+
+#include "SDL_thread.h"
+#include "SDL_bands_c.h"
+
+#define MAX_BAND_WORKERS	16
+
+/* Below this many bytes, waking the workers costs more than it saves */
+#define MIN_BAND_BYTES		(256 * 1024)
+
+/* And no band gets fewer rows than this */
+#define MIN_BAND_ROWS		8
+
+typedef struct SDL_BandJob {
+	SDL_BandFunc func;
+	void *data;
+	int rows;
+	int bands;
+	int next_band;			/* the next band to hand out */
+	int pending;			/* bands not finished yet */
+	int failed;
+	char error[128];		/* the error of a band that failed */
+	struct SDL_BandJob *next;
+} SDL_BandJob;
+
+static SDL_Thread *SDL_band_workers[MAX_BAND_WORKERS];
+static int SDL_band_num_workers = 0;
+static SDL_mutex *SDL_band_mutex = NULL;
+static SDL_cond *SDL_band_work = NULL;		/* a job was queued */
+static SDL_cond *SDL_band_done = NULL;		/* a job was finished */
+static SDL_BandJob *SDL_band_head = NULL;
+static SDL_BandJob *SDL_band_tail = NULL;
+static SDL_bool SDL_band_quit = SDL_FALSE;
+
+/* Take the next band of a queued job, with the mutex held */
+static SDL_BandJob *TakeBand(SDL_BandJob *job, int *band)
+{
+	if ( job == NULL || job->next_band == job->bands ) {
+		return(NULL);
+	}
+	*band = job->next_band++;
+	if ( job->next_band == job->bands ) {
+		/* All handed out, the rest is up to whoever has them */
+		SDL_BandJob **prev = &SDL_band_head;
+		while ( *prev != job ) {
+			prev = &(*prev)->next;
+		}
+		*prev = job->next;
+		if ( SDL_band_tail == job ) {
+			SDL_band_tail = NULL;
+			if ( SDL_band_head ) {
+				SDL_band_tail = SDL_band_head;
+				while ( SDL_band_tail->next ) {
+					SDL_band_tail = SDL_band_tail->next;
+				}
+			}
+		}
+	}
+	return(job);
+}
+
+/* Run one band, without the mutex, and count it done with it held */
+static void RunBand(SDL_BandJob *job, int band, SDL_bool worker)
+{
+	int first = job->rows * band / job->bands;
+	int last = job->rows * (band + 1) / job->bands;
+	int retval;
+
+	SDL_mutexV(SDL_band_mutex);
+	retval = job->func(job->data, first, last);
+	SDL_mutexP(SDL_band_mutex);
+
+	if ( retval < 0 && !job->failed ) {
+		job->failed = 1;
+		if ( worker ) {
+			SDL_strlcpy(job->error, SDL_GetError(), sizeof(job->error));
+		} else {
+			job->error[0] = '\0';
+		}
+	}
+	if ( --job->pending == 0 ) {
+		SDL_CondBroadcast(SDL_band_done);
+	}
+}
+
+static int SDLCALL RunBandWorker(void *unused)
+{
+	SDL_BandJob *job;
+	int band;
+
+	SDL_mutexP(SDL_band_mutex);
+	while ( ! SDL_band_quit ) {
+		job = TakeBand(SDL_band_head, &band);
+		if ( job == NULL ) {
+			SDL_CondWait(SDL_band_work, SDL_band_mutex);
+			continue;
+		}
+		RunBand(job, band, SDL_TRUE);
+	}
+	SDL_mutexV(SDL_band_mutex);
+	return(0);
+}
+
+void SDL_StartBandWorkers(void)
+{
+	const char *env;
+	int i, num;
+
+	if ( SDL_band_num_workers > 0 ) {
+		return;
+	}
+	env = SDL_getenv("SDL_BLIT_THREADS");
+	num = env ? SDL_atoi(env) : 0;
+	if ( num <= 0 ) {
+		return;
+	}
+	if ( num > MAX_BAND_WORKERS ) {
+		num = MAX_BAND_WORKERS;
+	}
+
+	/* Everything runs on the calling thread if this fails */
+	SDL_band_mutex = SDL_CreateMutex();
+	SDL_band_work = SDL_CreateCond();
+	SDL_band_done = SDL_CreateCond();
+	if ( !SDL_band_mutex || !SDL_band_work || !SDL_band_done ) {
+		SDL_StopBandWorkers();
+		return;
+	}
+	SDL_band_quit = SDL_FALSE;
+	for ( i=0; i<num; ++i ) {
+		SDL_band_workers[i] = SDL_CreateThread(RunBandWorker, NULL);
+		if ( SDL_band_workers[i] == NULL ) {
+			break;
+		}
+	}
+	SDL_band_num_workers = i;
+	if ( SDL_band_num_workers == 0 ) {
+		SDL_StopBandWorkers();
+	}
+}
+
+void SDL_StopBandWorkers(void)
+{
+	int i;
+
+	if ( SDL_band_mutex ) {
+		SDL_mutexP(SDL_band_mutex);
+		SDL_band_quit = SDL_TRUE;
+		if ( SDL_band_work ) {
+			SDL_CondBroadcast(SDL_band_work);
+		}
+		SDL_mutexV(SDL_band_mutex);
+	}
+	for ( i=0; i<SDL_band_num_workers; ++i ) {
+		SDL_WaitThread(SDL_band_workers[i], NULL);
+	}
+	SDL_band_num_workers = 0;
+
+	if ( SDL_band_done ) {
+		SDL_DestroyCond(SDL_band_done);
+		SDL_band_done = NULL;
+	}
+	if ( SDL_band_work ) {
+		SDL_DestroyCond(SDL_band_work);
+		SDL_band_work = NULL;
+	}
+	if ( SDL_band_mutex ) {
+		SDL_DestroyMutex(SDL_band_mutex);
+		SDL_band_mutex = NULL;
+	}
+}
+
+int SDL_RunBands(SDL_BandFunc func, void *data, int rows, int bytes)
+{
+	SDL_BandJob job;
+	int band;
+
+	if ( SDL_band_num_workers == 0 || bytes < MIN_BAND_BYTES ||
+	     rows < 2 * MIN_BAND_ROWS ) {
+		return func(data, 0, rows);
+	}
+
+	/* One band for each worker and one for this thread */
+	job.func = func;
+	job.data = data;
+	job.rows = rows;
+	job.bands = SDL_band_num_workers + 1;
+	if ( job.bands > rows / MIN_BAND_ROWS ) {
+		job.bands = rows / MIN_BAND_ROWS;
+	}
+	job.next_band = 0;
+	job.pending = job.bands;
+	job.failed = 0;
+	job.error[0] = '\0';
+	job.next = NULL;
+
+	SDL_mutexP(SDL_band_mutex);
+	if ( SDL_band_tail ) {
+		SDL_band_tail->next = &job;
+	} else {
+		SDL_band_head = &job;
+	}
+	SDL_band_tail = &job;
+	SDL_CondBroadcast(SDL_band_work);
+
+	while ( TakeBand(&job, &band) ) {
+		RunBand(&job, band, SDL_FALSE);
+	}
+	while ( job.pending > 0 ) {
+		SDL_CondWait(SDL_band_done, SDL_band_mutex);
+	}
+	SDL_mutexV(SDL_band_mutex);
+
+	if ( job.failed ) {
+		/* Bands that failed here have already set the error */
+		if ( job.error[0] ) {
+			SDL_SetError("%s", job.error);
+		}
+		return(-1);
+	}
+	return(0);
+}
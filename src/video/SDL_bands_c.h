@@ -0,0 +1,40 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Splitting large blits, fills and stretches into bands of rows that run
+   on a pool of worker threads.  The pool is only started if the
+   SDL_BLIT_THREADS environment variable is set when SDL_Init() is called.
+*/
+
+/* Do rows 'first' to 'last' - 1 of some work, returning 0 or -1 */
+typedef int (*SDL_BandFunc)(void *data, int first, int last);
+
+extern void SDL_StartBandWorkers(void);
+extern void SDL_StopBandWorkers(void);
+
+/* Run 'func' over 'rows' rows, split into bands on the workers if there
+   are any and 'bytes' (the memory touched) is worth it, or all at once
+   on this thread otherwise.  Bands never share a row, so the result is
+   the same either way.  Returns -1 with the error set if any band failed.
+*/
+extern int SDL_RunBands(SDL_BandFunc func, void *data, int rows, int bytes);
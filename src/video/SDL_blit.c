@@ -26,6 +26,7 @@
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
 #include "SDL_pixels_c.h"
+#include "SDL_bands_c.h"
 
 #if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && SDL_ASSEMBLY_ROUTINES
 #define MMX_ASMBLIT
@@ -39,6 +40,26 @@
 #include "mmx.h"
 #endif
 
+/* A blit split into bands of rows by SDL_RunBands() */
+typedef struct {
+	SDL_BlitInfo info;
+	SDL_loblit blit;
+	int s_pitch;
+	int d_pitch;
+} SDL_BlitBands;
+
+static int RunBlitBand(void *data, int first, int last)
+{
+	SDL_BlitBands *bands = (SDL_BlitBands *)data;
+	SDL_BlitInfo info = bands->info;
+
+	info.s_pixels += first * bands->s_pitch;
+	info.d_pixels += first * bands->d_pitch;
+	info.s_height = info.d_height = last - first;
+	bands->blit(&info);
+	return(0);
+}
+
 /* The general purpose software blit routine */
 static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 			SDL_Surface *dst, SDL_Rect *dstrect)
@@ -93,8 +114,24 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		info.dst = dst->format;
 		RunBlit = src->map->sw_data->blit;
 
-		/* Run the actual software blit */
-		RunBlit(&info);
+		/* Run the actual software blit, in bands if it's big enough.
+		   Blits within a surface go in order, in case they overlap,
+		   and video memory is left to the one thread.
+		 */
+		if ( src != dst &&
+		     !((src->flags | dst->flags) & SDL_HWSURFACE) ) {
+			SDL_BlitBands bands;
+			bands.info = info;
+			bands.blit = RunBlit;
+			bands.s_pitch = src->pitch;
+			bands.d_pitch = dst->pitch;
+			SDL_RunBands(RunBlitBand, &bands, info.d_height,
+			             info.d_height *
+			             (info.s_width * src->format->BytesPerPixel +
+			              info.d_width * dst->format->BytesPerPixel));
+		} else {
+			RunBlit(&info);
+		}
 	}
 
 	/* We need to unlock the surfaces if they're locked */
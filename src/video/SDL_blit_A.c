@@ -50,6 +50,17 @@
 #  endif
 #endif /* SDL_ASSEMBLY_ROUTINES */
 
+/* SSE2 kernels when the compiler targets it (always on x86-64), with
+   AVX2 versions picked at runtime */
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_ASMBLIT 1
+#include <emmintrin.h>
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define AVX2_ASMBLIT 1
+#include <immintrin.h>
+#endif
+#endif
+
 /* Function to check the CPU flags */
 #include "SDL_cpuinfo.h"
 #if GCC_ASMBLIT
@@ -2424,6 +2435,518 @@ static void Blit555to555SurfaceAlphaMMX(SDL_BlitInfo *info)
 }
 #endif /* GCC_ASMBLIT, MSVC_ASMBLIT */
 
+#if SSE2_ASMBLIT
+/* 16-bit lanes holding the channels in 'chanmask', for two 32-bit pixels
+   unpacked to 16 bits per channel, repeated for the next two pixels */
+static __inline__ __m128i ChannelLanesSSE2(Uint32 chanmask)
+{
+	__m128i lanes = _mm_cvtsi32_si128(chanmask);
+	lanes = _mm_unpacklo_epi8(lanes, lanes);
+	return _mm_shuffle_epi32(lanes, _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+/* d + ((s - d) * mult >> 8) for each channel of four 32-bit pixels,
+   computed the same way as the MMX blitters */
+static __inline__ __m128i BlendSSE2(__m128i s, __m128i d,
+				    __m128i multlo, __m128i multhi)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i slo = _mm_unpacklo_epi8(s, zero);
+	__m128i shi = _mm_unpackhi_epi8(s, zero);
+	__m128i dlo = _mm_unpacklo_epi8(d, zero);
+	__m128i dhi = _mm_unpackhi_epi8(d, zero);
+
+	slo = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(slo, dlo), multlo), 8);
+	shi = _mm_srli_epi16(_mm_mullo_epi16(_mm_sub_epi16(shi, dhi), multhi), 8);
+	dlo = _mm_add_epi8(dlo, slo);
+	dhi = _mm_add_epi8(dhi, shi);
+	return _mm_packus_epi16(dlo, dhi);
+}
+
+/* Blend four ARGB pixels with their own alpha, like
+   BlitRGBtoRGBPixelAlphaMMX: opaque pixels are copied, and the
+   destination alpha is kept */
+static __inline__ __m128i BlendPixelAlphaSSE2(__m128i s, __m128i d,
+			__m128i amask, __m128i ashift, __m128i chanlanes)
+{
+	__m128i alpha = _mm_and_si128(s, amask);
+	__m128i opaque = _mm_cmpeq_epi32(alpha, amask);
+	__m128i blend;
+
+	alpha = _mm_srl_epi32(alpha, ashift);
+	alpha = _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16));
+	blend = BlendSSE2(s, d,
+		_mm_and_si128(_mm_unpacklo_epi32(alpha, alpha), chanlanes),
+		_mm_and_si128(_mm_unpackhi_epi32(alpha, alpha), chanlanes));
+
+	s = _mm_or_si128(_mm_andnot_si128(amask, s), _mm_and_si128(amask, d));
+	return _mm_or_si128(_mm_and_si128(opaque, s),
+			    _mm_andnot_si128(opaque, blend));
+}
+
+/* fast ARGB888->(A)RGB888 blending with pixel alpha */
+static void BlitRGBtoRGBPixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat* sf = info->src;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(sf->Amask);
+	const __m128i ashift = _mm_cvtsi32_si128(sf->Ashift);
+	const __m128i chanlanes = ChannelLanesSSE2(~sf->Amask);
+
+	while(height--) {
+		int n = width;
+		for(; n >= 4; n -= 4) {
+			__m128i s = _mm_loadu_si128((__m128i *)srcp);
+			__m128i d;
+			/* leave transparent runs alone */
+			d = _mm_cmpeq_epi32(_mm_and_si128(s, amask), zero);
+			if(_mm_movemask_epi8(d) != 0xffff) {
+				d = _mm_loadu_si128((__m128i *)dstp);
+				d = BlendPixelAlphaSSE2(s, d, amask, ashift, chanlanes);
+				_mm_storeu_si128((__m128i *)dstp, d);
+			}
+			srcp += 4;
+			dstp += 4;
+		}
+		for(; n > 0; --n) {
+			__m128i s = _mm_cvtsi32_si128(*srcp++);
+			__m128i d = _mm_cvtsi32_si128(*dstp);
+			d = BlendPixelAlphaSSE2(s, d, amask, ashift, chanlanes);
+			*dstp++ = _mm_cvtsi128_si32(d);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* fast RGB888->(A)RGB888 blending with surface alpha */
+static void BlitRGBtoRGBSurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat* df = info->dst;
+	const __m128i dalpha = _mm_set1_epi32(df->Amask);
+	/* alpha=128 needs no special case, the result is the same */
+	const __m128i mult = _mm_and_si128(_mm_set1_epi16(info->src->alpha),
+		ChannelLanesSSE2((0xff << df->Rshift) | (0xff << df->Gshift)
+				 | (0xff << df->Bshift)));
+
+	while(height--) {
+		int n = width;
+		for(; n >= 4; n -= 4) {
+			__m128i s = _mm_loadu_si128((__m128i *)srcp);
+			__m128i d = _mm_loadu_si128((__m128i *)dstp);
+			d = _mm_or_si128(BlendSSE2(s, d, mult, mult), dalpha);
+			_mm_storeu_si128((__m128i *)dstp, d);
+			srcp += 4;
+			dstp += 4;
+		}
+		for(; n > 0; --n) {
+			__m128i s = _mm_cvtsi32_si128(*srcp++);
+			__m128i d = _mm_cvtsi32_si128(*dstp);
+			d = _mm_or_si128(BlendSSE2(s, d, mult, mult), dalpha);
+			*dstp++ = _mm_cvtsi128_si32(d);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* d + ((s - d) * alpha >> 5) & mask on four G0RAB pixels, exactly as the
+   C blitters compute it.  There is no 32-bit multiply in SSE2, but alpha
+   fits in 16 bits so the low half of the product can be built from the
+   16-bit ones.  'alpha' holds the alpha in both halves of each lane. */
+static __inline__ __m128i Blend16SSE2(__m128i s, __m128i d,
+				      __m128i alpha, __m128i mask)
+{
+	__m128i diff = _mm_sub_epi32(s, d);
+	__m128i lo = _mm_mullo_epi16(diff, alpha);
+	__m128i hi = _mm_mulhi_epu16(diff, alpha);
+
+	diff = _mm_add_epi32(lo, _mm_slli_epi32(hi, 16));
+	d = _mm_add_epi32(d, _mm_srli_epi32(diff, 5));
+	return _mm_and_si128(d, mask);
+}
+
+/* Pack the low 16 bits of the 32-bit lanes of a and b */
+static __inline__ __m128i Pack16SSE2(__m128i a, __m128i b)
+{
+	a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+	b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+/* Blend four ARGB8888 pixels onto four 16-bit pixels zero extended to 32
+   bits, like BlitARGBto565PixelAlpha and BlitARGBto555PixelAlpha */
+static __inline__ __m128i BlendARGBto16SSE2(__m128i s, __m128i d, int is555)
+{
+	__m128i alpha = _mm_srli_epi32(s, 27);	/* downscale alpha to 5 bits */
+	__m128i opaque = _mm_cmpeq_epi32(alpha, _mm_set1_epi32(31));
+	__m128i transparent = _mm_cmpeq_epi32(alpha, _mm_setzero_si128());
+	__m128i mask, conv, blend;
+
+	if(is555) {
+		mask = _mm_set1_epi32(0x03e07c1f);
+		conv = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 9),
+						  _mm_set1_epi32(0x7c00)),
+				    _mm_and_si128(_mm_srli_epi32(s, 6),
+						  _mm_set1_epi32(0x3e0)));
+		blend = _mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(0xf800)), 10);
+		blend = _mm_or_si128(blend, _mm_and_si128(_mm_srli_epi32(s, 9),
+						  _mm_set1_epi32(0x7c00)));
+	} else {
+		mask = _mm_set1_epi32(0x07e0f81f);
+		conv = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(s, 8),
+						  _mm_set1_epi32(0xf800)),
+				    _mm_and_si128(_mm_srli_epi32(s, 5),
+						  _mm_set1_epi32(0x7e0)));
+		blend = _mm_slli_epi32(_mm_and_si128(s, _mm_set1_epi32(0xfc00)), 11);
+		blend = _mm_or_si128(blend, _mm_and_si128(_mm_srli_epi32(s, 8),
+						  _mm_set1_epi32(0xf800)));
+	}
+	s = _mm_and_si128(_mm_srli_epi32(s, 3), _mm_set1_epi32(0x1f));
+	conv = _mm_or_si128(conv, s);
+	blend = _mm_or_si128(blend, s);
+
+	/* transparent pixels are left alone, unused bit included */
+	conv = _mm_or_si128(_mm_and_si128(opaque, conv),
+			    _mm_and_si128(transparent, d));
+	opaque = _mm_or_si128(opaque, transparent);
+
+	d = _mm_and_si128(_mm_or_si128(d, _mm_slli_epi32(d, 16)), mask);
+	blend = Blend16SSE2(blend, d,
+			    _mm_or_si128(alpha, _mm_slli_epi32(alpha, 16)), mask);
+	blend = _mm_or_si128(blend, _mm_srli_epi32(blend, 16));
+	return _mm_or_si128(conv, _mm_andnot_si128(opaque, blend));
+}
+
+static __inline__ void BlitARGBto16PixelAlphaSSE2(SDL_BlitInfo *info,
+						  int is555)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i amask = _mm_set1_epi32(0xf8000000);
+
+	while(height--) {
+		int n = width;
+		for(; n >= 8; n -= 8) {
+			__m128i s0 = _mm_loadu_si128((__m128i *)srcp);
+			__m128i s1 = _mm_loadu_si128((__m128i *)(srcp + 4));
+			__m128i d;
+			/* leave transparent runs alone */
+			d = _mm_and_si128(_mm_or_si128(s0, s1), amask);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(d, zero)) != 0xffff) {
+				d = _mm_loadu_si128((__m128i *)dstp);
+				d = Pack16SSE2(
+				    BlendARGBto16SSE2(s0, _mm_unpacklo_epi16(d, zero), is555),
+				    BlendARGBto16SSE2(s1, _mm_unpackhi_epi16(d, zero), is555));
+				_mm_storeu_si128((__m128i *)dstp, d);
+			}
+			srcp += 8;
+			dstp += 8;
+		}
+		for(; n > 0; --n) {
+			__m128i s = _mm_cvtsi32_si128(*srcp++);
+			__m128i d = _mm_cvtsi32_si128(*dstp);
+			d = BlendARGBto16SSE2(s, d, is555);
+			*dstp++ = (Uint16)_mm_cvtsi128_si32(d);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* fast ARGB8888->RGB565 blending with pixel alpha */
+static void BlitARGBto565PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaSSE2(info, 0);
+}
+
+/* fast ARGB8888->RGB555 blending with pixel alpha */
+static void BlitARGBto555PixelAlphaSSE2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaSSE2(info, 1);
+}
+
+/* Blend eight 16-bit pixels with a 5-bit alpha, or average them when
+   alpha is 128, like Blit565to565SurfaceAlpha and Blit555to555SurfaceAlpha.
+   'mask' is the G0RAB mask and 'mask50' the BLEND16_50 one. */
+static __inline__ __m128i BlendSurfaceAlpha16SSE2(__m128i s, __m128i d,
+				unsigned alpha, __m128i mask, __m128i mask50)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i s0, s1, d0, d1, a;
+
+	if(alpha == 128) {
+		s0 = _mm_srli_epi16(_mm_and_si128(s, mask50), 1);
+		d0 = _mm_srli_epi16(_mm_and_si128(d, mask50), 1);
+		s1 = _mm_andnot_si128(mask50, _mm_and_si128(s, d));
+		return _mm_add_epi16(_mm_add_epi16(s0, d0), s1);
+	}
+	a = _mm_set1_epi16(alpha >> 3);	/* downscale alpha to 5 bits */
+	s0 = _mm_unpacklo_epi16(s, zero);
+	s1 = _mm_unpackhi_epi16(s, zero);
+	d0 = _mm_unpacklo_epi16(d, zero);
+	d1 = _mm_unpackhi_epi16(d, zero);
+	s0 = _mm_and_si128(_mm_or_si128(s0, _mm_slli_epi32(s0, 16)), mask);
+	s1 = _mm_and_si128(_mm_or_si128(s1, _mm_slli_epi32(s1, 16)), mask);
+	d0 = _mm_and_si128(_mm_or_si128(d0, _mm_slli_epi32(d0, 16)), mask);
+	d1 = _mm_and_si128(_mm_or_si128(d1, _mm_slli_epi32(d1, 16)), mask);
+	d0 = Blend16SSE2(s0, d0, a, mask);
+	d1 = Blend16SSE2(s1, d1, a, mask);
+	d0 = _mm_or_si128(d0, _mm_srli_epi32(d0, 16));
+	d1 = _mm_or_si128(d1, _mm_srli_epi32(d1, 16));
+	return Pack16SSE2(d0, d1);
+}
+
+static __inline__ void Blit16to16SurfaceAlphaSSE2(SDL_BlitInfo *info,
+					Uint32 mask32, Uint16 mask50)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *srcp = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip >> 1;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	unsigned alpha = info->src->alpha;
+	const __m128i mask = _mm_set1_epi32(mask32);
+	const __m128i m50 = _mm_set1_epi16(mask50);
+
+	while(height--) {
+		int n = width;
+		for(; n >= 8; n -= 8) {
+			__m128i s = _mm_loadu_si128((__m128i *)srcp);
+			__m128i d = _mm_loadu_si128((__m128i *)dstp);
+			d = BlendSurfaceAlpha16SSE2(s, d, alpha, mask, m50);
+			_mm_storeu_si128((__m128i *)dstp, d);
+			srcp += 8;
+			dstp += 8;
+		}
+		for(; n > 0; --n) {
+			__m128i s = _mm_cvtsi32_si128(*srcp++);
+			__m128i d = _mm_cvtsi32_si128(*dstp);
+			d = BlendSurfaceAlpha16SSE2(s, d, alpha, mask, m50);
+			*dstp++ = (Uint16)_mm_cvtsi128_si32(d);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* fast RGB565->RGB565 blending with surface alpha */
+static void Blit565to565SurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit16to16SurfaceAlphaSSE2(info, 0x07e0f81f, 0xf7de);
+}
+
+/* fast RGB555->RGB555 blending with surface alpha */
+static void Blit555to555SurfaceAlphaSSE2(SDL_BlitInfo *info)
+{
+	Blit16to16SurfaceAlphaSSE2(info, 0x03e07c1f, 0xfbde);
+}
+#endif /* SSE2_ASMBLIT */
+
+#if AVX2_ASMBLIT
+/* The same kernels eight pixels at a time.  These are built for AVX2
+   whatever the compiler flags, and only called when SDL_HasAVX2() says
+   so.  The unpack and pack instructions work within each 128-bit half,
+   so the pixels come back out in the order they went in. */
+#define AVX2_TARGET	__attribute__((target("avx2")))
+
+static __inline__ AVX2_TARGET __m256i BlendPixelAlphaAVX2(__m256i s,
+	__m256i d, __m256i amask, __m128i ashift, __m256i chanlanes)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i alpha = _mm256_and_si256(s, amask);
+	__m256i opaque = _mm256_cmpeq_epi32(alpha, amask);
+	__m256i slo, shi, dlo, dhi, blend;
+
+	alpha = _mm256_srl_epi32(alpha, ashift);
+	alpha = _mm256_or_si256(alpha, _mm256_slli_epi32(alpha, 16));
+	slo = _mm256_unpacklo_epi8(s, zero);
+	shi = _mm256_unpackhi_epi8(s, zero);
+	dlo = _mm256_unpacklo_epi8(d, zero);
+	dhi = _mm256_unpackhi_epi8(d, zero);
+	slo = _mm256_mullo_epi16(_mm256_sub_epi16(slo, dlo), _mm256_and_si256(
+			_mm256_unpacklo_epi32(alpha, alpha), chanlanes));
+	shi = _mm256_mullo_epi16(_mm256_sub_epi16(shi, dhi), _mm256_and_si256(
+			_mm256_unpackhi_epi32(alpha, alpha), chanlanes));
+	dlo = _mm256_add_epi8(dlo, _mm256_srli_epi16(slo, 8));
+	dhi = _mm256_add_epi8(dhi, _mm256_srli_epi16(shi, 8));
+	blend = _mm256_packus_epi16(dlo, dhi);
+
+	s = _mm256_or_si256(_mm256_andnot_si256(amask, s),
+			    _mm256_and_si256(amask, d));
+	return _mm256_blendv_epi8(blend, s, opaque);
+}
+
+/* fast ARGB888->(A)RGB888 blending with pixel alpha */
+static AVX2_TARGET void BlitRGBtoRGBPixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	SDL_PixelFormat* sf = info->src;
+	const __m256i amask = _mm256_set1_epi32(sf->Amask);
+	const __m128i ashift = _mm_cvtsi32_si128(sf->Ashift);
+	const __m128i chanlanes = ChannelLanesSSE2(~sf->Amask);
+	const __m256i chanlanes8 = _mm256_broadcastsi128_si256(chanlanes);
+
+	while(height--) {
+		int n = width;
+		for(; n >= 8; n -= 8) {
+			__m256i s = _mm256_loadu_si256((__m256i *)srcp);
+			__m256i d;
+			/* leave transparent runs alone */
+			if(!_mm256_testz_si256(s, amask)) {
+				d = _mm256_loadu_si256((__m256i *)dstp);
+				d = BlendPixelAlphaAVX2(s, d, amask, ashift,
+							chanlanes8);
+				_mm256_storeu_si256((__m256i *)dstp, d);
+			}
+			srcp += 8;
+			dstp += 8;
+		}
+		for(; n > 0; --n) {
+			__m128i s = _mm_cvtsi32_si128(*srcp++);
+			__m128i d = _mm_cvtsi32_si128(*dstp);
+			d = BlendPixelAlphaSSE2(s, d,
+				_mm256_castsi256_si128(amask), ashift, chanlanes);
+			*dstp++ = _mm_cvtsi128_si32(d);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* See Blend16SSE2(), AVX2 does have the 32-bit multiply */
+static __inline__ AVX2_TARGET __m256i BlendARGBto16AVX2(__m256i s,
+						__m256i d, int is555)
+{
+	__m256i alpha = _mm256_srli_epi32(s, 27);	/* downscale alpha to 5 bits */
+	__m256i opaque = _mm256_cmpeq_epi32(alpha, _mm256_set1_epi32(31));
+	__m256i transparent = _mm256_cmpeq_epi32(alpha, _mm256_setzero_si256());
+	__m256i mask, conv, blend;
+
+	if(is555) {
+		mask = _mm256_set1_epi32(0x03e07c1f);
+		conv = _mm256_or_si256(
+			_mm256_and_si256(_mm256_srli_epi32(s, 9),
+					 _mm256_set1_epi32(0x7c00)),
+			_mm256_and_si256(_mm256_srli_epi32(s, 6),
+					 _mm256_set1_epi32(0x3e0)));
+		blend = _mm256_or_si256(
+			_mm256_slli_epi32(_mm256_and_si256(s,
+					 _mm256_set1_epi32(0xf800)), 10),
+			_mm256_and_si256(_mm256_srli_epi32(s, 9),
+					 _mm256_set1_epi32(0x7c00)));
+	} else {
+		mask = _mm256_set1_epi32(0x07e0f81f);
+		conv = _mm256_or_si256(
+			_mm256_and_si256(_mm256_srli_epi32(s, 8),
+					 _mm256_set1_epi32(0xf800)),
+			_mm256_and_si256(_mm256_srli_epi32(s, 5),
+					 _mm256_set1_epi32(0x7e0)));
+		blend = _mm256_or_si256(
+			_mm256_slli_epi32(_mm256_and_si256(s,
+					 _mm256_set1_epi32(0xfc00)), 11),
+			_mm256_and_si256(_mm256_srli_epi32(s, 8),
+					 _mm256_set1_epi32(0xf800)));
+	}
+	s = _mm256_and_si256(_mm256_srli_epi32(s, 3), _mm256_set1_epi32(0x1f));
+	conv = _mm256_or_si256(conv, s);
+	blend = _mm256_or_si256(blend, s);
+
+	/* transparent pixels are left alone, unused bit included */
+	conv = _mm256_blendv_epi8(conv, d, transparent);
+	opaque = _mm256_or_si256(opaque, transparent);
+
+	d = _mm256_and_si256(_mm256_or_si256(d, _mm256_slli_epi32(d, 16)), mask);
+	blend = _mm256_mullo_epi32(_mm256_sub_epi32(blend, d), alpha);
+	blend = _mm256_add_epi32(d, _mm256_srli_epi32(blend, 5));
+	blend = _mm256_and_si256(blend, mask);
+	blend = _mm256_or_si256(blend, _mm256_srli_epi32(blend, 16));
+	return _mm256_blendv_epi8(blend, conv, opaque);
+}
+
+static __inline__ AVX2_TARGET void BlitARGBto16PixelAlphaAVX2(
+					SDL_BlitInfo *info, int is555)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	const __m256i amask = _mm256_set1_epi32(0xf8000000);
+	const __m256i low16 = _mm256_set1_epi32(0xffff);
+
+	while(height--) {
+		int n = width;
+		for(; n >= 16; n -= 16) {
+			__m256i s0 = _mm256_loadu_si256((__m256i *)srcp);
+			__m256i s1 = _mm256_loadu_si256((__m256i *)(srcp + 8));
+			__m256i d0, d1;
+			/* leave transparent runs alone */
+			if(!_mm256_testz_si256(_mm256_or_si256(s0, s1), amask)) {
+				d0 = _mm256_cvtepu16_epi32(
+					_mm_loadu_si128((__m128i *)dstp));
+				d1 = _mm256_cvtepu16_epi32(
+					_mm_loadu_si128((__m128i *)(dstp + 8)));
+				d0 = _mm256_and_si256(
+					BlendARGBto16AVX2(s0, d0, is555), low16);
+				d1 = _mm256_and_si256(
+					BlendARGBto16AVX2(s1, d1, is555), low16);
+				d0 = _mm256_permute4x64_epi64(
+					_mm256_packus_epi32(d0, d1),
+					_MM_SHUFFLE(3, 1, 2, 0));
+				_mm256_storeu_si256((__m256i *)dstp, d0);
+			}
+			srcp += 16;
+			dstp += 16;
+		}
+		for(; n > 0; --n) {
+			__m128i s = _mm_cvtsi32_si128(*srcp++);
+			__m128i d = _mm_cvtsi32_si128(*dstp);
+			d = BlendARGBto16SSE2(s, d, is555);
+			*dstp++ = (Uint16)_mm_cvtsi128_si32(d);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* fast ARGB8888->RGB565 blending with pixel alpha */
+static AVX2_TARGET void BlitARGBto565PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaAVX2(info, 0);
+}
+
+/* fast ARGB8888->RGB555 blending with pixel alpha */
+static AVX2_TARGET void BlitARGBto555PixelAlphaAVX2(SDL_BlitInfo *info)
+{
+	BlitARGBto16PixelAlphaAVX2(info, 1);
+}
+#endif /* AVX2_ASMBLIT */
+
 /* fast RGB565->RGB565 blending with surface alpha */
 static void Blit565to565SurfaceAlpha(SDL_BlitInfo *info)
 {
@@ -2746,6 +3269,10 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		if(surface->map->identity) {
 		    if(df->Gmask == 0x7e0)
 		    {
+#if SSE2_ASMBLIT
+		if(SDL_HasSSE2())
+			return Blit565to565SurfaceAlphaSSE2;
+#endif
 #if MMX_ASMBLIT
 		if(SDL_HasMMX())
 			return Blit565to565SurfaceAlphaMMX;
@@ -2755,6 +3282,10 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		    }
 		    else if(df->Gmask == 0x3e0)
 		    {
+#if SSE2_ASMBLIT
+		if(SDL_HasSSE2())
+			return Blit555to555SurfaceAlphaSSE2;
+#endif
 #if MMX_ASMBLIT
 		if(SDL_HasMMX())
 			return Blit555to555SurfaceAlphaMMX;
@@ -2771,6 +3302,13 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		   && sf->Bmask == df->Bmask
 		   && sf->BytesPerPixel == 4)
 		{
+#if SSE2_ASMBLIT
+			if(sf->Rshift % 8 == 0
+			   && sf->Gshift % 8 == 0
+			   && sf->Bshift % 8 == 0
+			   && SDL_HasSSE2())
+			    return BlitRGBtoRGBSurfaceAlphaSSE2;
+#endif
 #if MMX_ASMBLIT
 			if(sf->Rshift % 8 == 0
 			   && sf->Gshift % 8 == 0
@@ -2819,10 +3357,27 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Gmask == 0xff00
 	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
-		if(df->Gmask == 0x7e0)
+		if(df->Gmask == 0x7e0) {
+#if AVX2_ASMBLIT
+		    if(SDL_HasAVX2())
+			return BlitARGBto565PixelAlphaAVX2;
+#endif
+#if SSE2_ASMBLIT
+		    if(SDL_HasSSE2())
+			return BlitARGBto565PixelAlphaSSE2;
+#endif
 		    return BlitARGBto565PixelAlpha;
-		else if(df->Gmask == 0x3e0)
+		} else if(df->Gmask == 0x3e0) {
+#if AVX2_ASMBLIT
+		    if(SDL_HasAVX2())
+			return BlitARGBto555PixelAlphaAVX2;
+#endif
+#if SSE2_ASMBLIT
+		    if(SDL_HasSSE2())
+			return BlitARGBto555PixelAlphaSSE2;
+#endif
 		    return BlitARGBto555PixelAlpha;
+		}
 	    }
 	    return BlitNtoNPixelAlpha;
 
@@ -2832,6 +3387,21 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Bmask == df->Bmask
 	       && sf->BytesPerPixel == 4)
 	    {
+#if SSE2_ASMBLIT
+		if(sf->Rshift % 8 == 0
+		   && sf->Gshift % 8 == 0
+		   && sf->Bshift % 8 == 0
+		   && sf->Ashift % 8 == 0
+		   && sf->Aloss == 0)
+		{
+#if AVX2_ASMBLIT
+			if(SDL_HasAVX2())
+				return BlitRGBtoRGBPixelAlphaAVX2;
+#endif
+			if(SDL_HasSSE2())
+				return BlitRGBtoRGBPixelAlphaSSE2;
+		}
+#endif
 #if MMX_ASMBLIT
 		if(sf->Rshift % 8 == 0
 		   && sf->Gshift % 8 == 0
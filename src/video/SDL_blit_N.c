@@ -28,6 +28,15 @@
 
 /* Functions to blit from N-bit surfaces to other surfaces */
 
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_BLITTERS 1
+#include <emmintrin.h>
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define SSSE3_BLITTERS 1
+#include <tmmintrin.h>
+#endif
+#endif
+
 #if SDL_ALTIVEC_BLITTERS
 #if __MWERKS__
 #pragma altivec_model on
@@ -828,6 +837,10 @@ static Uint32 GetBlitFeatures( void )
                 /* Feature 4 is dont-use-prefetch */
                 /* !!!! FIXME: Check for G5 or later, not the cache size! Always prefetch on a G4. */
                 | ((GetL3CacheSize() == 0) ? 4 : 0)
+                /* Feature 8 is has-SSE2 */
+                | ((SDL_HasSSE2()) ? 8 : 0)
+                /* Feature 16 is has-SSSE3 */
+                | ((SDL_HasSSSE3()) ? 16 : 0)
             );
         }
     }
@@ -837,8 +850,10 @@ static Uint32 GetBlitFeatures( void )
 #pragma altivec_model off
 #endif
 #else
-/* Feature 1 is has-MMX */
-#define GetBlitFeatures() ((Uint32)(SDL_HasMMX() ? 1 : 0))
+/* Feature 1 is has-MMX, 8 is has-SSE2, 16 is has-SSSE3 */
+#define GetBlitFeatures() ((Uint32)((SDL_HasMMX() ? 1 : 0) | \
+				    (SDL_HasSSE2() ? 8 : 0) | \
+				    (SDL_HasSSSE3() ? 16 : 0)))
 #endif
 
 /* This is now endian dependent */
@@ -2269,6 +2284,326 @@ static void BlitNtoNKeyCopyAlpha(SDL_BlitInfo *info)
 	}
 }
 
+#if SSE2_BLITTERS
+/* Vector versions of BlitNtoN and BlitNtoNCopyAlpha for formats with 8-bit
+   channels on their 24 or 32-bit side.  They give the same results as the
+   C blitters, which SDL_CalculateBlitN falls back to for other formats. */
+static int ByteChannels(const SDL_PixelFormat *fmt)
+{
+	if ( fmt->Rloss | fmt->Gloss | fmt->Bloss ) {
+		return 0;
+	}
+	if ( (fmt->Rshift | fmt->Gshift | fmt->Bshift) & 7 ) {
+		return 0;
+	}
+	if ( fmt->Amask && (fmt->Aloss || (fmt->Ashift & 7)) ) {
+		return 0;
+	}
+	return 1;
+}
+
+/* A pixel is converted as the OR of terms ((pixel >> down) & mask) << up,
+   one for each channel, and the constant alpha bits */
+#define MAX_TERMS	4
+typedef struct {
+	int count;
+	__m128i down[MAX_TERMS];
+	__m128i mask[MAX_TERMS];
+	__m128i up[MAX_TERMS];
+	__m128i set;
+} SSE2Convert;
+
+static void AddChannelSSE2(SSE2Convert *conv, Uint32 smask,
+			int sshift, int sloss, int dshift, int dloss)
+{
+	int i = conv->count++;
+	Uint32 mask = smask >> sshift;
+
+	/* (((pixel & smask) >> sshift << sloss) >> dloss) << dshift */
+	if ( sloss >= dloss ) {
+		conv->down[i] = _mm_cvtsi32_si128(sshift);
+		conv->up[i] = _mm_cvtsi32_si128(dshift + sloss - dloss);
+	} else {
+		conv->down[i] = _mm_cvtsi32_si128(sshift + dloss - sloss);
+		conv->up[i] = _mm_cvtsi32_si128(dshift);
+		mask >>= dloss - sloss;
+	}
+	conv->mask[i] = _mm_set1_epi32(mask);
+}
+
+static void BuildConvertSSE2(SSE2Convert *conv, const SDL_PixelFormat *srcfmt,
+					const SDL_PixelFormat *dstfmt)
+{
+	const Uint32 smask[3] = { srcfmt->Rmask, srcfmt->Gmask, srcfmt->Bmask };
+	const int sshift[3] = { srcfmt->Rshift, srcfmt->Gshift, srcfmt->Bshift };
+	const int sloss[3] = { srcfmt->Rloss, srcfmt->Gloss, srcfmt->Bloss };
+	const int dshift[3] = { dstfmt->Rshift, dstfmt->Gshift, dstfmt->Bshift };
+	const int dloss[3] = { dstfmt->Rloss, dstfmt->Gloss, dstfmt->Bloss };
+	Uint32 set = 0;
+	int i;
+
+	conv->count = 0;
+	for ( i = 0; i < 3; ++i ) {
+		AddChannelSSE2(conv, smask[i], sshift[i], sloss[i],
+			       dshift[i], dloss[i]);
+	}
+	if ( dstfmt->Amask ) {
+		if ( srcfmt->Amask ) {
+			AddChannelSSE2(conv, srcfmt->Amask, srcfmt->Ashift,
+				       srcfmt->Aloss, dstfmt->Ashift, dstfmt->Aloss);
+		} else {
+			set = (srcfmt->alpha >> dstfmt->Aloss) << dstfmt->Ashift;
+		}
+	}
+	conv->set = _mm_set1_epi32(set);
+}
+
+static __inline__ __m128i ConvertSSE2(__m128i p, const SSE2Convert *conv)
+{
+	__m128i out = conv->set;
+	int i;
+
+	for ( i = 0; i < conv->count; ++i ) {
+		__m128i c = _mm_and_si128(_mm_srl_epi32(p, conv->down[i]),
+					  conv->mask[i]);
+		out = _mm_or_si128(out, _mm_sll_epi32(c, conv->up[i]));
+	}
+	return out;
+}
+
+/* 32-bit to 16-bit, eight pixels at a time */
+static void Blit4to2SSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *src = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip / 4;
+	Uint16 *dst = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip / 2;
+	SSE2Convert conv;
+
+	BuildConvertSSE2(&conv, info->src, info->dst);
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8 ) {
+			__m128i lo = ConvertSSE2(
+				_mm_loadu_si128((__m128i *)src), &conv);
+			__m128i hi = ConvertSSE2(
+				_mm_loadu_si128((__m128i *)(src + 4)), &conv);
+			/* pack without saturating */
+			lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+			hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+			_mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+			src += 8;
+			dst += 8;
+		}
+		for ( ; n > 0; --n ) {
+			__m128i p = ConvertSSE2(_mm_cvtsi32_si128(*src++), &conv);
+			*dst++ = (Uint16)_mm_cvtsi128_si32(p);
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+
+/* 16-bit to 32-bit, eight pixels at a time */
+static void Blit2to4SSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *src = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip / 2;
+	Uint32 *dst = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip / 4;
+	const __m128i zero = _mm_setzero_si128();
+	SSE2Convert conv;
+
+	BuildConvertSSE2(&conv, info->src, info->dst);
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8 ) {
+			__m128i p = _mm_loadu_si128((__m128i *)src);
+			_mm_storeu_si128((__m128i *)dst,
+				ConvertSSE2(_mm_unpacklo_epi16(p, zero), &conv));
+			_mm_storeu_si128((__m128i *)(dst + 4),
+				ConvertSSE2(_mm_unpackhi_epi16(p, zero), &conv));
+			src += 8;
+			dst += 8;
+		}
+		for ( ; n > 0; --n ) {
+			__m128i p = ConvertSSE2(_mm_cvtsi32_si128(*src++), &conv);
+			*dst++ = _mm_cvtsi128_si32(p);
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+
+/* v * 255 / 31 (or 63) rounded down, as in the RGB565 lookup tables,
+   by multiplying with the reciprocal */
+static __inline__ __m128i Widen565SSE2(__m128i v, __m128i recip, int shift)
+{
+	v = _mm_sub_epi16(_mm_slli_epi16(v, 8), v);
+	return _mm_srli_epi16(_mm_mulhi_epu16(v, recip), shift);
+}
+
+/* Eight RGB565 pixels to 32-bit, 'order' gives the channel of each byte
+   of the destination pixel, lowest first: red, green, blue or alpha */
+static __inline__ void Convert565SSE2(__m128i p, const int *order,
+				      __m128i *lo, __m128i *hi)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1f);
+	const __m128i mask3 = _mm_set1_epi16(0x07);
+	const __m128i mask3hi = _mm_set1_epi16(0x38);
+	const __m128i recip5 = _mm_set1_epi16(8457);	/* 2^18 / 31 */
+	const __m128i recip6 = _mm_set1_epi16(8323);	/* 2^19 / 63 */
+	__m128i ch[4], g, low, high;
+
+	ch[0] = Widen565SSE2(_mm_srli_epi16(p, 11), recip5, 2);
+	ch[2] = Widen565SSE2(_mm_and_si128(p, mask5), recip5, 2);
+	ch[3] = _mm_set1_epi16(0xff);
+
+	/* The tables look green up in two halves, one from each byte */
+	g = _mm_srli_epi16(p, 5);
+	ch[1] = _mm_add_epi16(
+		Widen565SSE2(_mm_and_si128(g, mask3hi), recip6, 3),
+		Widen565SSE2(_mm_and_si128(g, mask3), recip6, 3));
+
+	low = _mm_or_si128(ch[order[0]], _mm_slli_epi16(ch[order[1]], 8));
+	high = _mm_or_si128(ch[order[2]], _mm_slli_epi16(ch[order[3]], 8));
+	*lo = _mm_unpacklo_epi16(low, high);
+	*hi = _mm_unpackhi_epi16(low, high);
+}
+
+/* Special optimized blit for RGB 5-6-5 --> 32-bit RGB surfaces with
+   alpha, giving the same results as Blit_RGB565_32() and its tables */
+static void Blit_RGB565_32SSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *src = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip / 2;
+	Uint32 *dst = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip / 4;
+	SDL_PixelFormat *dstfmt = info->dst;
+	__m128i lo, hi;
+	int order[4];
+
+	order[dstfmt->Rshift / 8] = 0;
+	order[dstfmt->Gshift / 8] = 1;
+	order[dstfmt->Bshift / 8] = 2;
+	order[dstfmt->Ashift / 8] = 3;
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8 ) {
+			Convert565SSE2(_mm_loadu_si128((__m128i *)src), order,
+				       &lo, &hi);
+			_mm_storeu_si128((__m128i *)dst, lo);
+			_mm_storeu_si128((__m128i *)(dst + 4), hi);
+			src += 8;
+			dst += 8;
+		}
+		for ( ; n > 0; --n ) {
+			Convert565SSE2(_mm_cvtsi32_si128(*src++), order,
+				       &lo, &hi);
+			*dst++ = _mm_cvtsi128_si32(lo);
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+#endif /* SSE2_BLITTERS */
+
+#if SSSE3_BLITTERS
+/* Byte shuffles between 24 and 32-bit formats with 8-bit channels: RGB
+   order swaps, 24-bit packing and unpacking, and alpha copied, set or
+   dropped.  Four pixels go through one pshufb.  These are built for SSSE3
+   whatever the compiler flags, and only used when the CPU has it. */
+#define SSSE3_TARGET	__attribute__((target("ssse3")))
+
+/* The source byte for each destination byte of four pixels, 0x80 for a
+   zero byte, and the destination alpha byte set from the surface alpha */
+static void BuildShuffle(const SDL_PixelFormat *srcfmt,
+		const SDL_PixelFormat *dstfmt, Uint8 shuffle[16],
+		int *alpha_byte, Uint8 *alpha)
+{
+	const int srcbpp = srcfmt->BytesPerPixel;
+	const int dstbpp = dstfmt->BytesPerPixel;
+	int i;
+
+	SDL_memset(shuffle, 0x80, 16);
+	for ( i = 0; i < 4; ++i ) {
+		Uint8 *d = shuffle + i * dstbpp;
+		const int s = i * srcbpp;
+		d[dstfmt->Rshift / 8] = s + srcfmt->Rshift / 8;
+		d[dstfmt->Gshift / 8] = s + srcfmt->Gshift / 8;
+		d[dstfmt->Bshift / 8] = s + srcfmt->Bshift / 8;
+		if ( dstfmt->Amask && srcfmt->Amask ) {
+			d[dstfmt->Ashift / 8] = s + srcfmt->Ashift / 8;
+		}
+	}
+	*alpha_byte = -1;
+	*alpha = 0;
+	if ( dstfmt->Amask && !srcfmt->Amask ) {
+		*alpha_byte = dstfmt->Ashift / 8;
+		*alpha = srcfmt->alpha;
+	}
+}
+
+static SSSE3_TARGET void BlitNtoNShuffleSSSE3(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	const int srcbpp = info->src->BytesPerPixel;
+	const int dstbpp = info->dst->BytesPerPixel;
+	/* 16 bytes are loaded for four pixels, stay within the row */
+	const int minpixels = (srcbpp == 3) ? 6 : 4;
+	Uint8 table[16];
+	int alpha_byte;
+	Uint8 alpha;
+	__m128i shuffle, set;
+
+	BuildShuffle(info->src, info->dst, table, &alpha_byte, &alpha);
+	shuffle = _mm_loadu_si128((__m128i *)table);
+	set = _mm_set1_epi32(alpha_byte < 0 ? 0 : alpha << (alpha_byte * 8));
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= minpixels; n -= 4 ) {
+			__m128i p = _mm_loadu_si128((__m128i *)src);
+			p = _mm_or_si128(_mm_shuffle_epi8(p, shuffle), set);
+			if ( dstbpp == 4 ) {
+				_mm_storeu_si128((__m128i *)dst, p);
+			} else {
+				_mm_storel_epi64((__m128i *)dst, p);
+				*(Uint32 *)(dst + 8) =
+					_mm_cvtsi128_si32(_mm_srli_si128(p, 8));
+			}
+			src += 4 * srcbpp;
+			dst += 4 * dstbpp;
+		}
+		for ( ; n > 0; --n ) {
+			int i;
+			for ( i = 0; i < dstbpp; ++i ) {
+				dst[i] = (table[i] & 0x80) ? 0 : src[table[i]];
+			}
+			if ( alpha_byte >= 0 ) {
+				dst[alpha_byte] = alpha;
+			}
+			src += srcbpp;
+			dst += dstbpp;
+		}
+		src += srcskip;
+		dst += dstskip;
+	}
+}
+#endif /* SSSE3_BLITTERS */
+
 /* Normal N to N optimized blitters */
 struct blit_table {
 	Uint32 srcR, srcG, srcB;
@@ -2297,6 +2632,20 @@ static const struct blit_table normal_blit_2[] = {
       2, NULL, Blit_RGB565_32Altivec, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
     { 0x00007C00,0x000003E0,0x0000001F, 4, 0x00000000,0x00000000,0x00000000,
       2, NULL, Blit_RGB555_32Altivec, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#if SSE2_BLITTERS
+    /* has-SSE2 */
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
+      8, NULL, Blit_RGB565_32SSE2, SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x000000FF,0x0000FF00,0x00FF0000,
+      8, NULL, Blit_RGB565_32SSE2, SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0xFF000000,0x00FF0000,0x0000FF00,
+      8, NULL, Blit_RGB565_32SSE2, SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x0000FF00,0x00FF0000,0xFF000000,
+      8, NULL, Blit_RGB565_32SSE2, SET_ALPHA },
+    /* has-SSE2, 8-bit destination channels */
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      8, NULL, Blit2to4SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
 #endif
     { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
       0, NULL, Blit_RGB565_ARGB8888, SET_ALPHA },
@@ -2311,7 +2660,14 @@ static const struct blit_table normal_blit_2[] = {
     { 0,0,0, 0, 0,0,0, 0, NULL, BlitNtoN, 0 }
 };
 static const struct blit_table normal_blit_3[] = {
-	/* Default for 24-bit RGB source, never optimized */
+#if SSSE3_BLITTERS
+    /* has-SSSE3, 8-bit channels */
+    { 0x00000000,0x00000000,0x00000000, 3, 0x00000000,0x00000000,0x00000000,
+      16, NULL, BlitNtoNShuffleSSSE3, NO_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      16, NULL, BlitNtoNShuffleSSSE3, NO_ALPHA | SET_ALPHA },
+#endif
+	/* Default for 24-bit RGB source, used if no other blitter matches */
     { 0,0,0, 0, 0,0,0, 0, NULL, BlitNtoN, 0 }
 };
 static const struct blit_table normal_blit_4[] = {
@@ -2355,6 +2711,18 @@ static const struct blit_table normal_blit_4[] = {
     /* has-altivec */
     { 0x00000000,0x00000000,0x00000000, 2, 0x0000F800,0x000007E0,0x0000001F,
       2, NULL, Blit_RGB888_RGB565Altivec, NO_ALPHA },
+#endif
+#if SSSE3_BLITTERS
+    /* has-SSSE3, 8-bit channels */
+    { 0x00000000,0x00000000,0x00000000, 3, 0x00000000,0x00000000,0x00000000,
+      16, NULL, BlitNtoNShuffleSSSE3, NO_ALPHA },
+    { 0x00000000,0x00000000,0x00000000, 4, 0x00000000,0x00000000,0x00000000,
+      16, NULL, BlitNtoNShuffleSSSE3, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#if SSE2_BLITTERS
+    /* has-SSE2, 8-bit source channels */
+    { 0x00000000,0x00000000,0x00000000, 2, 0x00000000,0x00000000,0x00000000,
+      8, NULL, Blit4to2SSE2, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
 #endif
     { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
       0, NULL, Blit_RGB888_RGB565, NO_ALPHA },
@@ -2460,6 +2828,20 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 		sdata->aux_data = table[which].aux_data;
 		blitfun = table[which].blitfunc;
 
+#if SSE2_BLITTERS
+		/* The generic vector blitters need 8-bit channels */
+		if ( (blitfun == Blit2to4SSE2 && !ByteChannels(dstfmt)) ||
+		     (blitfun == Blit4to2SSE2 && !ByteChannels(srcfmt)) ) {
+			blitfun = BlitNtoN;
+		}
+#endif
+#if SSSE3_BLITTERS
+		if ( blitfun == BlitNtoNShuffleSSSE3 &&
+		     !(ByteChannels(srcfmt) && ByteChannels(dstfmt)) ) {
+			blitfun = BlitNtoN;
+		}
+#endif
+
 		if(blitfun == BlitNtoN) {  /* default C fallback catch-all. Slow! */
 			/* Fastpath C fallback: 32bit RGB<->RGBA blit with matching RGB */
 			if ( srcfmt->BytesPerPixel == 4 && dstfmt->BytesPerPixel == 4 &&
@@ -0,0 +1,322 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Software rectangle fill for every surface depth */
+
+#include "SDL_video.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_fillrect_c.h"
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_FILL 1
+#include <emmintrin.h>
+#endif
+
+/* Fills bigger than this don't stay in the cache anyway, so they are
+   written around it with non-temporal stores instead of evicting
+   everything else on the way.
+*/
+#define STREAM_FILL_BYTES	(2 * 1024 * 1024)
+
+/* The pixel repeated over this many bytes, a whole number of 1, 2, 3 and
+   4 byte pixels and of 16 byte vectors, plus room to start at any byte
+   of the first pixel.
+*/
+#define PATTERN_PERIOD	48
+#define PATTERN_BYTES	(PATTERN_PERIOD + 16)
+
+static void BuildPattern(Uint8 *pattern, int bpp, Uint32 color)
+{
+	union {
+		Uint8 bytes[4];
+		Uint16 u16;
+		Uint32 u32;
+	} pixel;
+	int i;
+
+	switch (bpp) {
+	    case 1:
+		pixel.bytes[0] = (Uint8)color;
+		break;
+	    case 2:
+		pixel.u16 = (Uint16)color;
+		break;
+	    case 3:
+		#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+			color <<= 8;
+		#endif
+		pixel.u32 = color;
+		break;
+	    default:
+		pixel.u32 = color;
+		break;
+	}
+	for ( i=0; i<PATTERN_BYTES; ++i ) {
+		pattern[i] = pixel.bytes[i % bpp];
+	}
+}
+
+/* 1 and 4 bit pixels are packed with the leftmost pixel in the high bits
+   of each byte, the way SDL_blit_0.c reads them.
+*/
+static void FillBits(SDL_Surface *dst, const SDL_Rect *rect, Uint32 color)
+{
+	int bpp = dst->format->BitsPerPixel;
+	int first = rect->x * bpp;
+	int last = (rect->x + rect->w) * bpp;
+	Uint8 *row = (Uint8 *)dst->pixels + rect->y * dst->pitch;
+	Uint8 fill, head, tail;
+	int y;
+
+	if ( bpp == 1 ) {
+		fill = (color & 1) ? 0xFF : 0x00;
+	} else {
+		fill = (Uint8)((color & 0x0F) * 0x11);
+	}
+	head = (Uint8)(0xFF >> (first & 7));
+	tail = (Uint8)~(0xFF >> (last & 7));
+
+	for ( y=rect->h; y; --y ) {
+		int i = first >> 3;
+		int end = last >> 3;
+
+		if ( i == end ) {
+			Uint8 mask = head & tail;
+			row[i] = (row[i] & ~mask) | (fill & mask);
+		} else {
+			if ( first & 7 ) {
+				row[i] = (row[i] & ~head) | (fill & head);
+				++i;
+			}
+			SDL_memset(row + i, fill, end - i);
+			if ( last & 7 ) {
+				row[end] = (row[end] & ~tail) | (fill & tail);
+			}
+		}
+		row += dst->pitch;
+	}
+}
+
+#if SSE2_FILL
+/* Aligned 16 byte stores, three vectors at a time so a 24-bit pixel
+   pattern lines up again after every round.
+*/
+static void FillSSE2(Uint8 *row, int pitch, int len, int h,
+		     const Uint8 *pattern, int bpp, int stream)
+{
+	while ( h-- ) {
+		Uint8 *d = row;
+		int n = len;
+		int head = (int)(-(uintptr_t)d & 15);
+		const Uint8 *p;
+		__m128i v0, v1, v2;
+
+		if ( head > n ) {
+			head = n;
+		}
+		SDL_memcpy(d, pattern, head);
+		d += head;
+		n -= head;
+
+		p = pattern + (head % bpp);
+		v0 = _mm_loadu_si128((const __m128i *)p);
+		v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+		v2 = _mm_loadu_si128((const __m128i *)(p + 32));
+		if ( stream ) {
+			for ( ; n >= 48; n -= 48, d += 48 ) {
+				_mm_stream_si128((__m128i *)d, v0);
+				_mm_stream_si128((__m128i *)(d + 16), v1);
+				_mm_stream_si128((__m128i *)(d + 32), v2);
+			}
+		} else {
+			for ( ; n >= 48; n -= 48, d += 48 ) {
+				_mm_store_si128((__m128i *)d, v0);
+				_mm_store_si128((__m128i *)(d + 16), v1);
+				_mm_store_si128((__m128i *)(d + 32), v2);
+			}
+		}
+		if ( n >= 16 ) {
+			_mm_store_si128((__m128i *)d, v0);
+			if ( n >= 32 ) {
+				_mm_store_si128((__m128i *)(d + 16), v1);
+			}
+		}
+		SDL_memcpy(d + (n & ~15), p + (n & ~15), n & 15);
+		row += pitch;
+	}
+	if ( stream ) {
+		_mm_sfence();
+	}
+}
+#endif /* SSE2_FILL */
+
+static void FillC(SDL_Surface *dst, Uint8 *row, int len, int h,
+		  const Uint8 *pattern, Uint32 color)
+{
+	int bpp = dst->format->BytesPerPixel;
+	int x, y;
+
+	if ( bpp == 1 || color == 0 ) {
+		if ( !color && !((uintptr_t)row&3) && !(len&3) && !(dst->pitch&3) ) {
+			int n = len >> 2;
+			for ( y=h; y; --y ) {
+				SDL_memset4(row, 0, n);
+				row += dst->pitch;
+			}
+		} else {
+#ifdef __powerpc__
+			/*
+			 * SDL_memset() on PPC (both glibc and codewarrior) uses
+			 * the dcbz (Data Cache Block Zero) instruction, which
+			 * causes an alignment exception if the destination is
+			 * uncachable, so only use it on software surfaces
+			 */
+			if((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) {
+				if(len >= 8 * bpp) {
+					/*
+					 * 64-bit stores are probably most
+					 * efficient to uncached video memory
+					 */
+					double fill;
+					SDL_memset(&fill, color, (sizeof fill));
+					for(y = h; y; y--) {
+						Uint8 *d = row;
+						unsigned n = len;
+						unsigned nn;
+						Uint8 c = color;
+						double f = fill;
+						while((unsigned long)d
+						      & (sizeof(double) - 1)) {
+							*d++ = c;
+							n--;
+						}
+						nn = n / (sizeof(double) * 4);
+						while(nn) {
+							((double *)d)[0] = f;
+							((double *)d)[1] = f;
+							((double *)d)[2] = f;
+							((double *)d)[3] = f;
+							d += 4*sizeof(double);
+							nn--;
+						}
+						n &= ~(sizeof(double) * 4 - 1);
+						nn = n / sizeof(double);
+						while(nn) {
+							*(double *)d = f;
+							d += sizeof(double);
+							nn--;
+						}
+						n &= ~(sizeof(double) - 1);
+						while(n) {
+							*d++ = c;
+							n--;
+						}
+						row += dst->pitch;
+					}
+				} else {
+					/* narrow boxes */
+					for(y = h; y; y--) {
+						Uint8 *d = row;
+						Uint8 c = color;
+						int n = len;
+						while(n) {
+							*d++ = c;
+							n--;
+						}
+						row += dst->pitch;
+					}
+				}
+			} else
+#endif /* __powerpc__ */
+			{
+				for(y = h; y; y--) {
+					SDL_memset(row, color, len);
+					row += dst->pitch;
+				}
+			}
+		}
+		return;
+	}
+
+	switch (bpp) {
+	    case 2:
+		for ( y=h; y; --y ) {
+			Uint16 *pixels = (Uint16 *)row;
+			Uint16 c = (Uint16)color;
+			Uint32 cc = (Uint32)c << 16 | c;
+			int n = len >> 1;
+			if((uintptr_t)pixels & 3) {
+				*pixels++ = c;
+				n--;
+			}
+			if(n >> 1)
+				SDL_memset4(pixels, cc, n >> 1);
+			if(n & 1)
+				pixels[n - 1] = c;
+			row += dst->pitch;
+		}
+		break;
+
+	    case 3:
+		for ( y=h; y; --y ) {
+			for ( x=0; x<len; x+=PATTERN_PERIOD ) {
+				SDL_memcpy(row + x, pattern,
+					   SDL_min(PATTERN_PERIOD, len - x));
+			}
+			row += dst->pitch;
+		}
+		break;
+
+	    case 4:
+		for(y = h; y; --y) {
+			SDL_memset4(row, color, len >> 2);
+			row += dst->pitch;
+		}
+		break;
+	}
+}
+
+void SDL_SoftFillRect(SDL_Surface *dst, const SDL_Rect *rect, Uint32 color)
+{
+	int bpp = dst->format->BytesPerPixel;
+	Uint8 pattern[PATTERN_BYTES];
+	Uint8 *row;
+	int len;
+
+	if ( dst->format->BitsPerPixel < 8 ) {
+		FillBits(dst, rect, color);
+		return;
+	}
+
+	BuildPattern(pattern, bpp, color);
+	row = (Uint8 *)dst->pixels + rect->y * dst->pitch + rect->x * bpp;
+	len = rect->w * bpp;
+#if SSE2_FILL
+	if ( SDL_HasSSE2() ) {
+		FillSSE2(row, dst->pitch, len, rect->h, pattern, bpp,
+			 (Uint32)len * rect->h > STREAM_FILL_BYTES);
+		return;
+	}
+#endif
+	FillC(dst, row, len, rect->h, pattern, color);
+}
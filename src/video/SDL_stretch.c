@@ -29,6 +29,13 @@
 
 #include "SDL_video.h"
 #include "SDL_blit.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_bands_c.h"
+
+#if SDL_ASSEMBLY_ROUTINES && defined(__GNUC__) && defined(__SSE2__)
+#define SSE2_STRETCH 1
+#include <emmintrin.h>
+#endif
 
 /* This isn't ready for general consumption yet - it should be folded
    into the general blitting mechanism.
@@ -194,6 +201,28 @@ void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
 	}
 }
 
+/* Returns the rectangle to use, the whole surface if 'rect' is NULL, or
+   NULL if it doesn't fit in the surface
+*/
+static SDL_Rect *CheckStretchRect(SDL_Surface *surface, SDL_Rect *rect,
+                                  SDL_Rect *full, const char *which)
+{
+	if ( rect ) {
+		if ( (rect->x < 0) || (rect->y < 0) ||
+		     ((rect->x+rect->w) > surface->w) ||
+		     ((rect->y+rect->h) > surface->h) ) {
+			SDL_SetError("Invalid %s blit rectangle", which);
+			return(NULL);
+		}
+		return(rect);
+	}
+	full->x = 0;
+	full->y = 0;
+	full->w = surface->w;
+	full->h = surface->h;
+	return(full);
+}
+
 /* Perform a stretch blit between two surfaces of the same format.
    NOTE:  This function is not safe to call from multiple threads!
 */
@@ -224,33 +253,10 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	}
 
 	/* Verify the blit rectangles */
-	if ( srcrect ) {
-		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
-		     ((srcrect->x+srcrect->w) > src->w) ||
-		     ((srcrect->y+srcrect->h) > src->h) ) {
-			SDL_SetError("Invalid source blit rectangle");
-			return(-1);
-		}
-	} else {
-		full_src.x = 0;
-		full_src.y = 0;
-		full_src.w = src->w;
-		full_src.h = src->h;
-		srcrect = &full_src;
-	}
-	if ( dstrect ) {
-		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
-		     ((dstrect->x+dstrect->w) > dst->w) ||
-		     ((dstrect->y+dstrect->h) > dst->h) ) {
-			SDL_SetError("Invalid destination blit rectangle");
-			return(-1);
-		}
-	} else {
-		full_dst.x = 0;
-		full_dst.y = 0;
-		full_dst.w = dst->w;
-		full_dst.h = dst->h;
-		dstrect = &full_dst;
+	srcrect = CheckStretchRect(src, srcrect, &full_src, "source");
+	dstrect = CheckStretchRect(dst, dstrect, &full_dst, "destination");
+	if ( !srcrect || !dstrect ) {
+		return(-1);
 	}
 
 	/* Lock the destination if it's in hardware */
@@ -356,3 +362,517 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	return(0);
 }
 
+
+/* Filtered stretching.
+
+   Each destination pixel is a weighted sum of source pixels, with the
+   weights for each axis worked out once per call, in 256ths.  Source rows
+   are filtered horizontally into 16-bit channels, kept as long as the
+   following destination rows need them, and then combined vertically into
+   32-bit pixels.  All four bytes of a pixel are filtered the same way, so
+   this works for any 32-bit format with 8-bit channels.  Other formats are
+   converted to one of those a row at a time by the normal blitters, which
+   keeps the whole job in one pass over the frame.
+*/
+
+typedef struct {
+	int *start;		/* first source pixel of each destination pixel */
+	int *count;		/* how many source pixels it uses */
+	Uint16 *weight;		/* 'taps' weights for each, adding up to 256 */
+	int taps;		/* the most source pixels any one uses */
+} StretchAxis;
+
+typedef struct {
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	SDL_Rect srcrect;
+	SDL_Rect dstrect;
+	Uint32 Rmask, Gmask, Bmask, Amask;	/* the 32-bit working format */
+	int decode;		/* source rows are converted to it first */
+	int encode;		/* destination rows are converted from it */
+	StretchAxis x;
+	StretchAxis y;
+} StretchInfo;
+
+static int BuildStretchAxis(StretchAxis *axis, int src_len, int dst_len,
+                            SDL_StretchFilter filter)
+{
+	int i, k;
+
+	switch (filter) {
+	    case SDL_STRETCH_BILINEAR:
+		axis->taps = 2;
+		break;
+	    case SDL_STRETCH_BOX:
+		axis->taps = (src_len + dst_len - 1) / dst_len + 1;
+		break;
+	    default:
+		axis->taps = 1;
+		break;
+	}
+	axis->start = (int *)SDL_malloc(2 * dst_len * sizeof(int));
+	axis->weight = (Uint16 *)SDL_malloc(dst_len * axis->taps * sizeof(Uint16));
+	if ( !axis->start || !axis->weight ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	axis->count = axis->start + dst_len;
+
+	for ( i=0; i<dst_len; ++i ) {
+		Uint16 *weight = axis->weight + i * axis->taps;
+		int start, count;
+
+		if ( filter == SDL_STRETCH_BILINEAR ) {
+			/* Where the center of the pixel falls in the source */
+			Sint64 pos = ((Sint64)(2*i+1) * src_len << 16) /
+			             (2 * dst_len) - 0x8000;
+			int frac;
+
+			if ( pos < 0 ) {
+				pos = 0;
+			}
+			start = (int)(pos >> 16);
+			frac = (int)(pos & 0xFFFF) >> 8;
+			if ( start >= src_len - 1 ) {
+				start = src_len - 1;
+				frac = 0;
+			}
+			weight[0] = 256 - frac;
+			weight[1] = frac;
+			count = frac ? 2 : 1;
+		} else if ( filter == SDL_STRETCH_BOX ) {
+			/* The part of the source the pixel covers */
+			Sint64 a = ((Sint64)i * src_len << 16) / dst_len;
+			Sint64 b = ((Sint64)(i+1) * src_len << 16) / dst_len;
+			int edge, last_edge = 0;
+
+			start = (int)(a >> 16);
+			count = (int)((b - 1) >> 16) - start + 1;
+			for ( k=0; k<count; ++k ) {
+				/* Rounding the running total keeps the sum at 256 */
+				Sint64 hi = SDL_min(b, (Sint64)(start+k+1) << 16);
+				edge = (int)(((hi-a) * 256 + (b-a) / 2) / (b-a));
+				weight[k] = (Uint16)(edge - last_edge);
+				last_edge = edge;
+			}
+
+			/* Drop slivers that round to nothing at the edges */
+			while ( count > 1 && weight[count-1] == 0 ) {
+				--count;
+			}
+			while ( count > 1 && weight[0] == 0 ) {
+				SDL_memmove(weight, weight + 1, --count * sizeof(Uint16));
+				++start;
+			}
+			for ( k=0; k<count; ++k ) {
+				if ( weight[k] == 256 ) {
+					/* Everything else rounded to nothing */
+					start += k;
+					count = 1;
+					weight[0] = 256;
+				}
+			}
+		} else {
+			start = (int)((Sint64)(2*i+1) * src_len / (2 * dst_len));
+			weight[0] = 256;
+			count = 1;
+		}
+		axis->start[i] = start;
+		axis->count[i] = count;
+	}
+	return(0);
+}
+
+static void FreeStretchAxis(StretchAxis *axis)
+{
+	if ( axis->start ) {
+		SDL_free(axis->start);
+	}
+	if ( axis->weight ) {
+		SDL_free(axis->weight);
+	}
+}
+
+/* Channel i of each pixel is bits 8*i to 8*i+7, multiplied by 256 */
+static void FilterRowC(const Uint32 *src, Uint16 *dst,
+                       const StretchAxis *axis, int width)
+{
+	int i, k;
+
+	for ( i=0; i<width; ++i ) {
+		const Uint32 *p = src + axis->start[i];
+		const Uint16 *weight = axis->weight + i * axis->taps;
+		Uint32 c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+
+		for ( k=0; k<axis->count[i]; ++k ) {
+			Uint32 pixel = p[k];
+			c0 += (pixel & 0xFF) * weight[k];
+			c1 += ((pixel >> 8) & 0xFF) * weight[k];
+			c2 += ((pixel >> 16) & 0xFF) * weight[k];
+			c3 += (pixel >> 24) * weight[k];
+		}
+		dst[0] = (Uint16)c0;
+		dst[1] = (Uint16)c1;
+		dst[2] = (Uint16)c2;
+		dst[3] = (Uint16)c3;
+		dst += 4;
+	}
+}
+
+/* Rows of filtered channels to 32-bit pixels.  The weights are below 256
+   when there is more than one row, and (h * w) >> 8 can't overflow.
+*/
+static void CombineRowsC(Uint16 * const *rows, const Uint16 *weight,
+                         int count, Uint32 *dst, int first, int width)
+{
+	int i, c, k;
+
+	for ( i=first; i<width; ++i ) {
+		Uint32 pixel = 0;
+		for ( c=0; c<4; ++c ) {
+			Uint32 v = 0;
+			if ( count == 1 ) {
+				v = rows[0][i*4+c];
+			} else {
+				for ( k=0; k<count; ++k ) {
+					v += ((Uint32)rows[k][i*4+c] * weight[k]) >> 8;
+				}
+			}
+			v = (v + 128) >> 8;
+			pixel |= SDL_min(v, 255) << (8*c);
+		}
+		dst[i] = pixel;
+	}
+}
+
+#if SSE2_STRETCH
+static void FilterRowSSE2(const Uint32 *src, Uint16 *dst,
+                          const StretchAxis *axis, int width)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int i, k;
+
+	for ( i=0; i<width; ++i ) {
+		const Uint32 *p = src + axis->start[i];
+		const Uint16 *weight = axis->weight + i * axis->taps;
+		__m128i acc = zero;
+
+		/* Two pixels at a time, one weight for each half */
+		for ( k=0; k+2<=axis->count[i]; k+=2 ) {
+			__m128i w = _mm_unpacklo_epi64(_mm_set1_epi16(weight[k]),
+			                               _mm_set1_epi16(weight[k+1]));
+			__m128i pixels = _mm_loadl_epi64((const __m128i *)(p + k));
+			pixels = _mm_unpacklo_epi8(pixels, zero);
+			acc = _mm_add_epi16(acc, _mm_mullo_epi16(pixels, w));
+		}
+		if ( k < axis->count[i] ) {
+			__m128i pixel = _mm_cvtsi32_si128(p[k]);
+			pixel = _mm_unpacklo_epi8(pixel, zero);
+			acc = _mm_add_epi16(acc, _mm_mullo_epi16(pixel,
+			                    _mm_set1_epi16(weight[k])));
+		}
+		acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+		_mm_storel_epi64((__m128i *)dst, acc);
+		dst += 4;
+	}
+}
+
+static __inline__ __m128i CombineSSE2(Uint16 * const *rows, const Uint16 *weight,
+                                      int count, int offset)
+{
+	__m128i acc;
+	int k;
+
+	if ( count == 1 ) {
+		acc = _mm_loadu_si128((const __m128i *)(rows[0] + offset));
+	} else {
+		acc = _mm_setzero_si128();
+		for ( k=0; k<count; ++k ) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(rows[k] + offset));
+			acc = _mm_add_epi16(acc, _mm_mulhi_epu16(v,
+			                    _mm_set1_epi16((short)(weight[k] << 8))));
+		}
+	}
+	return _mm_srli_epi16(_mm_add_epi16(acc, _mm_set1_epi16(128)), 8);
+}
+
+static void CombineRowsSSE2(Uint16 * const *rows, const Uint16 *weight,
+                            int count, Uint32 *dst, int first, int width)
+{
+	int i;
+
+	for ( i=first; i+4<=width; i+=4 ) {
+		__m128i lo = CombineSSE2(rows, weight, count, i*4);
+		__m128i hi = CombineSSE2(rows, weight, count, i*4 + 8);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+	/* The last few pixels */
+	CombineRowsC(rows, weight, count, dst, i, width);
+}
+#endif /* SSE2_STRETCH */
+
+/* A 32-bit format with 8-bit channels, any order */
+static int IsByteFormat(const SDL_PixelFormat *fmt)
+{
+	return (fmt->BytesPerPixel == 4 && !fmt->palette &&
+	        fmt->Rloss == 0 && fmt->Gloss == 0 && fmt->Bloss == 0 &&
+	        (fmt->Rshift % 8) == 0 && (fmt->Gshift % 8) == 0 &&
+	        (fmt->Bshift % 8) == 0 &&
+	        (!fmt->Amask || (fmt->Aloss == 0 && (fmt->Ashift % 8) == 0)));
+}
+
+/* A one row surface for converting rows with SDL_LowerBlit(), pointed at
+   the row each time
+*/
+static SDL_Surface *CreateRowSurface(int width, int depth, Uint32 Rmask,
+		Uint32 Gmask, Uint32 Bmask, Uint32 Amask, SDL_Palette *palette)
+{
+	SDL_Surface *row;
+
+	row = SDL_CreateRGBSurfaceFrom(NULL, width, 1, depth,
+	                               width * ((depth + 7) / 8),
+	                               Rmask, Gmask, Bmask, Amask);
+	if ( row == NULL ) {
+		return(NULL);
+	}
+	/* A plain copy, no blending */
+	SDL_SetAlpha(row, 0, SDL_ALPHA_OPAQUE);
+	if ( palette ) {
+		SDL_SetColors(row, palette->colors, 0, palette->ncolors);
+	}
+	return(row);
+}
+
+static SDL_Surface *CreateFormatRow(int width, const SDL_PixelFormat *fmt)
+{
+	return CreateRowSurface(width, fmt->BitsPerPixel, fmt->Rmask,
+	                        fmt->Gmask, fmt->Bmask, fmt->Amask, fmt->palette);
+}
+
+/* Stretch destination rows 'first' to 'last' - 1 of the destination
+   rectangle.  Everything written is local, so separate calls can run at
+   the same time on different rows.
+*/
+static int StretchRows(const StretchInfo *info, int first, int last)
+{
+	const int sw = info->srcrect.w;
+	const int dw = info->dstrect.w;
+	const int taps = info->y.taps;
+	const int direct = (info->x.taps == 1 && info->y.taps == 1);
+	SDL_Surface *srcrow = NULL, *decoded = NULL;
+	SDL_Surface *outrow = NULL, *dstrow = NULL;
+	SDL_Rect srect, drect;
+	Uint8 *buffer;
+	Uint16 *filtered;
+	Uint16 **rows;
+	int *tags;
+	Uint32 *out;
+	int j, k, retval = -1;
+	void (*filter_row)(const Uint32 *, Uint16 *, const StretchAxis *, int);
+	void (*combine_rows)(Uint16 * const *, const Uint16 *, int, Uint32 *,
+	                     int, int);
+
+	filter_row = FilterRowC;
+	combine_rows = CombineRowsC;
+#if SSE2_STRETCH
+	if ( SDL_HasSSE2() ) {
+		filter_row = FilterRowSSE2;
+		combine_rows = CombineRowsSSE2;
+	}
+#endif
+
+	/* Decoded source row, output row, filtered rows and their tags */
+	buffer = (Uint8 *)SDL_malloc(sw * 4 + dw * 4 +
+	                             taps * (dw * 8 + sizeof(Uint16 *) + sizeof(int)));
+	if ( buffer == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	filtered = (Uint16 *)buffer;
+	rows = (Uint16 **)(buffer + taps * dw * 8);
+	tags = (int *)(rows + taps);
+	out = (Uint32 *)(tags + taps);
+	for ( k=0; k<taps; ++k ) {
+		tags[k] = -1;
+	}
+
+	if ( info->decode ) {
+		srcrow = CreateFormatRow(sw, info->src->format);
+		decoded = CreateRowSurface(sw, 32, info->Rmask, info->Gmask,
+		                           info->Bmask, info->Amask, NULL);
+		if ( !srcrow || !decoded ) {
+			goto done;
+		}
+		decoded->pixels = out + dw;
+	}
+	if ( info->encode ) {
+		outrow = CreateRowSurface(dw, 32, info->Rmask, info->Gmask,
+		                          info->Bmask, info->Amask, NULL);
+		dstrow = CreateFormatRow(dw, info->dst->format);
+		if ( !outrow || !dstrow ) {
+			goto done;
+		}
+		outrow->pixels = out;
+	}
+	srect.x = drect.x = 0;
+	srect.y = drect.y = 0;
+
+	for ( j=first; j<last; ++j ) {
+		Uint8 *dstp = (Uint8 *)info->dst->pixels +
+		              (info->dstrect.y + j) * info->dst->pitch +
+		              info->dstrect.x * info->dst->format->BytesPerPixel;
+		Uint32 *dst32 = info->encode ? out : (Uint32 *)dstp;
+		int count = info->y.count[j];
+
+		for ( k=0; k<count; ++k ) {
+			int r = info->y.start[j] + k;
+			int slot = r % taps;
+			const Uint32 *src32;
+
+			rows[k] = filtered + slot * dw * 4;
+			if ( tags[slot] == r && !direct ) {
+				continue;
+			}
+
+			/* Bring in the source row */
+			src32 = (const Uint32 *)((Uint8 *)info->src->pixels +
+			        (info->srcrect.y + r) * info->src->pitch +
+			        info->srcrect.x * info->src->format->BytesPerPixel);
+			if ( info->decode ) {
+				srcrow->pixels = (void *)src32;
+				srect.w = drect.w = sw;
+				srect.h = drect.h = 1;
+				if ( SDL_LowerBlit(srcrow, &srect, decoded, &drect) < 0 ) {
+					goto done;
+				}
+				src32 = (const Uint32 *)decoded->pixels;
+			}
+			if ( direct ) {
+				int i;
+				for ( i=0; i<dw; ++i ) {
+					dst32[i] = src32[info->x.start[i]];
+				}
+			} else {
+				filter_row(src32, rows[k], &info->x, dw);
+				tags[slot] = r;
+			}
+		}
+		if ( !direct ) {
+			combine_rows(rows, info->y.weight + j * taps, count,
+			             dst32, 0, dw);
+		}
+
+		if ( info->encode ) {
+			dstrow->pixels = dstp;
+			srect.w = drect.w = dw;
+			srect.h = drect.h = 1;
+			if ( SDL_LowerBlit(outrow, &srect, dstrow, &drect) < 0 ) {
+				goto done;
+			}
+		}
+	}
+	retval = 0;
+
+done:
+	if ( srcrow ) {
+		SDL_FreeSurface(srcrow);
+	}
+	if ( decoded ) {
+		SDL_FreeSurface(decoded);
+	}
+	if ( outrow ) {
+		SDL_FreeSurface(outrow);
+	}
+	if ( dstrow ) {
+		SDL_FreeSurface(dstrow);
+	}
+	SDL_free(buffer);
+	return(retval);
+}
+
+static int RunStretchBand(void *data, int first, int last)
+{
+	return StretchRows((const StretchInfo *)data, first, last);
+}
+
+int SDL_SoftStretchFilter(SDL_Surface *src, SDL_Rect *srcrect,
+                          SDL_Surface *dst, SDL_Rect *dstrect,
+                          SDL_StretchFilter filter)
+{
+	StretchInfo info;
+	SDL_Rect full_src;
+	SDL_Rect full_dst;
+	int retval = -1;
+
+	if ( src->format->BitsPerPixel < 8 || dst->format->BitsPerPixel < 8 ) {
+		SDL_SetError("Stretch needs at least 8 bits per pixel");
+		return(-1);
+	}
+	srcrect = CheckStretchRect(src, srcrect, &full_src, "source");
+	dstrect = CheckStretchRect(dst, dstrect, &full_dst, "destination");
+	if ( !srcrect || !dstrect ) {
+		return(-1);
+	}
+	if ( !srcrect->w || !srcrect->h || !dstrect->w || !dstrect->h ) {
+		return(0);
+	}
+
+	SDL_memset(&info, 0, sizeof(info));
+	info.src = src;
+	info.dst = dst;
+	info.srcrect = *srcrect;
+	info.dstrect = *dstrect;
+
+	/* Work in the source or destination format if possible */
+	if ( IsByteFormat(src->format) ) {
+		info.Rmask = src->format->Rmask;
+		info.Gmask = src->format->Gmask;
+		info.Bmask = src->format->Bmask;
+		info.Amask = src->format->Amask;
+	} else if ( IsByteFormat(dst->format) ) {
+		info.Rmask = dst->format->Rmask;
+		info.Gmask = dst->format->Gmask;
+		info.Bmask = dst->format->Bmask;
+		info.Amask = dst->format->Amask;
+	} else {
+		info.Rmask = 0x00FF0000;
+		info.Gmask = 0x0000FF00;
+		info.Bmask = 0x000000FF;
+		info.Amask = 0xFF000000;
+	}
+	info.decode = !IsByteFormat(src->format);
+	info.encode = !IsByteFormat(dst->format) ||
+	              dst->format->Rmask != info.Rmask ||
+	              dst->format->Gmask != info.Gmask ||
+	              dst->format->Bmask != info.Bmask ||
+	              dst->format->Amask != info.Amask;
+
+	if ( BuildStretchAxis(&info.x, srcrect->w, dstrect->w, filter) < 0 ||
+	     BuildStretchAxis(&info.y, srcrect->h, dstrect->h, filter) < 0 ) {
+		goto done;
+	}
+
+	if ( SDL_LockSurface(dst) < 0 ) {
+		goto done;
+	}
+	if ( SDL_LockSurface(src) < 0 ) {
+		SDL_UnlockSurface(dst);
+		goto done;
+	}
+	/* In bands if it's big enough, as for blits */
+	if ( src != dst &&
+	     !((src->flags | dst->flags) & SDL_HWSURFACE) ) {
+		int bytes = srcrect->w * srcrect->h * src->format->BytesPerPixel +
+		            dstrect->w * dstrect->h * dst->format->BytesPerPixel;
+		retval = SDL_RunBands(RunStretchBand, &info, dstrect->h, bytes);
+	} else {
+		retval = StretchRows(&info, 0, dstrect->h);
+	}
+	SDL_UnlockSurface(src);
+	SDL_UnlockSurface(dst);
+
+done:
+	FreeStretchAxis(&info.x);
+	FreeStretchAxis(&info.y);
+	return(retval);
+}
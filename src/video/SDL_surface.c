@@ -26,6 +26,8 @@
 #include "SDL_cursor_c.h"
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
+#include "SDL_fillrect_c.h"
+#include "SDL_bands_c.h"
 #include "SDL_pixels_c.h"
 #include "SDL_leaks.h"
 
@@ -533,46 +535,11 @@ int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	return 0;
 }
 
-static int SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
-{
-	/* FIXME: We have to worry about packing order.. *sigh* */
-	SDL_SetError("1-bpp rect fill not yet implemented");
-	return -1;
-}
-
-static int SDL_FillRect4(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
-{
-	/* FIXME: We have to worry about packing order.. *sigh* */
-	SDL_SetError("4-bpp rect fill not yet implemented");
-	return -1;
-}
-
 /* 
  * This function performs a fast fill of the given rectangle with 'color'
  */
 int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
-	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this  = current_video;
-	int x, y;
-	Uint8 *row;
-
-	/* This function doesn't work on surfaces < 8 bpp */
-	if ( dst->format->BitsPerPixel < 8 ) {
-		switch(dst->format->BitsPerPixel) {
-		    case 1:
-			return SDL_FillRect1(dst, dstrect, color);
-			break;
-		    case 4:
-			return SDL_FillRect4(dst, dstrect, color);
-			break;
-		    default:
-			SDL_SetError("Fill rect on unsupported surface format");
-			return(-1);
-			break;
-		}
-	}
-
 	/* If 'dstrect' == NULL, then fill the whole surface */
 	if ( dstrect ) {
 		/* Perform clipping */
@@ -582,152 +549,79 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 	} else {
 		dstrect = &dst->clip_rect;
 	}
+	return SDL_FillRects(dst, dstrect, 1, color);
+}
 
-	/* Check for hardware acceleration */
-	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
-					video->info.blit_fill ) {
-		SDL_Rect hw_rect;
-		if ( dst == SDL_VideoSurface ) {
-			hw_rect = *dstrect;
-			hw_rect.x += current_video->offset_x;
-			hw_rect.y += current_video->offset_y;
-			dstrect = &hw_rect;
-		}
-		return(video->FillHWRect(this, dst, dstrect, color));
+/*
+ * Fill many rectangles at once, locking the surface only once
+ */
+/* A fill split into bands of rows by SDL_RunBands() */
+typedef struct {
+	SDL_Surface *dst;
+	SDL_Rect rect;
+	Uint32 color;
+} SDL_FillBands;
+
+static int RunFillBand(void *data, int first, int last)
+{
+	SDL_FillBands *bands = (SDL_FillBands *)data;
+	SDL_Rect rect = bands->rect;
+
+	rect.y += first;
+	rect.h = last - first;
+	SDL_SoftFillRect(bands->dst, &rect, bands->color);
+	return(0);
+}
+
+int SDL_FillRects(SDL_Surface *dst, const SDL_Rect *rects, int count,
+		  Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+	SDL_Rect rect;
+	int i, hw, retval = 0;
+
+	/* Packed pixels are only supported at 1 and 4 bpp */
+	if ( dst->format->BitsPerPixel < 8 &&
+	     dst->format->BitsPerPixel != 1 && dst->format->BitsPerPixel != 4 ) {
+		SDL_SetError("Fill rect on unsupported surface format");
+		return(-1);
 	}
 
-	/* Perform software fill */
-	if ( SDL_LockSurface(dst) != 0 ) {
+	/* Check for hardware acceleration */
+	hw = ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+		video->info.blit_fill && dst->format->BitsPerPixel >= 8;
+	if ( !hw && SDL_LockSurface(dst) != 0 ) {
 		return(-1);
 	}
-	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
-			dstrect->x*dst->format->BytesPerPixel;
-	if ( dst->format->palette || (color == 0) ) {
-		x = dstrect->w*dst->format->BytesPerPixel;
-		if ( !color && !((uintptr_t)row&3) && !(x&3) && !(dst->pitch&3) ) {
-			int n = x >> 2;
-			for ( y=dstrect->h; y; --y ) {
-				SDL_memset4(row, 0, n);
-				row += dst->pitch;
-			}
-		} else {
-#ifdef __powerpc__
-			/*
-			 * SDL_memset() on PPC (both glibc and codewarrior) uses
-			 * the dcbz (Data Cache Block Zero) instruction, which
-			 * causes an alignment exception if the destination is
-			 * uncachable, so only use it on software surfaces
-			 */
-			if((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) {
-				if(dstrect->w >= 8) {
-					/*
-					 * 64-bit stores are probably most
-					 * efficient to uncached video memory
-					 */
-					double fill;
-					SDL_memset(&fill, color, (sizeof fill));
-					for(y = dstrect->h; y; y--) {
-						Uint8 *d = row;
-						unsigned n = x;
-						unsigned nn;
-						Uint8 c = color;
-						double f = fill;
-						while((unsigned long)d
-						      & (sizeof(double) - 1)) {
-							*d++ = c;
-							n--;
-						}
-						nn = n / (sizeof(double) * 4);
-						while(nn) {
-							((double *)d)[0] = f;
-							((double *)d)[1] = f;
-							((double *)d)[2] = f;
-							((double *)d)[3] = f;
-							d += 4*sizeof(double);
-							nn--;
-						}
-						n &= ~(sizeof(double) * 4 - 1);
-						nn = n / sizeof(double);
-						while(nn) {
-							*(double *)d = f;
-							d += sizeof(double);
-							nn--;
-						}
-						n &= ~(sizeof(double) - 1);
-						while(n) {
-							*d++ = c;
-							n--;
-						}
-						row += dst->pitch;
-					}
-				} else {
-					/* narrow boxes */
-					for(y = dstrect->h; y; y--) {
-						Uint8 *d = row;
-						Uint8 c = color;
-						int n = x;
-						while(n) {
-							*d++ = c;
-							n--;
-						}
-						row += dst->pitch;
-					}
-				}
-			} else
-#endif /* __powerpc__ */
-			{
-				for(y = dstrect->h; y; y--) {
-					SDL_memset(row, color, x);
-					row += dst->pitch;
-				}
-			}
+	for ( i=0; i<count; ++i ) {
+		if ( !SDL_IntersectRect(&rects[i], &dst->clip_rect, &rect) ) {
+			continue;
 		}
-	} else {
-		switch (dst->format->BytesPerPixel) {
-		    case 2:
-			for ( y=dstrect->h; y; --y ) {
-				Uint16 *pixels = (Uint16 *)row;
-				Uint16 c = (Uint16)color;
-				Uint32 cc = (Uint32)c << 16 | c;
-				int n = dstrect->w;
-				if((uintptr_t)pixels & 3) {
-					*pixels++ = c;
-					n--;
-				}
-				if(n >> 1)
-					SDL_memset4(pixels, cc, n >> 1);
-				if(n & 1)
-					pixels[n - 1] = c;
-				row += dst->pitch;
+		if ( hw ) {
+			if ( dst == SDL_VideoSurface ) {
+				rect.x += current_video->offset_x;
+				rect.y += current_video->offset_y;
 			}
-			break;
-
-		    case 3:
-			#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-				color <<= 8;
-			#endif
-			for ( y=dstrect->h; y; --y ) {
-				Uint8 *pixels = row;
-				for ( x=dstrect->w; x; --x ) {
-					SDL_memcpy(pixels, &color, 3);
-					pixels += 3;
-				}
-				row += dst->pitch;
-			}
-			break;
-
-		    case 4:
-			for(y = dstrect->h; y; --y) {
-				SDL_memset4(row, color, dstrect->w);
-				row += dst->pitch;
+			if ( video->FillHWRect(this, dst, &rect, color) < 0 ) {
+				retval = -1;
 			}
-			break;
+		} else if ( !(dst->flags & SDL_HWSURFACE) ) {
+			/* In bands if it's big enough */
+			SDL_FillBands bands;
+			bands.dst = dst;
+			bands.rect = rect;
+			bands.color = color;
+			SDL_RunBands(RunFillBand, &bands, rect.h, rect.h *
+			             ((rect.w * dst->format->BitsPerPixel + 7) / 8));
+		} else {
+			SDL_SoftFillRect(dst, &rect, color);
 		}
 	}
-	SDL_UnlockSurface(dst);
-
-	/* We're done! */
-	return(0);
+	if ( !hw ) {
+		SDL_UnlockSurface(dst);
+	}
+	return(retval);
 }
 
 /*
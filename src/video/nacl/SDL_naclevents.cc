@@ -12,10 +12,11 @@ extern "C" {
 
 static EventQueue event_queue;
 
+// Number of events drained from the queue at once by NACL_PumpEvents.
+static const unsigned kEventBatchSize = 32;
+
 void SDL_NACL_PushEvent(const PP_InputEvent* ppevent) {
-  PP_InputEvent* copy = (PP_InputEvent*)malloc(sizeof(PP_InputEvent));
-  memcpy(copy, ppevent, sizeof(PP_InputEvent));
-  event_queue.PushEvent(copy);
+  event_queue.PushEvent(*ppevent);
 }
 
 static Uint8 translateButton(int32_t button) {
@@ -117,30 +118,44 @@ static SDLKey translateKey(uint32_t code) {
   }
 }
 
-void NACL_PumpEvents(_THIS) {
-  PP_InputEvent* event;
+static void handleEvent(const PP_InputEvent* event) {
   SDL_keysym keysym;
-  while (event = event_queue.PopEvent()) {
-    if (event->type == PP_INPUTEVENT_TYPE_MOUSEDOWN) {
-      SDL_PrivateMouseButton(SDL_PRESSED, translateButton(event->u.mouse.button), 0, 0);
-    } else if (event->type == PP_INPUTEVENT_TYPE_MOUSEUP) {
-      SDL_PrivateMouseButton(SDL_RELEASED, translateButton(event->u.mouse.button), 0, 0);
-    } else if (event->type == PP_INPUTEVENT_TYPE_MOUSEMOVE) {
-      SDL_PrivateMouseMotion(0, 0, event->u.mouse.x, event->u.mouse.y);
-    } else if (event->type == PP_INPUTEVENT_TYPE_KEYDOWN) {
-      keysym.scancode = 0;
-      keysym.sym = translateKey(event->u.key.key_code);
-      keysym.mod = KMOD_NONE;
-      keysym.unicode = 0;
-      SDL_PrivateKeyboard(SDL_PRESSED, &keysym);
-    } else if (event->type == PP_INPUTEVENT_TYPE_KEYUP) {
-      keysym.scancode = 0;
-      keysym.sym = translateKey(event->u.key.key_code);
-      keysym.mod = KMOD_NONE;
-      keysym.unicode = 0;
-      SDL_PrivateKeyboard(SDL_RELEASED, &keysym);
-    }
-    free(event);
+
+  if (event->type == PP_INPUTEVENT_TYPE_MOUSEDOWN) {
+    SDL_PrivateMouseButton(SDL_PRESSED, translateButton(event->u.mouse.button), 0, 0);
+  } else if (event->type == PP_INPUTEVENT_TYPE_MOUSEUP) {
+    SDL_PrivateMouseButton(SDL_RELEASED, translateButton(event->u.mouse.button), 0, 0);
+  } else if (event->type == PP_INPUTEVENT_TYPE_MOUSEMOVE) {
+    SDL_PrivateMouseMotion(0, 0, event->u.mouse.x, event->u.mouse.y);
+  } else if (event->type == PP_INPUTEVENT_TYPE_KEYDOWN) {
+    keysym.scancode = 0;
+    keysym.sym = translateKey(event->u.key.key_code);
+    keysym.mod = KMOD_NONE;
+    keysym.unicode = 0;
+    SDL_PrivateKeyboard(SDL_PRESSED, &keysym);
+  } else if (event->type == PP_INPUTEVENT_TYPE_KEYUP) {
+    keysym.scancode = 0;
+    keysym.sym = translateKey(event->u.key.key_code);
+    keysym.mod = KMOD_NONE;
+    keysym.unicode = 0;
+    SDL_PrivateKeyboard(SDL_RELEASED, &keysym);
+  }
+}
+
+void NACL_PumpEvents(_THIS) {
+  static unsigned reported_drops = 0;
+  PP_InputEvent events[kEventBatchSize];
+  unsigned count;
+  do {
+    count = event_queue.PopEvents(events, kEventBatchSize);
+    for (unsigned i = 0; i < count; ++i)
+      handleEvent(&events[i]);
+  } while (count == kEventBatchSize);
+
+  unsigned dropped = event_queue.DroppedEvents();
+  if (dropped != reported_drops) {
+    reported_drops = dropped;
+    SDL_SetError("Out of memory, %u input events lost", dropped);
   }
 }
 
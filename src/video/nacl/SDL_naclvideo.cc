@@ -6,9 +6,12 @@
 #include "SDL_naclevents_c.h"
 
 #include <ppapi/cpp/instance.h>
+#include <ppapi/cpp/module.h>
+#include <ppapi/cpp/core.h>
 #include <ppapi/cpp/graphics_2d.h>
 #include <ppapi/cpp/completion_callback.h>
 #include <ppapi/cpp/image_data.h>
+#include <ppapi/cpp/rect.h>
 
 pp::Instance* gNaclPPInstance;
 static int gNaclVideoWidth;
@@ -18,6 +21,7 @@ extern "C" {
 
 #include "SDL_video.h"
 #include "SDL_mouse.h"
+#include "SDL_timer.h"
 #include "SDL_nacl.h"
 #include "../SDL_sysvideo.h"
 #include "../SDL_pixels_c.h"
@@ -40,6 +44,13 @@ static SDL_Surface *NACL_SetVideoMode(_THIS, SDL_Surface *current, int width, in
 static void NACL_VideoQuit(_THIS);
 static void NACL_UpdateRects(_THIS, int numrects, SDL_Rect *rects);
 
+/* Hardware surface functions */
+static int NACL_AllocHWSurface(_THIS, SDL_Surface *surface);
+static int NACL_LockHWSurface(_THIS, SDL_Surface *surface);
+static void NACL_UnlockHWSurface(_THIS, SDL_Surface *surface);
+static void NACL_FreeHWSurface(_THIS, SDL_Surface *surface);
+static int NACL_FlipHWSurface(_THIS, SDL_Surface *surface);
+
 
 static int NACL_Available(void) {
   return gNaclPPInstance != 0;
@@ -72,6 +83,7 @@ static SDL_VideoDevice *NACL_CreateDevice(int devindex) {
   SDL_memset(device->hidden, 0, (sizeof *device->hidden));
 
   device->hidden->image_data_mutex = SDL_CreateMutex();
+  device->hidden->frame_presented_cond = SDL_CreateCond();
 
   device->hidden->ow = gNaclVideoWidth;
   device->hidden->oh = gNaclVideoHeight;
@@ -86,26 +98,42 @@ static SDL_VideoDevice *NACL_CreateDevice(int devindex) {
     fprintf(stderr, "***** Couldn't bind the device context *****\n");
   }
 
+  /* Two pages by default, SDL_NACL_BUFFERS=3 enables triple buffering */
+  const char *num_buffers = SDL_getenv("SDL_NACL_BUFFERS");
+  device->hidden->num_buffers = num_buffers ? SDL_atoi(num_buffers) : 2;
+  if (device->hidden->num_buffers < 1)
+    device->hidden->num_buffers = 1;
+  if (device->hidden->num_buffers > NACL_MAX_BUFFERS)
+    device->hidden->num_buffers = NACL_MAX_BUFFERS;
+
   // TODO: convert normal RGBA to premultiplied alpha.
-  device->hidden->image_data = new pp::ImageData(gNaclPPInstance,
-      PP_IMAGEDATAFORMAT_BGRA_PREMUL,
-      device->hidden->context2d->size(),
-      false);
-  assert(device->hidden->image_data != NULL);
+  for (int i = 0; i < device->hidden->num_buffers; ++i) {
+    device->hidden->buffers[i] = new pp::ImageData(gNaclPPInstance,
+        PP_IMAGEDATAFORMAT_BGRA_PREMUL,
+        device->hidden->context2d->size(),
+        false);
+    assert(device->hidden->buffers[i] != NULL);
+  }
+  device->hidden->image_data = device->hidden->buffers[0];
+  device->hidden->ready_buffer = -1;
+  device->hidden->presenting_buffer = -1;
 
   /* Set the function pointers */
   device->VideoInit = NACL_VideoInit;
   device->ListModes = NACL_ListModes;
   device->SetVideoMode = NACL_SetVideoMode;
   device->UpdateRects = NACL_UpdateRects;
+  device->AllocHWSurface = NACL_AllocHWSurface;
+  device->LockHWSurface = NACL_LockHWSurface;
+  device->UnlockHWSurface = NACL_UnlockHWSurface;
+  device->FreeHWSurface = NACL_FreeHWSurface;
+  device->FlipHWSurface = NACL_FlipHWSurface;
   device->VideoQuit = NACL_VideoQuit;
   device->InitOSKeymap = NACL_InitOSKeymap;
   device->PumpEvents = NACL_PumpEvents;
 
   device->free = NACL_DeleteDevice;
 
-  flush(device, 0);
-
   return device;
 }
 
@@ -136,19 +164,26 @@ SDL_Surface *NACL_SetVideoMode(_THIS, SDL_Surface *current,
     int width, int height, int bpp, Uint32 flags) {
   if ( _this->hidden->buffer ) {
     SDL_free( _this->hidden->buffer );
+    _this->hidden->buffer = NULL;
   }
 
   bpp = 32; // Let SDL handle pixel format conversion.
   width = _this->hidden->ow;
   height = _this->hidden->oh;
 
-  _this->hidden->buffer = SDL_malloc(width * height * (bpp / 8));
-  if ( ! _this->hidden->buffer ) {
-    SDL_SetError("Couldn't allocate buffer for requested mode");
-    return(NULL);
-  }
+  /* Page flip straight into the ImageData objects if we have enough */
+  const bool page_flipping = (flags & SDL_DOUBLEBUF) == SDL_DOUBLEBUF &&
+      _this->hidden->num_buffers > 1;
 
-  SDL_memset(_this->hidden->buffer, 0, width * height * (bpp / 8));
+  if ( ! page_flipping ) {
+    _this->hidden->buffer = SDL_malloc(width * height * (bpp / 8));
+    if ( ! _this->hidden->buffer ) {
+      SDL_SetError("Couldn't allocate buffer for requested mode");
+      return(NULL);
+    }
+
+    SDL_memset(_this->hidden->buffer, 0, width * height * (bpp / 8));
+  }
 
   /* Allocate the new pixel format for the screen */
   if ( ! SDL_ReallocFormat(current, bpp, 0xFF0000, 0xFF00, 0xFF, 0xFF000000) ) {
@@ -159,57 +194,292 @@ SDL_Surface *NACL_SetVideoMode(_THIS, SDL_Surface *current,
   }
 
   /* Set up the new mode framebuffer */
-  current->flags = flags & SDL_FULLSCREEN;
+  SDL_LockMutex(_this->hidden->image_data_mutex);
+  _this->hidden->num_dirty_rects = 0;
+  _this->hidden->page_flipping = page_flipping;
+  _this->hidden->ready_buffer = -1;
   _this->hidden->bpp = bpp;
   _this->hidden->w = current->w = width;
   _this->hidden->h = current->h = height;
-  _this->hidden->pitch = current->pitch = current->w * (bpp / 8);
-  current->pixels = _this->hidden->buffer;
+  if ( page_flipping ) {
+    current->flags = flags & (SDL_FULLSCREEN | SDL_HWSURFACE | SDL_DOUBLEBUF);
+    _this->hidden->back_buffer =
+        _this->hidden->presenting_buffer == 0 ? 1 : 0;
+    pp::ImageData* page = _this->hidden->buffers[_this->hidden->back_buffer];
+    _this->hidden->pitch = current->pitch = page->stride();
+    current->pixels = page->data();
+  } else {
+    current->flags = flags & SDL_FULLSCREEN;
+    _this->hidden->pitch = current->pitch = current->w * (bpp / 8);
+    current->pixels = _this->hidden->buffer;
+  }
+  SDL_UnlockMutex(_this->hidden->image_data_mutex);
 
   /* We're done */
   return(current);
 }
 
+/* We don't allow hardware surfaces other than the screen pages */
+static int NACL_AllocHWSurface(_THIS, SDL_Surface *surface) {
+  return(-1);
+}
+
+static void NACL_FreeHWSurface(_THIS, SDL_Surface *surface) {
+  return;
+}
+
+static int NACL_LockHWSurface(_THIS, SDL_Surface *surface) {
+  return(0);
+}
 
+static void NACL_UnlockHWSurface(_THIS, SDL_Surface *surface) {
+  return;
+}
+
+
+/* Runs on the main thread, either scheduled by NACL_UpdateRects or as the
+   completion callback of the previous Flush.  Paints and flushes only if a
+   new frame has been published in the meantime, so nothing runs while the
+   application does not draw.
+ */
 static void flush(void* data, int32_t unused) {
   SDL_VideoDevice* _this = reinterpret_cast<SDL_VideoDevice*>(data);
+  struct SDL_PrivateVideoData* hidden = _this->hidden;
+
+  SDL_LockMutex(hidden->image_data_mutex);
+  if (hidden->flush_in_flight) {
+    hidden->flush_in_flight = false;
+    hidden->presenting_buffer = -1;
+    hidden->presented_frame = hidden->painted_frame;
+    hidden->stats.presented++;
+    SDL_CondBroadcast(hidden->frame_presented_cond);
+  }
 
-  SDL_LockMutex(_this->hidden->image_data_mutex);
-  _this->hidden->context2d->PaintImageData(*_this->hidden->image_data, pp::Point());
-  // TODO: This is a busy loop. Replace with CallOnMainThread with a delay when it is supported.
-  _this->hidden->context2d->Flush(pp::CompletionCallback(&flush, _this));
-  SDL_UnlockMutex(_this->hidden->image_data_mutex);
+  if (hidden->num_dirty_rects > 0) {
+    for (int i = 0; i < hidden->num_dirty_rects; ++i) {
+      SDL_Rect* rect = &hidden->dirty_rects[i];
+      hidden->context2d->PaintImageData(*hidden->image_data,
+          pp::Point(), pp::Rect(rect->x, rect->y, rect->w, rect->h));
+    }
+    hidden->num_dirty_rects = 0;
+    hidden->painted_frame = hidden->stats.published;
+    hidden->flush_in_flight = true;
+    hidden->context2d->Flush(pp::CompletionCallback(&flush, _this));
+  } else if (hidden->ready_buffer >= 0) {
+    hidden->context2d->PaintImageData(
+        *hidden->buffers[hidden->ready_buffer], pp::Point());
+    hidden->presenting_buffer = hidden->ready_buffer;
+    hidden->ready_buffer = -1;
+    hidden->painted_frame = hidden->stats.published;
+    hidden->flush_in_flight = true;
+    hidden->context2d->Flush(pp::CompletionCallback(&flush, _this));
+  } else {
+    hidden->flush_scheduled = false;
+  }
+  SDL_UnlockMutex(hidden->image_data_mutex);
+}
+
+/* Grow 'dst' to the bounding box of 'dst' and 'src'. */
+static void unionRect(SDL_Rect* dst, const SDL_Rect* src) {
+  int x1 = SDL_min(dst->x, src->x);
+  int y1 = SDL_min(dst->y, src->y);
+  int x2 = SDL_max(dst->x + dst->w, src->x + src->w);
+  int y2 = SDL_max(dst->y + dst->h, src->y + src->h);
+  dst->x = x1;
+  dst->y = y1;
+  dst->w = x2 - x1;
+  dst->h = y2 - y1;
+}
+
+/* Must be called with image_data_mutex held. */
+static void addDirtyRect(_THIS, const SDL_Rect* rect) {
+  struct SDL_PrivateVideoData* hidden = _this->hidden;
+  int i;
+
+  for (i = 0; i < hidden->num_dirty_rects; ++i) {
+    SDL_Rect* r = &hidden->dirty_rects[i];
+    if (rect->x >= r->x && rect->y >= r->y &&
+        rect->x + rect->w <= r->x + r->w &&
+        rect->y + rect->h <= r->y + r->h)
+      return; // already covered
+  }
+  if (hidden->num_dirty_rects < NACL_MAX_DIRTY_RECTS) {
+    hidden->dirty_rects[hidden->num_dirty_rects++] = *rect;
+  } else {
+    unionRect(&hidden->dirty_rects[NACL_MAX_DIRTY_RECTS - 1], rect);
+  }
 }
 
-static void flip(_THIS) {
+/* Copy one clipped rectangle of the shadow buffer into image_data. */
+static void copyRect(_THIS, const SDL_Rect* rect) {
+  const int bytes_per_pixel = _this->hidden->bpp / 8;
+  const int row_bytes = rect->w * bytes_per_pixel;
+  const int dst_pitch = _this->hidden->image_data->stride();
+  Uint8* src = (Uint8*)_this->hidden->buffer +
+      rect->y * _this->hidden->pitch + rect->x * bytes_per_pixel;
+  Uint8* dst = (Uint8*)_this->hidden->image_data->data() +
+      rect->y * dst_pitch + rect->x * bytes_per_pixel;
+
+  if (row_bytes == _this->hidden->pitch && row_bytes == dst_pitch) {
+    SDL_memcpy(dst, src, row_bytes * rect->h);
+    return;
+  }
+  for (int y = 0; y < rect->h; ++y) {
+    SDL_memcpy(dst, src, row_bytes);
+    src += _this->hidden->pitch;
+    dst += dst_pitch;
+  }
+}
+
+/* Must be called with image_data_mutex held. */
+static void scheduleFlush(_THIS) {
+  if (!_this->hidden->flush_scheduled) {
+    _this->hidden->flush_scheduled = true;
+    pp::Module::Get()->core()->CallOnMainThread(0,
+        pp::CompletionCallback(&flush, _this));
+  }
+}
+
+static void NACL_UpdateRects(_THIS, int numrects, SDL_Rect *rects) {
+  if (_this->hidden->bpp == 0) // not initialized yet
+    return;
+  if (_this->hidden->page_flipping) // only SDL_Flip() presents
+    return;
   assert(_this->hidden->image_data);
   assert(_this->hidden->w == _this->hidden->ow);
   assert(_this->hidden->h == _this->hidden->oh);
 
   SDL_LockMutex(_this->hidden->image_data_mutex);
+  const bool frame_pending = _this->hidden->num_dirty_rects > 0;
+  for (int i = 0; i < numrects; ++i) {
+    /* Clip to the screen, SDL_UpdateRects passes the rects unchecked */
+    int x1 = SDL_max(rects[i].x, 0);
+    int y1 = SDL_max(rects[i].y, 0);
+    int x2 = SDL_min(rects[i].x + rects[i].w, _this->hidden->w);
+    int y2 = SDL_min(rects[i].y + rects[i].h, _this->hidden->h);
+    if (x1 >= x2 || y1 >= y2)
+      continue;
+
+    SDL_Rect rect;
+    rect.x = x1;
+    rect.y = y1;
+    rect.w = x2 - x1;
+    rect.h = y2 - y1;
+    copyRect(_this, &rect);
+    addDirtyRect(_this, &rect);
+  }
+
+  if (_this->hidden->num_dirty_rects > 0) {
+    /* Publish the frame; an unpainted predecessor is merged into it */
+    _this->hidden->stats.published++;
+    if (frame_pending)
+      _this->hidden->stats.dropped++;
+    scheduleFlush(_this);
+  }
+  SDL_UnlockMutex(_this->hidden->image_data_mutex);
+}
+
+/* Must be called with image_data_mutex held. */
+static int findFreeBuffer(_THIS) {
+  for (int i = 0; i < _this->hidden->num_buffers; ++i) {
+    if (i != _this->hidden->ready_buffer &&
+        i != _this->hidden->presenting_buffer)
+      return i;
+  }
+  return -1;
+}
+
+static int NACL_FlipHWSurface(_THIS, SDL_Surface *surface) {
+  struct SDL_PrivateVideoData* hidden = _this->hidden;
+  int back;
+
+  SDL_LockMutex(hidden->image_data_mutex);
+  /* Publish the back page, an unpainted ready page is recycled */
+  if (hidden->ready_buffer >= 0)
+    hidden->stats.dropped++;
+  hidden->ready_buffer = hidden->back_buffer;
+  hidden->stats.published++;
+  scheduleFlush(_this);
+
+  /* With two pages this waits for the previous frame to be presented */
+  while ((back = findFreeBuffer(_this)) < 0)
+    SDL_CondWait(hidden->frame_presented_cond, hidden->image_data_mutex);
+  hidden->back_buffer = back;
+  surface->pixels = hidden->buffers[back]->data();
+  SDL_UnlockMutex(hidden->image_data_mutex);
+
+  return(0);
+}
+
+static SDL_VideoDevice* getNaclDevice() {
+  if (!current_video || SDL_strcmp(current_video->name, NACLVID_DRIVER_NAME) != 0) {
+    SDL_SetError("The nacl video driver is not initialized");
+    return NULL;
+  }
+  return current_video;
+}
 
-  SDL_memcpy(_this->hidden->image_data->data(), _this->hidden->buffer,
-      _this->hidden->w * _this->hidden->h * _this->hidden->bpp / 8);
+int SDL_NACL_WaitFramePresented(Uint32 timeout) {
+  SDL_VideoDevice* _this = getNaclDevice();
+  Uint32 start = SDL_GetTicks();
+  int retval = 0;
 
+  if (!_this)
+    return -1;
+  SDL_LockMutex(_this->hidden->image_data_mutex);
+  while (_this->hidden->presented_frame != _this->hidden->stats.published) {
+    if (timeout == SDL_MUTEX_MAXWAIT) {
+      retval = SDL_CondWait(_this->hidden->frame_presented_cond,
+          _this->hidden->image_data_mutex);
+    } else {
+      /* Wake-ups don't restart the clock */
+      Uint32 elapsed = SDL_GetTicks() - start;
+      if (elapsed >= timeout) {
+        retval = SDL_MUTEX_TIMEDOUT;
+        break;
+      }
+      retval = SDL_CondWaitTimeout(_this->hidden->frame_presented_cond,
+          _this->hidden->image_data_mutex, timeout - elapsed);
+    }
+    if (retval != 0)
+      break;
+  }
   SDL_UnlockMutex(_this->hidden->image_data_mutex);
+  return retval;
 }
 
-static void NACL_UpdateRects(_THIS, int numrects, SDL_Rect *rects) {
-  if (_this->hidden->bpp == 0) // not initialized yet
+void SDL_NACL_GetFrameStats(SDL_NACL_FrameStats* stats) {
+  SDL_VideoDevice* _this = getNaclDevice();
+
+  if (!_this) {
+    SDL_memset(stats, 0, sizeof(*stats));
     return;
-  flip(_this);
+  }
+  SDL_LockMutex(_this->hidden->image_data_mutex);
+  *stats = _this->hidden->stats;
+  SDL_UnlockMutex(_this->hidden->image_data_mutex);
 }
 
 /* Note:  If we are terminated, this could be called in the middle of
    another SDL video routine -- notably UpdateRects.
 */
 void NACL_VideoQuit(_THIS) {
-  if (_this->screen->pixels != NULL)
-  {
+  if (_this->hidden->page_flipping) {
+    _this->screen->pixels = NULL;
+  } else if (_this->screen->pixels != NULL) {
     SDL_free(_this->screen->pixels);
     _this->screen->pixels = NULL;
+    _this->hidden->buffer = NULL;
   }
+  SDL_LockMutex(_this->hidden->image_data_mutex);
+  /* Release anybody waiting for a frame that will never be presented */
+  _this->hidden->num_dirty_rects = 0;
+  _this->hidden->ready_buffer = -1;
+  _this->hidden->presented_frame = _this->hidden->stats.published;
+  SDL_CondBroadcast(_this->hidden->frame_presented_cond);
+  SDL_UnlockMutex(_this->hidden->image_data_mutex);
   delete _this->hidden->context2d;
-  delete _this->hidden->image_data;
+  for (int i = 0; i < _this->hidden->num_buffers; ++i)
+    delete _this->hidden->buffers[i];
 }
 } // extern "C"
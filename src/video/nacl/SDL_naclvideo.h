@@ -6,6 +6,7 @@
 extern "C" {
 #include "../SDL_sysvideo.h"
 #include "SDL_mutex.h"
+#include "SDL_nacl.h"
 }
 
 #include <ppapi/cpp/instance.h>
@@ -16,6 +17,14 @@ extern "C" {
 #define _THIS	SDL_VideoDevice *_this
 
 
+/* Maximum number of separate dirty rectangles kept between two paints.
+   Further updates are merged into the bounding box of the last slot.
+ */
+#define NACL_MAX_DIRTY_RECTS 32
+
+/* Maximum number of ImageData pages used for SDL_DOUBLEBUF modes */
+#define NACL_MAX_BUFFERS 3
+
 /* Private display data */
 
 struct SDL_PrivateVideoData {
@@ -25,9 +34,37 @@ struct SDL_PrivateVideoData {
   void *buffer;
 
   SDL_mutex* image_data_mutex;
+  SDL_cond* frame_presented_cond;
   int ow, oh; // plugin output dimensions
-  pp::ImageData* image_data;
+  pp::ImageData* image_data;  // copy target of the shadow buffer, buffers[0]
   pp::Graphics2D* context2d;  // The PINPAPI 2D drawing context.
+
+  // Regions of image_data updated since the last paint, guarded by
+  // image_data_mutex.
+  int num_dirty_rects;
+  SDL_Rect dirty_rects[NACL_MAX_DIRTY_RECTS];
+
+  // Presentation state, also guarded by image_data_mutex.  A paint is
+  // scheduled on the main thread only when a new frame is published, and
+  // the Flush completion re-arms it only if another frame is waiting.
+  bool flush_scheduled;
+  bool flush_in_flight;
+  Uint32 painted_frame;    // frame number being flushed
+  Uint32 presented_frame;  // frame number last on screen
+  SDL_NACL_FrameStats stats;
+
+  // Page flipping state for SDL_DOUBLEBUF modes, guarded by
+  // image_data_mutex.  The screen surface points straight into
+  // buffers[back_buffer]; SDL_Flip hands it over as the ready buffer and
+  // picks a page that is neither ready nor being presented.  ImageData can
+  // only be created on the main thread, so the pages are allocated with the
+  // device.
+  int num_buffers;
+  pp::ImageData* buffers[NACL_MAX_BUFFERS];
+  bool page_flipping;
+  int back_buffer;        // page the application draws into
+  int ready_buffer;       // published page waiting to be painted, or -1
+  int presenting_buffer;  // page being flushed, or -1
 };
 
 #endif /* _SDL_naclvideo_h */
@@ -1,41 +1,151 @@
 #ifndef _SDL_nacl_eventqueue_h
 #define _SDL_nacl_eventqueue_h
 
-#include "SDL_mutex.h"
-
-#include <queue>
+#include <pthread.h>
+#include <stdlib.h>
 #include <ppapi/c/pp_input_event.h>
 
+// Fixed-capacity single-producer/single-consumer ring of input events.
+// Events are pushed by the Pepper main thread (SDL_NACL_PushEvent) and
+// popped by the thread running SDL_PumpEvents, without locks or allocation
+// as long as the ring has room.
+//
+// When the ring is full, events go to a locked overflow list instead, and
+// keep going there until the consumer has emptied both, so the order is
+// kept.  Consecutive mouse moves in the overflow list are merged into the
+// latest one.  The list starts with room for kCapacity events and grows
+// as needed; only if it can't grow is an event lost, and DroppedEvents()
+// counts those.
 class EventQueue {
 public:
-  EventQueue() {
-    mu_ = SDL_CreateMutex();
+  static const unsigned kCapacity = 256;  // must be a power of two
+  static const unsigned kCacheLineSize = 64;
+
+  EventQueue()
+      : head_(0), tail_(0), overflowing_(false),
+        overflow_(NULL), overflow_count_(0), overflow_size_(0),
+        dropped_(0) {
+    pthread_mutex_init(&overflow_mutex_, NULL);
+    overflow_ = static_cast<PP_InputEvent*>(
+        malloc(kCapacity * sizeof(*overflow_)));
+    if (overflow_)
+      overflow_size_ = kCapacity;
   }
 
   ~EventQueue() {
-    SDL_DestroyMutex(mu_);
+    pthread_mutex_destroy(&overflow_mutex_);
+    free(overflow_);
+  }
+
+  // Producer side.
+  void PushEvent(const PP_InputEvent& event) {
+    if (overflowing_) {
+      pthread_mutex_lock(&overflow_mutex_);
+      if (overflowing_) {
+        AddOverflow(event);
+        pthread_mutex_unlock(&overflow_mutex_);
+        return;
+      }
+      pthread_mutex_unlock(&overflow_mutex_);
+    }
+    if (!Put(event)) {
+      pthread_mutex_lock(&overflow_mutex_);
+      AddOverflow(event);
+      overflowing_ = true;
+      pthread_mutex_unlock(&overflow_mutex_);
+    }
   }
 
-  PP_InputEvent* PopEvent() {
-    SDL_LockMutex(mu_);
-    PP_InputEvent* event = NULL;
-    if (!queue_.empty()) {
-      event = queue_.front();
-      queue_.pop();
+  // Consumer side.  Copies up to max_events events and returns how many.
+  unsigned PopEvents(PP_InputEvent* events, unsigned max_events) {
+    // The producer leaves the ring alone while overflowing, so if it was
+    // overflowing before tail_ is read, the ring holds everything older
+    // than the overflow list.
+    bool overflowing = overflowing_;
+    __sync_synchronize();
+    unsigned head = head_;
+    unsigned count = tail_ - head;
+    if (count > max_events)
+      count = max_events;
+    __sync_synchronize();  // read the slots after seeing tail_
+    for (unsigned i = 0; i < count; ++i)
+      events[i] = events_[(head + i) & (kCapacity - 1)];
+    __sync_synchronize();  // done reading before releasing the slots
+    head_ = head + count;
+
+    if (count < max_events && overflowing) {
+      pthread_mutex_lock(&overflow_mutex_);
+      unsigned taken = overflow_count_;
+      if (taken > max_events - count)
+        taken = max_events - count;
+      for (unsigned i = 0; i < taken; ++i)
+        events[count + i] = overflow_[i];
+      overflow_count_ -= taken;
+      for (unsigned i = 0; i < overflow_count_; ++i)
+        overflow_[i] = overflow_[taken + i];
+      if (overflow_count_ == 0)
+        overflowing_ = false;
+      pthread_mutex_unlock(&overflow_mutex_);
+      count += taken;
     }
-    SDL_UnlockMutex(mu_);
-    return event;
+    return count;
   }
 
-  void PushEvent(PP_InputEvent* event) {
-    SDL_LockMutex(mu_);
-    queue_.push(event);
-    SDL_UnlockMutex(mu_);
+  // Number of events lost because the overflow list couldn't grow.
+  unsigned DroppedEvents() {
+    pthread_mutex_lock(&overflow_mutex_);
+    unsigned dropped = dropped_;
+    pthread_mutex_unlock(&overflow_mutex_);
+    return dropped;
   }
 
 private:
-  std::queue<PP_InputEvent*> queue_;
-  SDL_mutex* mu_;
+  bool Put(const PP_InputEvent& event) {
+    unsigned tail = tail_;
+    if (tail - head_ == kCapacity)
+      return false;
+    events_[tail & (kCapacity - 1)] = event;
+    __sync_synchronize();  // publish the slot before the new tail
+    tail_ = tail + 1;
+    return true;
+  }
+
+  // With overflow_mutex_ held.
+  void AddOverflow(const PP_InputEvent& event) {
+    if (event.type == PP_INPUTEVENT_TYPE_MOUSEMOVE && overflow_count_ > 0 &&
+        overflow_[overflow_count_ - 1].type == PP_INPUTEVENT_TYPE_MOUSEMOVE) {
+      overflow_[overflow_count_ - 1] = event;
+      return;
+    }
+    if (overflow_count_ == overflow_size_) {
+      unsigned size = overflow_size_ ? overflow_size_ * 2 : kCapacity;
+      PP_InputEvent* grown = static_cast<PP_InputEvent*>(
+          realloc(overflow_, size * sizeof(*overflow_)));
+      if (!grown) {
+        ++dropped_;  // out of memory, nowhere left to keep it
+        return;
+      }
+      overflow_ = grown;
+      overflow_size_ = size;
+    }
+    overflow_[overflow_count_++] = event;
+  }
+
+  // Keep the indices written by different threads on separate cache lines.
+  volatile unsigned head_;  // written by the consumer
+  char pad0_[kCacheLineSize - sizeof(unsigned)];
+  volatile unsigned tail_;  // written by the producer
+  char pad1_[kCacheLineSize - sizeof(unsigned)];
+
+  PP_InputEvent events_[kCapacity];
+
+  // Events that didn't fit in the ring, oldest first.
+  volatile bool overflowing_;
+  pthread_mutex_t overflow_mutex_;
+  PP_InputEvent* overflow_;
+  unsigned overflow_count_;
+  unsigned overflow_size_;
+  unsigned dropped_;
 };
 
 #endif // _SDL_nacl_eventqueue_h
@@ -0,0 +1,466 @@
+/* Check that SDL_ConvertAudio gives the same results when it fuses the
+   format, channel and rate stages into one pass as when the stages are
+   run one at a time.  The unfused reference is built from conversions
+   that each change a single thing, so each is a single filter.
+
+   Then check that an SDL_AudioStream gives the same output whether its
+   input is put in odd sized pieces that split frames, or all at once, and
+   that float audio doesn't go through 16 bits when it is mixed or
+   resampled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define MAX_FRAMES	500
+#define NUM_RUNS	20
+#define STREAM_FRAMES	5000
+
+static int failures = 0;
+
+static void RandomSamples(Uint8 *buf, int len, Uint16 format)
+{
+	int i;
+
+	if ( (format & 0xFF) == 32 ) {
+		for ( i=0; i+4<=len; i+=4 ) {
+			union { Uint32 u; float f; } v;
+			int j;
+			/* A little past full scale, to get some clipping */
+			v.f = (float)rand() / RAND_MAX * 2.4f - 1.2f;
+			for ( j=0; j<4; ++j ) {
+				int shift = (format & 0x1000) ? 8*(3-j) : 8*j;
+				buf[i+j] = (Uint8)(v.u >> shift);
+			}
+		}
+	} else {
+		for ( i=0; i<len; ++i ) {
+			buf[i] = (Uint8)rand();
+		}
+	}
+}
+
+/* Run a conversion in place, growing the buffer as needed.  When 'single'
+   is set the conversion must be one filter, or the reference would be
+   using the code it is supposed to check.
+ */
+static int Convert(Uint8 **buf, int *len, int single,
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	SDL_AudioCVT cvt;
+	Uint8 *data;
+
+	if ( SDL_BuildAudioCVT(&cvt, src_format, src_channels, src_rate,
+			dst_format, dst_channels, dst_rate) < 0 ) {
+		printf("Couldn't build conversion: %s\n", SDL_GetError());
+		return -1;
+	}
+	if ( !cvt.needed ) {
+		return 0;
+	}
+	if ( single && cvt.filters[1] != NULL ) {
+		printf("Reference stage 0x%.4x/%d/%d -> 0x%.4x/%d/%d isn't a single filter\n",
+			src_format, src_channels, src_rate,
+			dst_format, dst_channels, dst_rate);
+		return -1;
+	}
+	data = (Uint8 *)malloc(*len * cvt.len_mult);
+	if ( data == NULL ) {
+		printf("Out of memory\n");
+		return -1;
+	}
+	memcpy(data, *buf, *len);
+	free(*buf);
+	cvt.buf = data;
+	cvt.len = *len;
+	SDL_ConvertAudio(&cvt);
+	*buf = cvt.buf;
+	*len = cvt.len_cvt;
+	return 0;
+}
+
+/* Endian, sign, then size, between integer formats */
+static int ConvertFormats(Uint8 **buf, int *len, Uint16 format,
+		Uint16 dst_format, Uint8 channels, int rate)
+{
+	if ( (format & 0xFF) == 16 && (dst_format & 0xFF) == 16 &&
+	     (format & 0x1000) != (dst_format & 0x1000) ) {
+		Uint16 next = format ^ 0x1000;
+		if ( Convert(buf, len, 1, format, channels, rate,
+				next, channels, rate) < 0 ) {
+			return -1;
+		}
+		format = next;
+	}
+	if ( (format & 0x8000) != (dst_format & 0x8000) ) {
+		Uint16 next = format ^ 0x8000;
+		if ( Convert(buf, len, 1, format, channels, rate,
+				next, channels, rate) < 0 ) {
+			return -1;
+		}
+		format = next;
+	}
+	return Convert(buf, len, 1, format, channels, rate,
+			dst_format, channels, rate);
+}
+
+/* The stages in the order SDL_BuildAudioCVT chains them */
+static int ConvertStages(Uint8 **buf, int *len,
+		Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	int src_float = ((src_format & 0xFF) == 32);
+	int dst_float = ((dst_format & 0xFF) == 32);
+	Uint16 mid;
+
+	/* Float changing channels or rate is mixed and resampled as native
+	   float, otherwise it goes through 16-bit */
+	if ( (src_float || dst_float) &&
+	     (src_channels != dst_channels || src_rate != dst_rate) ) {
+		mid = AUDIO_F32SYS;
+		if ( !src_float ) {
+			if ( ConvertFormats(buf, len, src_format, AUDIO_S16SYS,
+					src_channels, src_rate) < 0 ) {
+				return -1;
+			}
+			src_format = AUDIO_S16SYS;
+		}
+	} else {
+		mid = dst_float ? AUDIO_S16SYS : dst_format;
+		if ( src_float ) {
+			if ( Convert(buf, len, 1, src_format, src_channels,
+					src_rate, AUDIO_S16SYS, src_channels,
+					src_rate) < 0 ) {
+				return -1;
+			}
+			src_format = AUDIO_S16SYS;
+		}
+	}
+	if ( (src_format & 0xFF) == 32 || (mid & 0xFF) == 32 ) {
+		if ( Convert(buf, len, 1, src_format, src_channels, src_rate,
+				mid, src_channels, src_rate) < 0 ) {
+			return -1;
+		}
+	} else if ( ConvertFormats(buf, len, src_format, mid,
+					src_channels, src_rate) < 0 ) {
+		return -1;
+	}
+
+	/* Channels, rate, then to the destination format */
+	if ( Convert(buf, len, 1, mid, src_channels, src_rate,
+			mid, dst_channels, src_rate) < 0 ||
+	     Convert(buf, len, 1, mid, dst_channels, src_rate,
+			mid, dst_channels, dst_rate) < 0 ) {
+		return -1;
+	}
+	if ( (mid & 0xFF) == 32 && !dst_float ) {
+		if ( Convert(buf, len, 1, mid, dst_channels, dst_rate,
+				AUDIO_S16SYS, dst_channels, dst_rate) < 0 ) {
+			return -1;
+		}
+		return ConvertFormats(buf, len, AUDIO_S16SYS, dst_format,
+					dst_channels, dst_rate);
+	}
+	return Convert(buf, len, 1, mid, dst_channels, dst_rate,
+			dst_format, dst_channels, dst_rate);
+}
+
+/* The halving stages keep half of an odd trailing frame, which the fused
+   pass drops, so only whole frames are compared */
+static int WholeFrames(int len, Uint16 format, Uint8 channels)
+{
+	int frame = channels * ((format & 0xFF) / 8);
+	return (len / frame) * frame;
+}
+
+static const char *FormatName(Uint16 format)
+{
+	switch (format) {
+	    case AUDIO_U8: return "U8";
+	    case AUDIO_S8: return "S8";
+	    case AUDIO_S16LSB: return "S16LSB";
+	    case AUDIO_S16MSB: return "S16MSB";
+	    case AUDIO_F32LSB: return "F32LSB";
+	    case AUDIO_F32MSB: return "F32MSB";
+	    default: return "?";
+	}
+}
+
+static void TestFused(Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	int run;
+
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		int frames = 1 + rand() % MAX_FRAMES;
+		int len = frames * src_channels * ((src_format & 0xFF) / 8);
+		int fused_len = len, ref_len = len;
+		Uint8 *fused = (Uint8 *)malloc(len);
+		Uint8 *ref = (Uint8 *)malloc(len);
+
+		if ( fused == NULL || ref == NULL ) {
+			printf("Out of memory\n");
+			++failures;
+			return;
+		}
+		RandomSamples(fused, len, src_format);
+		memcpy(ref, fused, len);
+
+		if ( Convert(&fused, &fused_len, 0,
+				src_format, src_channels, src_rate,
+				dst_format, dst_channels, dst_rate) < 0 ||
+		     ConvertStages(&ref, &ref_len,
+				src_format, src_channels, src_rate,
+				dst_format, dst_channels, dst_rate) < 0 ) {
+			++failures;
+		} else if ( WholeFrames(fused_len, dst_format, dst_channels) !=
+			    WholeFrames(ref_len, dst_format, dst_channels) ||
+			    memcmp(fused, ref, WholeFrames(ref_len,
+					dst_format, dst_channels)) != 0 ) {
+			if ( failures++ < 10 ) {
+				printf("%s/%d/%d -> %s/%d/%d: mismatch, %d frames\n",
+					FormatName(src_format), src_channels,
+					src_rate, FormatName(dst_format),
+					dst_channels, dst_rate, frames);
+			}
+		}
+		free(fused);
+		free(ref);
+	}
+}
+
+/* Put all of 'len' bytes in and read everything back out, after a flush */
+static Uint8 *StreamConvert(SDL_AudioStream *stream, const Uint8 *src, int len,
+		int chunked, int *out_len)
+{
+	int size = 0, got = 0, pos = 0;
+	Uint8 *out = NULL;
+
+	*out_len = 0;
+	while ( pos < len ) {
+		int n = len - pos;
+		if ( chunked ) {
+			/* Odd sizes, so most pieces end in the middle of a frame */
+			int piece = 1 + 2 * (rand() % 700);
+			n = SDL_min(n, piece);
+		}
+		if ( SDL_AudioStreamPut(stream, src + pos, n) < 0 ) {
+			printf("Couldn't put audio: %s\n", SDL_GetError());
+			free(out);
+			return NULL;
+		}
+		pos += n;
+		if ( pos == len && SDL_AudioStreamFlush(stream) < 0 ) {
+			printf("Couldn't flush stream: %s\n", SDL_GetError());
+			free(out);
+			return NULL;
+		}
+
+		/* Read some or all of it back, in odd sizes too */
+		do {
+			Uint8 *bigger;
+			int want = SDL_AudioStreamAvailable(stream);
+			if ( chunked && pos < len ) {
+				int piece = 1 + 2 * (rand() % 500);
+				want = SDL_min(want, piece);
+			}
+			if ( want == 0 ) {
+				break;
+			}
+			bigger = (Uint8 *)realloc(out, size + want);
+			if ( bigger == NULL ) {
+				printf("Out of memory\n");
+				free(out);
+				return NULL;
+			}
+			out = bigger;
+			got = SDL_AudioStreamGet(stream, out + size, want);
+			if ( got < 0 ) {
+				printf("Couldn't get audio: %s\n", SDL_GetError());
+				free(out);
+				return NULL;
+			}
+			size += got;
+		} while ( got > 0 && (pos == len || !chunked) );
+	}
+	*out_len = size;
+	return out;
+}
+
+static void TestStream(Uint16 src_format, Uint8 src_channels, int src_rate,
+		Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	int len = STREAM_FRAMES * src_channels * ((src_format & 0xFF) / 8);
+	Uint8 *src = (Uint8 *)malloc(len);
+	Uint8 *whole = NULL, *chunked = NULL;
+	int whole_len, chunked_len, clip;
+	SDL_AudioStream *stream;
+
+	stream = SDL_NewAudioStream(src_format, src_channels, src_rate,
+				dst_format, dst_channels, dst_rate);
+	if ( src == NULL || stream == NULL ) {
+		printf("Couldn't create stream: %s\n", SDL_GetError());
+		++failures;
+		free(src);
+		return;
+	}
+
+	/* Twice, since the stream should be back to new after a flush */
+	for ( clip=0; clip<2; ++clip ) {
+		RandomSamples(src, len, src_format);
+		whole = StreamConvert(stream, src, len, 0, &whole_len);
+		chunked = StreamConvert(stream, src, len, 1, &chunked_len);
+		if ( whole == NULL || chunked == NULL ) {
+			++failures;
+		} else if ( whole_len != chunked_len ||
+			    memcmp(whole, chunked, whole_len) != 0 ) {
+			if ( failures++ < 10 ) {
+				printf("%s/%d/%d -> %s/%d/%d: stream output differs when chunked\n",
+					FormatName(src_format), src_channels,
+					src_rate, FormatName(dst_format),
+					dst_channels, dst_rate);
+			}
+		}
+		free(whole);
+		free(chunked);
+	}
+	SDL_FreeAudioStream(stream);
+	free(src);
+}
+
+static int Near(float a, float b)
+{
+	return (a - b) < 1e-5f && (b - a) < 1e-5f;
+}
+
+/* Float audio changing channels or rate must stay float: a level past
+   full scale that 16 bits can't hold comes out unchanged.  The stream
+   output is only checked away from the ends, where it fades in and out.
+ */
+static void TestFloatLevel(Uint8 src_channels, int src_rate,
+			Uint8 dst_channels, int dst_rate, int stream)
+{
+	const float level = 1.2345678f;
+	float *samples;
+	int frames = 4096, len, i, n, bad = 0;
+
+	len = frames * src_channels * sizeof(float);
+	samples = (float *)malloc(len);
+	if ( samples == NULL ) {
+		printf("Out of memory\n");
+		++failures;
+		return;
+	}
+	for ( i=0; i<frames*src_channels; ++i ) {
+		samples[i] = level;
+	}
+	if ( stream ) {
+		SDL_AudioStream *s = SDL_NewAudioStream(
+				AUDIO_F32SYS, src_channels, src_rate,
+				AUDIO_F32SYS, dst_channels, dst_rate);
+		if ( s == NULL || SDL_AudioStreamPut(s, samples, len) < 0 ||
+		     SDL_AudioStreamFlush(s) < 0 ) {
+			printf("Stream failed: %s\n", SDL_GetError());
+			++failures;
+			free(samples);
+			return;
+		}
+		n = SDL_AudioStreamAvailable(s);
+		free(samples);
+		samples = (float *)malloc(n);
+		n = SDL_AudioStreamGet(s, samples, n) / sizeof(float);
+		SDL_FreeAudioStream(s);
+		for ( i=n/4; i<n*3/4; ++i ) {
+			if ( !Near(samples[i], level) ) {
+				++bad;
+			}
+		}
+	} else {
+		Uint8 *buf = (Uint8 *)samples;
+		if ( Convert(&buf, &len, 0, AUDIO_F32SYS, src_channels, src_rate,
+				AUDIO_F32SYS, dst_channels, dst_rate) < 0 ) {
+			++failures;
+			free(buf);
+			return;
+		}
+		samples = (float *)buf;
+		n = len / sizeof(float);
+		for ( i=0; i<n; ++i ) {
+			if ( !Near(samples[i], level) ) {
+				++bad;
+			}
+		}
+	}
+	free(samples);
+	if ( bad || n == 0 ) {
+		++failures;
+		printf("F32/%d/%d -> F32/%d/%d%s: %d samples not kept as float\n",
+			src_channels, src_rate, dst_channels, dst_rate,
+			stream ? " stream" : "", bad);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	static const Uint16 formats[] = {
+		AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB
+	};
+	static const Uint16 floats[] = { AUDIO_F32LSB, AUDIO_F32MSB };
+	static const int rates[] = { 11025, 22050, 44100 };
+	const int num_formats = sizeof(formats)/sizeof(formats[0]);
+	int s, d, sc, dc, r;
+	int stream_failures, float_failures;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	srand(1);
+
+	/* Every integer format, channel count and power of two rate change */
+	for ( s=0; s<num_formats; ++s )
+	for ( d=0; d<num_formats; ++d )
+	for ( sc=1; sc<=2; ++sc )
+	for ( dc=1; dc<=2; ++dc )
+	for ( r=0; r<3; ++r ) {
+		TestFused(formats[s], sc, 22050, formats[d], dc, rates[r]);
+	}
+
+	/* Float on either end */
+	for ( s=0; s<2; ++s )
+	for ( d=0; d<num_formats; ++d )
+	for ( sc=1; sc<=2; ++sc )
+	for ( dc=1; dc<=2; ++dc )
+	for ( r=0; r<3; ++r ) {
+		TestFused(floats[s], sc, 22050, formats[d], dc, rates[r]);
+		TestFused(formats[d], sc, 22050, floats[s], dc, rates[r]);
+	}
+	printf("Fused conversions: %s\n", failures ? "FAILED" : "passed");
+
+	stream_failures = failures;
+	TestStream(AUDIO_S16LSB, 2, 44100, AUDIO_S16LSB, 2, 44100);
+	TestStream(AUDIO_U8, 1, 22050, AUDIO_S16MSB, 2, 22050);
+	TestStream(AUDIO_S16LSB, 2, 44100, AUDIO_S16LSB, 2, 48000);
+	TestStream(AUDIO_U8, 1, 11025, AUDIO_S16LSB, 2, 44100);
+	TestStream(AUDIO_S16MSB, 2, 48000, AUDIO_U8, 1, 22050);
+	TestStream(AUDIO_F32LSB, 2, 48000, AUDIO_S16LSB, 1, 44100);
+	TestStream(AUDIO_S8, 1, 32000, AUDIO_F32MSB, 2, 44100);
+	printf("Stream chunking: %s\n",
+		failures != stream_failures ? "FAILED" : "passed");
+
+	float_failures = failures;
+	TestFloatLevel(2, 22050, 1, 22050, 0);
+	TestFloatLevel(1, 22050, 2, 44100, 0);
+	TestFloatLevel(2, 44100, 2, 48000, 0);
+	TestFloatLevel(2, 44100, 1, 22050, 1);
+	TestFloatLevel(1, 48000, 2, 44100, 1);
+	printf("Float precision: %s\n",
+		failures != float_failures ? "FAILED" : "passed");
+
+	SDL_Quit();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+
+/* Check that the alpha blitters give the same results as the C reference
+   for the formats that have vector versions, across widths, heights and
+   alignments, so the MMX, SSE2 and AVX2 versions can't drift from it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define MAX_WIDTH	100
+#define MAX_HEIGHT	4
+#define NUM_RUNS	2000
+
+/* d + ((s - d) * alpha >> 8) on one 8-bit channel */
+static Uint32 Blend8(Uint32 s, Uint32 d, int shift, int alpha)
+{
+	int sc = (s >> shift) & 0xff;
+	int dc = (d >> shift) & 0xff;
+	int diff = (sc - dc) * alpha;
+	/* >> rounds down, also for negative numbers */
+	if ( diff < 0 ) {
+		diff = -((-diff + 255) / 256);
+	} else {
+		diff /= 256;
+	}
+	return (Uint32)((dc + diff) & 0xff) << shift;
+}
+
+static Uint32 Blend32(Uint32 s, Uint32 d, int alpha)
+{
+	return Blend8(s, d, 0, alpha) |
+	       Blend8(s, d, 8, alpha) |
+	       Blend8(s, d, 16, alpha) |
+	       (d & 0xff000000);
+}
+
+/* The G0RAB blend of BlitARGBto565PixelAlpha and Blit565to565SurfaceAlpha */
+static Uint16 Blend16(Uint32 s, Uint32 d, unsigned alpha, Uint32 mask)
+{
+	d = (d | d << 16) & mask;
+	d += (s - d) * alpha >> 5;
+	d &= mask;
+	return (Uint16)(d | d >> 16);
+}
+
+static Uint32 RefPixel32(Uint32 s, Uint32 d)
+{
+	Uint32 alpha = s >> 24;
+	if ( alpha == 0 ) {
+		return d;
+	}
+	if ( alpha == 0xff ) {
+		return (s & 0x00ffffff) | (d & 0xff000000);
+	}
+	return Blend32(s, d, alpha);
+}
+
+static Uint16 RefPixel16(Uint32 s, Uint16 d, int is555)
+{
+	unsigned alpha = s >> 27;
+	if ( alpha == 0 ) {
+		return d;
+	}
+	if ( is555 ) {
+		if ( alpha == 31 ) {
+			return (Uint16)((s >> 9 & 0x7c00) + (s >> 6 & 0x3e0) + (s >> 3 & 0x1f));
+		}
+		s = ((s & 0xf800) << 10) + (s >> 9 & 0x7c00) + (s >> 3 & 0x1f);
+		return Blend16(s, d, alpha, 0x03e07c1f);
+	}
+	if ( alpha == 31 ) {
+		return (Uint16)((s >> 8 & 0xf800) + (s >> 5 & 0x7e0) + (s >> 3 & 0x1f));
+	}
+	s = ((s & 0xfc00) << 11) + (s >> 8 & 0xf800) + (s >> 3 & 0x1f);
+	return Blend16(s, d, alpha, 0x07e0f81f);
+}
+
+static Uint16 RefSurface16(Uint16 s, Uint16 d, unsigned alpha, int is555)
+{
+	Uint32 mask = is555 ? 0x03e07c1f : 0x07e0f81f;
+	if ( alpha == 128 ) {
+		Uint16 m = is555 ? 0xfbde : 0xf7de;
+		return (Uint16)((((s & m) + (d & m)) >> 1) + (s & d & (~m & 0xffff)));
+	}
+	return Blend16((s | s << 16) & mask, d, alpha >> 3, mask);
+}
+
+static Uint32 RandomPixel(int *run_alpha)
+{
+	/* Runs of transparent and opaque pixels, like sprites have */
+	if ( rand() % 8 == 0 ) {
+		switch (rand() % 3) {
+		    case 0:
+			*run_alpha = 0x00;
+			break;
+		    case 1:
+			*run_alpha = 0xff;
+			break;
+		    default:
+			*run_alpha = -1;
+			break;
+		}
+	}
+	if ( *run_alpha < 0 ) {
+		return ((Uint32)rand() << 16) ^ (Uint32)rand();
+	}
+	return ((Uint32)*run_alpha << 24) |
+	       (((Uint32)rand() << 12 ^ (Uint32)rand()) & 0x00ffffff);
+}
+
+enum {
+	PIXEL_ARGB8888,
+	PIXEL_ARGB_TO_565,
+	PIXEL_ARGB_TO_555,
+	SURFACE_RGB888,
+	SURFACE_565,
+	SURFACE_555
+};
+
+static int TestBlit(int type, const char *name)
+{
+	int run, failures = 0;
+
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		SDL_Surface *src, *dst;
+		SDL_Rect srect, drect;
+		Uint32 *ref;
+		unsigned alpha = 1 + rand() % 254;
+		int run_alpha = -1;
+		int w = 1 + rand() % MAX_WIDTH;
+		int h = 1 + rand() % MAX_HEIGHT;
+		int x, y, bad = 0;
+
+		if ( run % 10 == 0 ) {
+			alpha = 128;
+		}
+		switch (type) {
+		    case PIXEL_ARGB8888:
+		    case PIXEL_ARGB_TO_565:
+		    case PIXEL_ARGB_TO_555:
+			src = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 32,
+				0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+			break;
+		    case SURFACE_RGB888:
+			src = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 32,
+				0x00ff0000, 0x0000ff00, 0x000000ff, 0);
+			break;
+		    case SURFACE_565:
+			src = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 16,
+				0xf800, 0x07e0, 0x001f, 0);
+			break;
+		    default:
+			src = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 16,
+				0x7c00, 0x03e0, 0x001f, 0);
+			break;
+		}
+		switch (type) {
+		    case PIXEL_ARGB8888:
+		    case SURFACE_RGB888:
+			dst = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 32,
+				0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+			break;
+		    case PIXEL_ARGB_TO_565:
+		    case SURFACE_565:
+			dst = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 16,
+				0xf800, 0x07e0, 0x001f, 0);
+			break;
+		    default:
+			dst = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT, 16,
+				0x7c00, 0x03e0, 0x001f, 0);
+			break;
+		}
+		if ( src == NULL || dst == NULL ) {
+			fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+			exit(1);
+		}
+		if ( type >= SURFACE_RGB888 ) {
+			SDL_SetAlpha(src, SDL_SRCALPHA, (Uint8)alpha);
+		}
+
+		for ( y=0; y<MAX_HEIGHT; ++y ) {
+			for ( x=0; x<MAX_WIDTH+8; ++x ) {
+				Uint8 *sp = (Uint8 *)src->pixels + y*src->pitch;
+				Uint8 *dp = (Uint8 *)dst->pixels + y*dst->pitch;
+				if ( src->format->BytesPerPixel == 4 ) {
+					((Uint32 *)sp)[x] = RandomPixel(&run_alpha);
+				} else {
+					((Uint16 *)sp)[x] = (Uint16)rand();
+				}
+				if ( dst->format->BytesPerPixel == 4 ) {
+					((Uint32 *)dp)[x] = RandomPixel(&run_alpha);
+				} else {
+					((Uint16 *)dp)[x] = (Uint16)rand();
+				}
+			}
+		}
+
+		srect.x = rand() % 8;
+		srect.y = 0;
+		srect.w = w;
+		srect.h = h;
+		drect.x = rand() % 8;
+		drect.y = 0;
+
+		/* The expected destination */
+		ref = (Uint32 *)malloc(MAX_HEIGHT * (MAX_WIDTH+8) * sizeof(Uint32));
+		for ( y=0; y<MAX_HEIGHT; ++y ) {
+			for ( x=0; x<MAX_WIDTH+8; ++x ) {
+				Uint8 *sp = (Uint8 *)src->pixels + y*src->pitch;
+				Uint8 *dp = (Uint8 *)dst->pixels + y*dst->pitch;
+				int sx = x - drect.x + srect.x;
+				Uint32 d, r;
+
+				if ( dst->format->BytesPerPixel == 4 ) {
+					d = ((Uint32 *)dp)[x];
+				} else {
+					d = ((Uint16 *)dp)[x];
+				}
+				r = d;
+				if ( y < h && x >= drect.x && x < drect.x + w ) {
+					switch (type) {
+					    case PIXEL_ARGB8888:
+						r = RefPixel32(((Uint32 *)sp)[sx], d);
+						break;
+					    case PIXEL_ARGB_TO_565:
+						r = RefPixel16(((Uint32 *)sp)[sx], (Uint16)d, 0);
+						break;
+					    case PIXEL_ARGB_TO_555:
+						r = RefPixel16(((Uint32 *)sp)[sx], (Uint16)d, 1);
+						break;
+					    case SURFACE_RGB888:
+						r = Blend32(((Uint32 *)sp)[sx], d, alpha) | 0xff000000;
+						break;
+					    case SURFACE_565:
+						r = RefSurface16(((Uint16 *)sp)[sx], (Uint16)d, alpha, 0);
+						break;
+					    case SURFACE_555:
+						r = RefSurface16(((Uint16 *)sp)[sx], (Uint16)d, alpha, 1);
+						break;
+					}
+				}
+				ref[y*(MAX_WIDTH+8)+x] = r;
+			}
+		}
+
+		SDL_BlitSurface(src, &srect, dst, &drect);
+
+		for ( y=0; y<MAX_HEIGHT; ++y ) {
+			for ( x=0; x<MAX_WIDTH+8; ++x ) {
+				Uint8 *dp = (Uint8 *)dst->pixels + y*dst->pitch;
+				Uint32 d;
+
+				if ( dst->format->BytesPerPixel == 4 ) {
+					d = ((Uint32 *)dp)[x];
+				} else {
+					d = ((Uint16 *)dp)[x];
+				}
+				if ( d != ref[y*(MAX_WIDTH+8)+x] ) {
+					bad = 1;
+				}
+			}
+		}
+		if ( bad && failures++ < 5 ) {
+			printf("%s: mismatch, %dx%d, alpha %u, offsets %d/%d\n",
+				name, w, h, alpha, srect.x, drect.x);
+		}
+		free(ref);
+		SDL_FreeSurface(src);
+		SDL_FreeSurface(dst);
+	}
+
+	printf("%s: %s\n", name, failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int status = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	srand(1);
+
+	printf("MMX: %d, SSE2: %d, AVX2: %d\n",
+		SDL_HasMMX(), SDL_HasSSE2(), SDL_HasAVX2());
+	status += TestBlit(PIXEL_ARGB8888, "ARGB8888 pixel alpha");
+	status += TestBlit(PIXEL_ARGB_TO_565, "ARGB8888->RGB565 pixel alpha");
+	status += TestBlit(PIXEL_ARGB_TO_555, "ARGB8888->RGB555 pixel alpha");
+	status += TestBlit(SURFACE_RGB888, "RGB888 surface alpha");
+	status += TestBlit(SURFACE_565, "RGB565 surface alpha");
+	status += TestBlit(SURFACE_555, "RGB555 surface alpha");
+
+	SDL_Quit();
+	return status;
+}
@@ -0,0 +1,179 @@
+
+/* Check that blits, fills and stretches split into bands on the worker
+   threads give exactly the same results as on one thread, and time them
+   both ways.  The number of workers is the first argument, 4 by default.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define WIDTH		1920
+#define HEIGHT		1080
+#define NUM_RUNS	10
+
+enum {
+	BLIT_COPY,
+	BLIT_CONVERT,
+	BLIT_ALPHA,
+	BLIT_FILL,
+	BLIT_STRETCH,
+	NUM_TESTS
+};
+
+static const char *names[] = {
+	"32 bpp copy", "xRGB8888->RGB565", "ARGB8888 pixel alpha",
+	"RGB888 fill", "bilinear stretch"
+};
+
+static SDL_Surface *src, *alpha, *small;
+
+static SDL_Surface *CreateSurface(int w, int h, int bpp, Uint32 Rmask,
+				  Uint32 Gmask, Uint32 Bmask, Uint32 Amask)
+{
+	SDL_Surface *surface;
+	int i;
+
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, bpp,
+				       Rmask, Gmask, Bmask, Amask);
+	if ( surface == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n", SDL_GetError());
+		exit(1);
+	}
+	for ( i=0; i<surface->pitch*surface->h; ++i ) {
+		((Uint8 *)surface->pixels)[i] = (Uint8)rand();
+	}
+	return surface;
+}
+
+static SDL_Surface *CopySurface(SDL_Surface *initial)
+{
+	SDL_Surface *surface;
+
+	surface = SDL_ConvertSurface(initial, initial->format, SDL_SWSURFACE);
+	if ( surface == NULL ) {
+		fprintf(stderr, "Couldn't copy surface: %s\n", SDL_GetError());
+		exit(1);
+	}
+	return surface;
+}
+
+static SDL_Surface *CreateInitial(int test)
+{
+	switch (test) {
+	    case BLIT_CONVERT:
+		return CreateSurface(WIDTH, HEIGHT, 16, 0xF800, 0x07E0, 0x001F, 0);
+	    case BLIT_FILL:
+		return CreateSurface(WIDTH, HEIGHT, 24,
+				     0xFF0000, 0x00FF00, 0x0000FF, 0);
+	    default:
+		return CreateSurface(WIDTH, HEIGHT, 32,
+				     0xFF0000, 0x00FF00, 0x0000FF, 0);
+	}
+}
+
+/* Run a test on 'dst', returning the fastest time in milliseconds */
+static double RunTest(int test, SDL_Surface *dst)
+{
+	SDL_Rect rect;
+	Uint64 start, best = 0;
+	int run;
+
+	/* Not lined up with anything, so the bands get odd sizes */
+	rect.x = 3;
+	rect.y = 5;
+	rect.w = WIDTH - 10;
+	rect.h = HEIGHT - 13;
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		SDL_Rect r = rect;
+
+		start = SDL_GetPerformanceCounter();
+		switch (test) {
+		    case BLIT_COPY:
+		    case BLIT_CONVERT:
+			SDL_BlitSurface(src, NULL, dst, &r);
+			break;
+		    case BLIT_ALPHA:
+			SDL_BlitSurface(alpha, NULL, dst, &r);
+			break;
+		    case BLIT_FILL:
+			SDL_FillRect(dst, &r, 0x123456 + run);
+			break;
+		    case BLIT_STRETCH:
+			SDL_SoftStretchFilter(small, NULL, dst, &r,
+					      SDL_STRETCH_BILINEAR);
+			break;
+		}
+		start = SDL_GetPerformanceCounter() - start;
+		if ( run == 0 || start < best ) {
+			best = start;
+		}
+	}
+	return (double)best * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char *argv[])
+{
+	SDL_Surface *initial[NUM_TESTS];
+	SDL_Surface *serial[NUM_TESTS], *banded[NUM_TESTS];
+	double serial_ms[NUM_TESTS];
+	char env[64];
+	int i, status = 0;
+
+	srand(1);
+	src = CreateSurface(WIDTH, HEIGHT, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+	alpha = CreateSurface(WIDTH, HEIGHT, 32,
+			      0xFF0000, 0x00FF00, 0x0000FF, 0xFF000000);
+	small = CreateSurface(WIDTH/3, HEIGHT/3, 32,
+			      0xFF0000, 0x00FF00, 0x0000FF, 0);
+	for ( i=0; i<NUM_TESTS; ++i ) {
+		initial[i] = CreateInitial(i);
+	}
+
+	/* Once on this thread... */
+	SDL_putenv("SDL_BLIT_THREADS=0");
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	for ( i=0; i<NUM_TESTS; ++i ) {
+		serial[i] = CopySurface(initial[i]);
+		serial_ms[i] = RunTest(i, serial[i]);
+	}
+	SDL_Quit();
+
+	/* ...and again on the workers */
+	SDL_snprintf(env, sizeof(env), "SDL_BLIT_THREADS=%d",
+		     (argc > 1) ? atoi(argv[1]) : 4);
+	SDL_putenv(env);
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	printf("%s\n", env);
+	for ( i=0; i<NUM_TESTS; ++i ) {
+		double ms;
+		int same;
+
+		banded[i] = CopySurface(initial[i]);
+		ms = RunTest(i, banded[i]);
+		same = (SDL_memcmp(banded[i]->pixels, serial[i]->pixels,
+			banded[i]->pitch * banded[i]->h) == 0);
+		printf("%-24s %7.2f ms -> %7.2f ms  %s\n", names[i],
+			serial_ms[i], ms, same ? "passed" : "FAILED");
+		if ( !same ) {
+			status = 1;
+		}
+		SDL_FreeSurface(serial[i]);
+		SDL_FreeSurface(banded[i]);
+		SDL_FreeSurface(initial[i]);
+	}
+	SDL_Quit();
+
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(alpha);
+	SDL_FreeSurface(small);
+	return status;
+}
@@ -0,0 +1,182 @@
+
+/* Check that the pixel format conversion blitters give the same results
+   as the C reference for every pair of common 16, 24 and 32-bit formats,
+   across widths, heights and alignments, so the SSE2 and SSSE3 versions
+   can't drift from it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define MAX_WIDTH	100
+#define MAX_HEIGHT	4
+#define NUM_RUNS	200
+
+static const struct {
+	const char *name;
+	int bpp;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+} formats[] = {
+	{ "RGB565", 16, 0x0000F800, 0x000007E0, 0x0000001F, 0x00000000 },
+	{ "BGR565", 16, 0x0000001F, 0x000007E0, 0x0000F800, 0x00000000 },
+	{ "RGB555", 16, 0x00007C00, 0x000003E0, 0x0000001F, 0x00000000 },
+	{ "ARGB1555", 16, 0x00007C00, 0x000003E0, 0x0000001F, 0x00008000 },
+	{ "ARGB4444", 16, 0x00000F00, 0x000000F0, 0x0000000F, 0x0000F000 },
+	{ "RGB888", 24, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000 },
+	{ "BGR888", 24, 0x000000FF, 0x0000FF00, 0x00FF0000, 0x00000000 },
+	{ "xRGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000 },
+	{ "xBGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0x00000000 },
+	{ "ARGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 },
+	{ "ABGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 },
+	{ "RGBA8888", 32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "BGRA8888", 32, 0x0000FF00, 0x00FF0000, 0xFF000000, 0x000000FF },
+	{ "RGBx8888", 32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x00000000 },
+};
+#define NUM_FORMATS	(sizeof(formats) / sizeof(formats[0]))
+
+static Uint32 GetPixel(SDL_Surface *surface, int x, int y)
+{
+	Uint8 *p = (Uint8 *)surface->pixels + y * surface->pitch +
+			x * surface->format->BytesPerPixel;
+	switch (surface->format->BytesPerPixel) {
+	    case 2:
+		return *(Uint16 *)p;
+	    case 3:
+		return p[0] | (p[1] << 8) | (p[2] << 16);
+	    default:
+		return *(Uint32 *)p;
+	}
+}
+
+static Uint8 Widen(Uint32 pixel, Uint32 mask, Uint8 shift, Uint8 loss)
+{
+	return (Uint8)(((pixel & mask) >> shift) << loss);
+}
+
+static Uint32 Narrow(Uint8 value, Uint8 shift, Uint8 loss)
+{
+	return (Uint32)(value >> loss) << shift;
+}
+
+/* What BlitNtoN and BlitNtoNCopyAlpha do, except that the RGB565 lookup
+   tables for 32-bit destinations with alpha scale each channel to 0-255
+   and always make it opaque.  Green is looked up in two halves there,
+   one from each byte of the source pixel.
+ */
+static Uint32 Reference(SDL_PixelFormat *sf, SDL_PixelFormat *df, Uint32 s)
+{
+	Uint8 r = Widen(s, sf->Rmask, sf->Rshift, sf->Rloss);
+	Uint8 g = Widen(s, sf->Gmask, sf->Gshift, sf->Gloss);
+	Uint8 b = Widen(s, sf->Bmask, sf->Bshift, sf->Bloss);
+	Uint8 a = sf->Amask ? Widen(s, sf->Amask, sf->Ashift, sf->Aloss) : sf->alpha;
+
+	if ( sf->BytesPerPixel == 2 && sf->Rmask == 0xF800 && sf->Gmask == 0x07E0 &&
+	     df->BytesPerPixel == 4 && df->Amask ) {
+		r = (Uint8)(((s >> 11) & 0x1F) * 255 / 31);
+		g = (Uint8)(((s >> 5) & 0x38) * 255 / 63 + ((s >> 5) & 0x07) * 255 / 63);
+		b = (Uint8)((s & 0x1F) * 255 / 31);
+		a = 0xFF;
+	}
+	return Narrow(r, df->Rshift, df->Rloss) |
+	       Narrow(g, df->Gshift, df->Gloss) |
+	       Narrow(b, df->Bshift, df->Bloss) |
+	       Narrow(a, df->Ashift, df->Aloss);
+}
+
+static int TestConversion(int from, int to)
+{
+	int run, failures = 0;
+
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		SDL_Surface *src, *dst, *orig;
+		SDL_Rect srect, drect;
+		int w = 1 + rand() % MAX_WIDTH;
+		int h = 1 + rand() % MAX_HEIGHT;
+		int x, y, bad = 0;
+
+		src = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT,
+			formats[from].bpp, formats[from].Rmask, formats[from].Gmask,
+			formats[from].Bmask, formats[from].Amask);
+		dst = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT,
+			formats[to].bpp, formats[to].Rmask, formats[to].Gmask,
+			formats[to].Bmask, formats[to].Amask);
+		orig = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_WIDTH+8, MAX_HEIGHT,
+			formats[to].bpp, formats[to].Rmask, formats[to].Gmask,
+			formats[to].Bmask, formats[to].Amask);
+		if ( src == NULL || dst == NULL || orig == NULL ) {
+			fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+			exit(1);
+		}
+		/* A plain copy, no blending */
+		SDL_SetAlpha(src, 0, SDL_ALPHA_OPAQUE);
+
+		for ( y=0; y<MAX_HEIGHT; ++y ) {
+			Uint8 *sp = (Uint8 *)src->pixels + y*src->pitch;
+			Uint8 *dp = (Uint8 *)dst->pixels + y*dst->pitch;
+			for ( x=0; x<src->pitch; ++x ) {
+				sp[x] = (Uint8)rand();
+			}
+			for ( x=0; x<dst->pitch; ++x ) {
+				dp[x] = (Uint8)rand();
+			}
+		}
+		SDL_memcpy(orig->pixels, dst->pixels, dst->pitch * MAX_HEIGHT);
+
+		srect.x = rand() % 8;
+		srect.y = 0;
+		srect.w = w;
+		srect.h = h;
+		drect.x = rand() % 8;
+		drect.y = 0;
+		SDL_BlitSurface(src, &srect, dst, &drect);
+
+		for ( y=0; y<MAX_HEIGHT; ++y ) {
+			for ( x=0; x<MAX_WIDTH+8; ++x ) {
+				Uint32 expected = GetPixel(orig, x, y);
+				if ( y < h && x >= drect.x && x < drect.x + w ) {
+					expected = Reference(src->format, dst->format,
+						GetPixel(src, x - drect.x + srect.x, y));
+				}
+				if ( GetPixel(dst, x, y) != expected ) {
+					bad = 1;
+				}
+			}
+		}
+		if ( bad && failures++ < 3 ) {
+			printf("%s->%s: mismatch, %dx%d, offsets %d/%d\n",
+				formats[from].name, formats[to].name,
+				w, h, srect.x, drect.x);
+		}
+		SDL_FreeSurface(src);
+		SDL_FreeSurface(dst);
+		SDL_FreeSurface(orig);
+	}
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int from, to, status = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	srand(1);
+
+	printf("SSE2: %d, SSSE3: %d\n", SDL_HasSSE2(), SDL_HasSSSE3());
+	for ( from=0; from<NUM_FORMATS; ++from ) {
+		for ( to=0; to<NUM_FORMATS; ++to ) {
+			if ( from != to ) {
+				status += TestConversion(from, to);
+			}
+		}
+	}
+	printf("%s\n", status ? "FAILED" : "passed");
+
+	SDL_Quit();
+	return status;
+}
@@ -13,6 +13,7 @@
 static SDL_Surface *dest = NULL;
 static SDL_Surface *src = NULL;
 static int testSeconds = 10;
+static Uint64 pixelsBlitted = 0;
 
 
 static int percent(int val, int total)
@@ -142,9 +143,10 @@ static void output_details(void)
     output_surface_details("Destination Surface", dest);
 }
 
-static Uint32 blit(SDL_Surface *dst, SDL_Surface *src, int x, int y)
+static Uint64 blit(SDL_Surface *dst, SDL_Surface *src, int x, int y)
 {
-    Uint32 start = 0;
+    Uint64 start = 0;
+    Uint64 elapsed = 0;
     SDL_Rect srcRect;
     SDL_Rect dstRect;
 
@@ -155,9 +157,13 @@ static Uint32 blit(SDL_Surface *dst, SDL_Surface *src, int x, int y)
     dstRect.w = srcRect.w = src->w;  /* SDL will clip as appropriate. */
     dstRect.h = srcRect.h = src->h;
 
-    start = SDL_GetTicks();
+    start = SDL_GetPerformanceCounter();
     SDL_BlitSurface(src, &srcRect, dst, &dstRect);
-    return(SDL_GetTicks() - start);
+    elapsed = SDL_GetPerformanceCounter() - start;
+
+    /* SDL_BlitSurface() leaves the clipped size in dstRect */
+    pixelsBlitted += (Uint64) dstRect.w * dstRect.h;
+    return(elapsed);
 }
 
 static void blitCentered(SDL_Surface *dst, SDL_Surface *src)
@@ -361,7 +367,10 @@ static void test_blit_speed(void)
 {
     Uint32 clearColor = SDL_MapRGB(dest->format, 0, 0, 0);
     Uint32 iterations = 0;
-    Uint32 elasped = 0;
+    Uint64 elasped = 0;
+    Uint64 freq = SDL_GetPerformanceFrequency();
+    double seconds = 0.0;
+    int bytesPerPixel = src->format->BytesPerPixel + dest->format->BytesPerPixel;
     Uint32 end = 0;
     Uint32 now = 0;
     Uint32 last = 0;
@@ -396,13 +405,19 @@ static void test_blit_speed(void)
         now = SDL_GetTicks();
     } while (now < end);
 
+    seconds = (double) elasped / freq;
     printf("Non-blitting crap accounted for %d percent of this run.\n",
-            percent(testms - elasped, testms));
+            percent(testms - (int) (seconds * 1000.0), testms));
 
     printf("%d blits took %d ms (%d fps).\n",
             (int) iterations,
-            (int) elasped,
-            (int) (((float)iterations) / (((float)elasped) / 1000.0f)));
+            (int) (seconds * 1000.0),
+            (int) (iterations / seconds));
+
+    /* Bytes read from the source plus bytes written to the destination */
+    printf("%.1f Mpixels/s, %.1f MB/s.\n",
+            pixelsBlitted / seconds / 1000000.0,
+            pixelsBlitted * bytesPerPixel / seconds / 1000000.0);
 }
 
 int main(int argc, char **argv)
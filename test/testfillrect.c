@@ -0,0 +1,192 @@
+
+/* Check that SDL_FillRect and SDL_FillRects give the same results as a
+   pixel by pixel reference at every depth, including packed 1 and 4-bit
+   pixels, for small rects at all alignments and for fills big enough to
+   take the streaming path.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define MAX_WIDTH	100
+#define MAX_HEIGHT	4
+#define NUM_RUNS	2000
+
+static const int depths[] = { 1, 4, 8, 16, 24, 32 };
+#define NUM_DEPTHS	(sizeof(depths) / sizeof(depths[0]))
+
+static void PutPixel(SDL_Surface *surface, int x, int y, Uint32 color)
+{
+	Uint8 *row = (Uint8 *)surface->pixels + y * surface->pitch;
+	int shift;
+
+	switch (surface->format->BitsPerPixel) {
+	    case 1:
+		shift = 7 - (x & 7);
+		row[x >> 3] = (row[x >> 3] & ~(1 << shift)) | ((color & 1) << shift);
+		break;
+	    case 4:
+		shift = (x & 1) ? 0 : 4;
+		row[x >> 1] = (row[x >> 1] & ~(0x0F << shift)) | ((color & 0x0F) << shift);
+		break;
+	    case 8:
+		row[x] = (Uint8)color;
+		break;
+	    case 16:
+		((Uint16 *)row)[x] = (Uint16)color;
+		break;
+	    case 24:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		row[x*3] = (Uint8)(color >> 16);
+		row[x*3+1] = (Uint8)(color >> 8);
+		row[x*3+2] = (Uint8)color;
+#else
+		row[x*3] = (Uint8)color;
+		row[x*3+1] = (Uint8)(color >> 8);
+		row[x*3+2] = (Uint8)(color >> 16);
+#endif
+		break;
+	    default:
+		((Uint32 *)row)[x] = color;
+		break;
+	}
+}
+
+static Uint32 RandomColor(int depth)
+{
+	Uint32 color = ((Uint32)rand() << 16) ^ (Uint32)rand();
+	if ( rand() % 8 == 0 ) {
+		color = 0;
+	}
+	if ( depth < 32 ) {
+		color &= (1 << depth) - 1;
+	}
+	return color;
+}
+
+static void ReferenceFill(SDL_Surface *surface, SDL_Rect *rect, Uint32 color)
+{
+	int x, y;
+
+	for ( y=rect->y; y<rect->y+rect->h; ++y ) {
+		for ( x=rect->x; x<rect->x+rect->w; ++x ) {
+			if ( x >= 0 && x < surface->w && y >= 0 && y < surface->h ) {
+				PutPixel(surface, x, y, color);
+			}
+		}
+	}
+}
+
+static SDL_Surface *CreateSurface(int depth, int w, int h)
+{
+	SDL_Surface *surface;
+
+	surface = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, depth, 0, 0, 0, 0);
+	if ( surface == NULL ) {
+		fprintf(stderr, "Couldn't create surface: %s\n", SDL_GetError());
+		exit(1);
+	}
+	return surface;
+}
+
+static void Scribble(SDL_Surface *a, SDL_Surface *b)
+{
+	int i;
+	for ( i=0; i<a->pitch*a->h; ++i ) {
+		((Uint8 *)a->pixels)[i] = ((Uint8 *)b->pixels)[i] = (Uint8)rand();
+	}
+}
+
+static SDL_Rect RandomRect(int w, int h)
+{
+	SDL_Rect rect;
+	/* Sometimes hanging over the edges, to exercise the clipping */
+	rect.x = (Sint16)(rand() % (w + 8) - 4);
+	rect.y = (Sint16)(rand() % (h + 2) - 1);
+	rect.w = (Uint16)(rand() % (w + 1));
+	rect.h = (Uint16)(rand() % (h + 1));
+	return rect;
+}
+
+static int TestDepth(int depth)
+{
+	int run, failures = 0;
+	int w = MAX_WIDTH + 8;
+
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		SDL_Surface *surface = CreateSurface(depth, w, MAX_HEIGHT);
+		SDL_Surface *ref = CreateSurface(depth, w, MAX_HEIGHT);
+		Uint32 color = RandomColor(depth);
+		SDL_Rect rects[4];
+		int i, count = 1 + rand() % 4;
+
+		Scribble(surface, ref);
+		for ( i=0; i<count; ++i ) {
+			rects[i] = RandomRect(w, MAX_HEIGHT);
+			ReferenceFill(ref, &rects[i], color);
+		}
+		if ( count == 1 ) {
+			SDL_FillRect(surface, &rects[0], color);
+		} else {
+			SDL_FillRects(surface, rects, count, color);
+		}
+		if ( SDL_memcmp(surface->pixels, ref->pixels, surface->pitch*MAX_HEIGHT) != 0 ) {
+			if ( failures++ < 5 ) {
+				printf("%d bpp: mismatch, %d rects, first %dx%d at %d,%d\n",
+					depth, count, rects[0].w, rects[0].h,
+					rects[0].x, rects[0].y);
+			}
+		}
+		SDL_FreeSurface(surface);
+		SDL_FreeSurface(ref);
+	}
+	return failures;
+}
+
+static int TestLargeFill(int depth)
+{
+	SDL_Surface *surface = CreateSurface(depth, 1920, 1080);
+	SDL_Surface *ref = CreateSurface(depth, 1920, 1080);
+	Uint32 color = RandomColor(depth);
+	SDL_Rect rect;
+	int failures = 0;
+
+	Scribble(surface, ref);
+	rect.x = 3;
+	rect.y = 1;
+	rect.w = 1915;
+	rect.h = 1078;
+	ReferenceFill(ref, &rect, color);
+	SDL_FillRect(surface, &rect, color);
+	if ( SDL_memcmp(surface->pixels, ref->pixels, surface->pitch*surface->h) != 0 ) {
+		printf("%d bpp: large fill mismatch\n", depth);
+		failures = 1;
+	}
+	SDL_FreeSurface(surface);
+	SDL_FreeSurface(ref);
+	return failures;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, failures, status = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	srand(1);
+
+	printf("SSE2: %d\n", SDL_HasSSE2());
+	for ( i=0; i<NUM_DEPTHS; ++i ) {
+		failures = TestDepth(depths[i]) + TestLargeFill(depths[i]);
+		printf("%d bpp: %s\n", depths[i], failures ? "FAILED" : "passed");
+		status += failures ? 1 : 0;
+	}
+
+	SDL_Quit();
+	return status;
+}
@@ -0,0 +1,224 @@
+
+/* Check that SDL_MixAudio gives the same results as the C reference for
+   every sample format, volume, length and alignment, so the vector
+   versions can't drift from it.  Uses the dummy audio driver.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#define MAX_LEN		300
+#define NUM_RUNS	4000
+
+static Uint8 Mix8(int value)
+{
+	/* The mix8 table in SDL_mixer.c */
+	value -= 128;
+	if ( value < 0 ) {
+		return 0;
+	}
+	if ( value > 0xFE ) {
+		return 0xFE;
+	}
+	return (Uint8)value;
+}
+
+static int Clamp(int value, int min, int max)
+{
+	if ( value < min ) {
+		return min;
+	}
+	if ( value > max ) {
+		return max;
+	}
+	return value;
+}
+
+static float ReadFloat(const Uint8 *p, int msb)
+{
+	union { Uint32 u; float f; } v;
+	if ( msb ) {
+		v.u = ((Uint32)p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3];
+	} else {
+		v.u = ((Uint32)p[3]<<24)|(p[2]<<16)|(p[1]<<8)|p[0];
+	}
+	return v.f;
+}
+
+static void WriteFloat(Uint8 *p, float f, int msb)
+{
+	union { Uint32 u; float f; } v;
+	int i;
+	v.f = f;
+	for ( i=0; i<4; ++i ) {
+		p[msb ? 3-i : i] = (Uint8)(v.u >> (8*i));
+	}
+}
+
+static void ReferenceMix(Uint16 format, Uint8 *dst, const Uint8 *src,
+			Uint32 len, int volume)
+{
+	Uint32 i;
+
+	switch (format) {
+	    case AUDIO_U8:
+		for ( i=0; i<len; ++i ) {
+			Uint8 s = (Uint8)((((int)src[i]-128)*volume)/SDL_MIX_MAXVOLUME+128);
+			dst[i] = Mix8(dst[i] + s);
+		}
+		break;
+	    case AUDIO_S8:
+		for ( i=0; i<len; ++i ) {
+			Sint8 s = (Sint8)((((Sint8)src[i])*volume)/SDL_MIX_MAXVOLUME);
+			dst[i] = (Uint8)Clamp((Sint8)dst[i] + s, -128, 127);
+		}
+		break;
+	    case AUDIO_S16LSB:
+		for ( i=0; i+1<len; i+=2 ) {
+			Sint16 s = (Sint16)((src[i+1]<<8)|src[i]);
+			Sint16 d = (Sint16)((dst[i+1]<<8)|dst[i]);
+			int m = Clamp(d + (s*volume)/SDL_MIX_MAXVOLUME, -32768, 32767);
+			dst[i] = m & 0xFF;
+			dst[i+1] = (m >> 8) & 0xFF;
+		}
+		break;
+	    case AUDIO_S16MSB:
+		for ( i=0; i+1<len; i+=2 ) {
+			Sint16 s = (Sint16)((src[i]<<8)|src[i+1]);
+			Sint16 d = (Sint16)((dst[i]<<8)|dst[i+1]);
+			int m = Clamp(d + (s*volume)/SDL_MIX_MAXVOLUME, -32768, 32767);
+			dst[i+1] = m & 0xFF;
+			dst[i] = (m >> 8) & 0xFF;
+		}
+		break;
+	    case AUDIO_F32LSB:
+	    case AUDIO_F32MSB:
+		for ( i=0; i+3<len; i+=4 ) {
+			int msb = (format == AUDIO_F32MSB);
+			float m = ReadFloat(src+i, msb) *
+				((float)volume / SDL_MIX_MAXVOLUME) +
+				ReadFloat(dst+i, msb);
+			if ( m > 1.0f ) {
+				m = 1.0f;
+			} else if ( m < -1.0f ) {
+				m = -1.0f;
+			}
+			WriteFloat(dst+i, m, msb);
+		}
+		break;
+	}
+}
+
+static Uint8 RandomByte(void)
+{
+	/* Favor the extremes, where the clamping happens */
+	switch (rand() % 4) {
+	    case 0:
+		return 0x00;
+	    case 1:
+		return (rand() % 2) ? 0x7F : 0x80;
+	    case 2:
+		return 0xFF;
+	    default:
+		return (Uint8)rand();
+	}
+}
+
+static float RandomFloat(void)
+{
+	/* Favor the extremes, where the clamping happens */
+	switch (rand() % 4) {
+	    case 0:
+		return 1.0f;
+	    case 1:
+		return (rand() % 2) ? 1.5f : -1.5f;
+	    default:
+		return (float)rand() / RAND_MAX * 2.0f - 1.0f;
+	}
+}
+
+static void SDLCALL Silence(void *unused, Uint8 *stream, int len)
+{
+}
+
+static int TestFormat(Uint16 format, const char *name)
+{
+	SDL_AudioSpec spec;
+	Uint8 src[MAX_LEN+16], dst[MAX_LEN+16], ref[MAX_LEN+16];
+	int run, failures = 0;
+
+	SDL_memset(&spec, 0, sizeof(spec));
+	spec.freq = 22050;
+	spec.format = format;
+	spec.channels = 2;
+	spec.samples = 512;
+	spec.callback = Silence;
+	if ( SDL_OpenAudio(&spec, NULL) < 0 ) {
+		fprintf(stderr, "Couldn't open audio: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		int src_offset = rand() % 16;
+		int dst_offset = rand() % 16;
+		Uint32 len = rand() % MAX_LEN;
+		int volume = 1 + (run % SDL_MIX_MAXVOLUME);
+		Uint32 i;
+
+		if ( (format & 0xFF) == 16 ) {
+			len &= ~1;
+		}
+		if ( (format & 0xFF) == 32 ) {
+			int msb = (format == AUDIO_F32MSB);
+			len &= ~3;
+			for ( i=0; i<len; i+=4 ) {
+				WriteFloat(src+src_offset+i, RandomFloat(), msb);
+				WriteFloat(dst+dst_offset+i, RandomFloat(), msb);
+			}
+		} else {
+			for ( i=0; i<len; ++i ) {
+				src[src_offset+i] = RandomByte();
+				dst[dst_offset+i] = RandomByte();
+			}
+		}
+		SDL_memcpy(ref, dst+dst_offset, len);
+
+		SDL_MixAudio(dst+dst_offset, src+src_offset, len, volume);
+		ReferenceMix(format, ref, src+src_offset, len, volume);
+		if ( SDL_memcmp(dst+dst_offset, ref, len) != 0 ) {
+			if ( failures++ < 5 ) {
+				printf("%s: mismatch, len %u, volume %d, offsets %d/%d\n",
+					name, len, volume, src_offset, dst_offset);
+			}
+		}
+	}
+	SDL_CloseAudio();
+
+	printf("%s: %s\n", name, failures ? "FAILED" : "passed");
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int status = 0;
+
+	SDL_putenv("SDL_AUDIODRIVER=dummy");
+	if ( SDL_Init(SDL_INIT_AUDIO) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	srand(1);
+
+	status += TestFormat(AUDIO_U8, "U8");
+	status += TestFormat(AUDIO_S8, "S8");
+	status += TestFormat(AUDIO_S16LSB, "S16LSB");
+	status += TestFormat(AUDIO_S16MSB, "S16MSB");
+	status += TestFormat(AUDIO_F32LSB, "F32LSB");
+	status += TestFormat(AUDIO_F32MSB, "F32MSB");
+
+	SDL_Quit();
+	return status;
+}
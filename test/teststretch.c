@@ -0,0 +1,245 @@
+
+/* Check SDL_SoftStretchFilter against a floating point reference for
+   every filter, across source and destination formats, sizes and offsets.
+   The library works in 256ths, so small differences are allowed, plus
+   whatever the formats themselves lose.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "SDL.h"
+
+#define MAX_SRC		40
+#define MAX_DST		80
+#define NUM_RUNS	300
+
+static const struct {
+	const char *name;
+	int bpp;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+} formats[] = {
+	{ "ARGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 },
+	{ "xBGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0x00000000 },
+	{ "RGBA8888", 32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "RGB888", 24, 0x00FF0000, 0x0000FF00, 0x000000FF, 0x00000000 },
+	{ "RGB565", 16, 0x0000F800, 0x000007E0, 0x0000001F, 0x00000000 },
+	{ "ARGB4444", 16, 0x00000F00, 0x000000F0, 0x0000000F, 0x0000F000 },
+};
+#define NUM_FORMATS	(sizeof(formats) / sizeof(formats[0]))
+
+static const char *filters[] = { "nearest", "bilinear", "box" };
+
+static Uint32 GetPixel(SDL_Surface *surface, int x, int y)
+{
+	Uint8 *p = (Uint8 *)surface->pixels + y * surface->pitch +
+			x * surface->format->BytesPerPixel;
+	switch (surface->format->BytesPerPixel) {
+	    case 2:
+		return *(Uint16 *)p;
+	    case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+		return (p[0] << 16) | (p[1] << 8) | p[2];
+#else
+		return p[0] | (p[1] << 8) | (p[2] << 16);
+#endif
+	    default:
+		return *(Uint32 *)p;
+	}
+}
+
+/* The channels of a pixel, the way the blitters widen them */
+static void GetChannels(SDL_Surface *surface, int x, int y, double *c)
+{
+	SDL_PixelFormat *fmt = surface->format;
+	Uint32 pixel = GetPixel(surface, x, y);
+
+	c[0] = (double)(((pixel & fmt->Rmask) >> fmt->Rshift) << fmt->Rloss);
+	c[1] = (double)(((pixel & fmt->Gmask) >> fmt->Gshift) << fmt->Gloss);
+	c[2] = (double)(((pixel & fmt->Bmask) >> fmt->Bshift) << fmt->Bloss);
+	if ( fmt->Amask ) {
+		c[3] = (double)(((pixel & fmt->Amask) >> fmt->Ashift) << fmt->Aloss);
+	} else {
+		c[3] = 255.0;
+	}
+}
+
+/* Source pixels and weights along one axis for destination pixel 'i' */
+static int Taps(int filter, int i, int src_len, int dst_len,
+		int *index, double *weight)
+{
+	double scale = (double)src_len / dst_len;
+	int n = 0;
+
+	if ( filter == 0 ) {
+		/* In integers, so exact halves don't round the wrong way */
+		index[0] = (2 * i + 1) * src_len / (2 * dst_len);
+		weight[0] = 1.0;
+		n = 1;
+	} else if ( filter == 1 ) {
+		double pos = (i + 0.5) * scale - 0.5;
+		int p;
+		if ( pos < 0.0 ) {
+			pos = 0.0;
+		}
+		p = (int)pos;
+		if ( p >= src_len - 1 ) {
+			index[0] = src_len - 1;
+			weight[0] = 1.0;
+			n = 1;
+		} else {
+			index[0] = p;
+			weight[0] = 1.0 - (pos - p);
+			index[1] = p + 1;
+			weight[1] = pos - p;
+			n = 2;
+		}
+	} else {
+		double a = i * scale;
+		double b = (i + 1) * scale;
+		int p;
+		for ( p=(int)a; p<b && p<src_len; ++p ) {
+			double lo = (p > a) ? p : a;
+			double hi = (p + 1 < b) ? p + 1 : b;
+			index[n] = p;
+			weight[n] = (hi - lo) / (b - a);
+			++n;
+		}
+	}
+	return n;
+}
+
+static void Reference(SDL_Surface *src, SDL_Rect *srect, SDL_Rect *drect,
+		      int filter, int x, int y, double *c)
+{
+	int xi[MAX_SRC+2], yi[MAX_SRC+2];
+	double xw[MAX_SRC+2], yw[MAX_SRC+2];
+	int nx = Taps(filter, x, srect->w, drect->w, xi, xw);
+	int ny = Taps(filter, y, srect->h, drect->h, yi, yw);
+	int i, j, k;
+
+	c[0] = c[1] = c[2] = c[3] = 0.0;
+	for ( j=0; j<ny; ++j ) {
+		for ( i=0; i<nx; ++i ) {
+			double s[4];
+			GetChannels(src, srect->x + xi[i], srect->y + yi[j], s);
+			for ( k=0; k<4; ++k ) {
+				c[k] += s[k] * xw[i] * yw[j];
+			}
+		}
+	}
+}
+
+static int TestStretch(int from, int to, int filter)
+{
+	int run, failures = 0;
+
+	for ( run=0; run<NUM_RUNS; ++run ) {
+		SDL_Surface *src, *dst, *orig;
+		SDL_Rect srect, drect;
+		int x, y, k, bad = 0;
+		double tolerance[4];
+
+		src = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_SRC+4, MAX_SRC+4,
+			formats[from].bpp, formats[from].Rmask, formats[from].Gmask,
+			formats[from].Bmask, formats[from].Amask);
+		dst = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_DST+4, MAX_DST+4,
+			formats[to].bpp, formats[to].Rmask, formats[to].Gmask,
+			formats[to].Bmask, formats[to].Amask);
+		orig = SDL_CreateRGBSurface(SDL_SWSURFACE, MAX_DST+4, MAX_DST+4,
+			formats[to].bpp, formats[to].Rmask, formats[to].Gmask,
+			formats[to].Bmask, formats[to].Amask);
+		if ( src == NULL || dst == NULL || orig == NULL ) {
+			fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+			exit(1);
+		}
+		for ( k=0; k<src->pitch*src->h; ++k ) {
+			((Uint8 *)src->pixels)[k] = (Uint8)rand();
+		}
+		for ( k=0; k<dst->pitch*dst->h; ++k ) {
+			((Uint8 *)dst->pixels)[k] = (Uint8)rand();
+		}
+		SDL_memcpy(orig->pixels, dst->pixels, dst->pitch*dst->h);
+
+		srect.w = 1 + rand() % MAX_SRC;
+		srect.h = 1 + rand() % MAX_SRC;
+		srect.x = rand() % 4;
+		srect.y = rand() % 4;
+		drect.w = 1 + rand() % MAX_DST;
+		drect.h = 1 + rand() % MAX_DST;
+		drect.x = rand() % 4;
+		drect.y = rand() % 4;
+		if ( SDL_SoftStretchFilter(src, &srect, dst, &drect, filter) < 0 ) {
+			printf("SDL_SoftStretchFilter failed: %s\n", SDL_GetError());
+			exit(1);
+		}
+
+		/* 256ths of a step in each direction, and the format losses */
+		tolerance[0] = 3.0 + (1 << src->format->Rloss) + (1 << dst->format->Rloss);
+		tolerance[1] = 3.0 + (1 << src->format->Gloss) + (1 << dst->format->Gloss);
+		tolerance[2] = 3.0 + (1 << src->format->Bloss) + (1 << dst->format->Bloss);
+		tolerance[3] = 3.0 + (1 << src->format->Aloss) + (1 << dst->format->Aloss);
+
+		for ( y=0; y<dst->h; ++y ) {
+			for ( x=0; x<dst->w; ++x ) {
+				double expected[4], actual[4];
+
+				if ( x < drect.x || x >= drect.x + drect.w ||
+				     y < drect.y || y >= drect.y + drect.h ) {
+					if ( GetPixel(dst, x, y) != GetPixel(orig, x, y) ) {
+						bad = 1;
+					}
+					continue;
+				}
+				Reference(src, &srect, &drect, filter,
+					  x - drect.x, y - drect.y, expected);
+				GetChannels(dst, x, y, actual);
+				if ( !dst->format->Amask ) {
+					expected[3] = 255.0;
+				}
+				for ( k=0; k<4; ++k ) {
+					if ( fabs(actual[k] - expected[k]) > tolerance[k] ) {
+						bad = 1;
+					}
+				}
+			}
+		}
+		if ( bad && failures++ < 3 ) {
+			printf("%s %s->%s: mismatch, %dx%d -> %dx%d\n",
+				filters[filter], formats[from].name, formats[to].name,
+				srect.w, srect.h, drect.w, drect.h);
+		}
+		SDL_FreeSurface(src);
+		SDL_FreeSurface(dst);
+		SDL_FreeSurface(orig);
+	}
+	return failures ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int from, to, filter, status = 0;
+
+	if ( SDL_Init(0) < 0 ) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+	srand(1);
+
+	printf("SSE2: %d\n", SDL_HasSSE2());
+	for ( filter=0; filter<3; ++filter ) {
+		int failures = 0;
+		for ( from=0; from<NUM_FORMATS; ++from ) {
+			for ( to=0; to<NUM_FORMATS; ++to ) {
+				failures += TestStretch(from, to, filter);
+			}
+		}
+		printf("%s: %s\n", filters[filter], failures ? "FAILED" : "passed");
+		status += failures;
+	}
+
+	SDL_Quit();
+	return status ? 1 : 0;
+}
@@ -28,6 +28,7 @@ int main(int argc, char *argv[])
 {
 	int desired;
 	SDL_TimerID t1, t2, t3;
+	SDL_TimerStats stats;
 
 	if ( SDL_Init(SDL_INIT_TIMER) < 0 ) {
 		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
@@ -74,6 +75,11 @@ int main(int argc, char *argv[])
 	printf("Waiting 10 seconds\n");
 	SDL_Delay(10*1000);
 
+	if ( SDL_GetTimerStats(t2, &stats) == 0 && stats.calls ) {
+		printf("Timer 2 ran %d times, %d ms late on average, %d ms at most\n",
+			stats.calls, stats.late_total/stats.calls, stats.late_max);
+	}
+
 	printf("Removing timer 1 and waiting 5 more seconds\n");
 	SDL_RemoveTimer(t1);
 
@@ -82,6 +88,32 @@ int main(int argc, char *argv[])
 	SDL_RemoveTimer(t2);
 	SDL_RemoveTimer(t3);
 
+#ifdef SDL_HAS_64BIT_TYPE
+	/* Test the high resolution counter with a 1 ms periodic loop */
+	printf("Sleeping in 1 ms steps for 1 second...\n");
+	{
+		Uint64 freq, start, next, late, worst;
+		int i;
+
+		freq = SDL_GetPerformanceFrequency();
+		start = next = SDL_GetPerformanceCounter();
+		worst = 0;
+		for ( i=0; i<1000; ++i ) {
+			next += freq/1000;
+			SDL_DelayUntil(next);
+			late = SDL_GetPerformanceCounter() - next;
+			if ( late > worst ) {
+				worst = late;
+			}
+		}
+		fprintf(stderr,
+		"Counter frequency = %.0f Hz, 1000 steps took %f ms, worst step was %f ms late\n",
+			(double)freq,
+			(double)(SDL_GetPerformanceCounter()-start)*1000/freq,
+			(double)worst*1000/freq);
+	}
+#endif
+
 	SDL_Quit();
 	return(0);
 }